@@ -0,0 +1,58 @@
+// This code measures the speedup of the vectorized transcendental functions of the 'densematrix' 
+// object (used to evaluate the expressions at the integration points) over a scalar loop calling 
+// the standard library. The vectorized results are also compared to the scalar ones.
+
+
+#include "sparselizard.h"
+
+
+using namespace sl;
+
+// Time the 'densematrix' function and the scalar loop on a copy of the values:
+bool benchmark(std::string name, densematrix values, std::function<void(densematrix&)> vectorized, std::function<double(double)> scalar)
+{
+    long long int numentries = values.count();
+    
+    densematrix vectorizedvalues = values.copy();
+    densematrix scalarvalues = values.copy();
+    double* vecvals = vectorizedvalues.getvalues();
+    double* scalvals = scalarvalues.getvalues();
+    
+    wallclock clk;
+    vectorized(vectorizedvalues);
+    double vectorizedtime = clk.toc();
+    
+    clk.tic();
+    for (long long int i = 0; i < numentries; i++)
+        scalvals[i] = scalar(scalvals[i]);
+    double scalartime = clk.toc();
+    
+    // The vectorized functions are within a few ulp of the scalar ones:
+    double maxrelerror = 0;
+    for (long long int i = 0; i < numentries; i++)
+        maxrelerror = std::max(maxrelerror, std::abs(vecvals[i]-scalvals[i]) / std::max(1.0, std::abs(scalvals[i])));
+    
+    std::cout << name << ": speedup " << scalartime/vectorizedtime << " (max relative difference " << maxrelerror << ")" << std::endl;
+    
+    return (maxrelerror < 1e-14);
+}
+
+int main(void)
+{	
+    long long int numentries = 10000000;
+    
+    // Values in ]0, 10]:
+    densematrix values(1, numentries, 1e-6, 10.0/numentries);
+    densematrix exponents(1, numentries, 1.7);
+    
+    bool isvalid = true;
+    
+    isvalid = benchmark("sin", values, [](densematrix& m){ m.sin(); }, [](double v){ return std::sin(v); }) && isvalid;
+    isvalid = benchmark("cos", values, [](densematrix& m){ m.cos(); }, [](double v){ return std::cos(v); }) && isvalid;
+    isvalid = benchmark("tan", values, [](densematrix& m){ m.tan(); }, [](double v){ return std::tan(v); }) && isvalid;
+    isvalid = benchmark("log10", values, [](densematrix& m){ m.log10(); }, [](double v){ return std::log10(v); }) && isvalid;
+    isvalid = benchmark("pow", values, [&](densematrix& m){ m.power(exponents); }, [](double v){ return std::pow(v, 1.7); }) && isvalid;
+    
+    // Code validation line. Can be removed.
+    std::cout << isvalid;
+}
@@ -0,0 +1,72 @@
+// This code checks that the sum-factorized assembly and interpolation on hexahedra give the
+// same result as the usual dense products. The element matrices are compared through a
+// product with a field, the matrix-free application of the operator (an assembled rhs
+// with a known field in place of the dof) is compared to the assembled matrix times the
+// field values and an integral of an interpolated field is compared as well.
+
+
+#include "sparselizard.h"
+
+
+using namespace sl;
+
+int main(void)
+{	
+    int sur = 1, vol = 2;
+    
+    int n = 4, interpolationorder = 6;
+    
+    shape q("quadrangle", sur, {0,0,0, 1,0,0, 1,1,0, 0,1,0}, {n,n,n,n});
+    // Extruding the quadrangles gives hexahedra:
+    shape v = q.extrude(vol, 1.0, n);
+    
+    mesh mymesh({v});
+    
+    field u("h1"), x("x"), y("y"), z("z");
+    
+    u.setorder(vol, interpolationorder);
+    u.setvalue(vol, sin(3*x)*y*y+z);
+    
+    expression coef = 1+x*y*z;
+    
+    // Block 0 holds the element matrices and block 1 the matrix-free application to field u:
+    formulation form;
+    
+    form += integral(vol, coef*grad(dof(u))*grad(tf(u)) + dof(u)*tf(u), 0, 0);
+    form += integral(vol, -coef*grad(u)*grad(tf(u)) - u*tf(u), 0, 1);
+    
+    vec uvec(form);
+    uvec.setdata(vol, u);
+    
+    // Dense products:
+    setsumfactorization(-1);
+    
+    form.generate(0);
+    vec densematrixproduct = form.A()*uvec;
+    form.generate(1);
+    vec densematrixfree = form.b();
+    double denseintegral = (coef*u*u).integrate(vol, 2*interpolationorder);
+    
+    // Sum factorization from order 1 on:
+    setsumfactorization(1);
+    
+    form.generate(0);
+    vec sumfactmatrixproduct = form.A()*uvec;
+    form.generate(1);
+    vec sumfactmatrixfree = form.b();
+    double sumfactintegral = (coef*u*u).integrate(vol, 2*interpolationorder);
+    
+    setsumfactorization(-1);
+    
+    double matrixerror = (sumfactmatrixproduct-densematrixproduct).norm() / densematrixproduct.norm();
+    double matrixfreeerror = (sumfactmatrixfree-densematrixproduct).norm() / densematrixproduct.norm();
+    double densematrixfreeerror = (densematrixfree-densematrixproduct).norm() / densematrixproduct.norm();
+    double integralerror = std::abs(sumfactintegral-denseintegral) / std::abs(denseintegral);
+    
+    std::cout << "Relative error on the element matrices: " << matrixerror << std::endl;
+    std::cout << "Relative error on the matrix-free application: " << matrixfreeerror << " (dense: " << densematrixfreeerror << ")" << std::endl;
+    std::cout << "Relative error on the interpolation: " << integralerror << std::endl;
+    
+    // Code validation line. Can be removed.
+    std::cout << (matrixerror < 1e-10 && matrixfreeerror < 1e-10 && densematrixfreeerror < 1e-10 && integralerror < 1e-10);
+}
@@ -2,6 +2,104 @@
 #include "cblas.h"
 
 
+// The elementwise kernels below are compiled for AVX-512, AVX2 and the baseline instruction set. The 
+// version matching the processor is selected when the library is loaded (GCC function multiversioning).
+// All value buffers come from the 'memorypool' object and are therefore 64-byte aligned.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define SIMDCLONES __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define SIMDCLONES
+#endif
+
+// The sin, cos, tan, pow and log10 kernels call the glibc vector math library (libmvec) on 8 (AVX-512) or 4 (AVX2) values
+// at a time when the processor supports it and the scalar libm functions on the remaining values or otherwise. libmvec is
+// linked through libm and its results are within 4 ulp of the scalar functions. tan and log10 require glibc 2.35.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__) && defined(__GLIBC__)
+#if __GLIBC_PREREQ(2,22)
+#define LIBMVEC
+#if __GLIBC_PREREQ(2,35)
+#define LIBMVECTANLOG10
+#endif
+#endif
+#endif
+
+#ifdef LIBMVEC
+#include <immintrin.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+extern "C"
+{
+    __m256d _ZGVdN4v_sin(__m256d);
+    __m256d _ZGVdN4v_cos(__m256d);
+    __m256d _ZGVdN4vv_pow(__m256d, __m256d);
+    __m512d _ZGVeN8v_sin(__m512d);
+    __m512d _ZGVeN8v_cos(__m512d);
+    __m512d _ZGVeN8vv_pow(__m512d, __m512d);
+    #ifdef LIBMVECTANLOG10
+    __m256d _ZGVdN4v_tan(__m256d);
+    __m256d _ZGVdN4v_log10(__m256d);
+    __m512d _ZGVeN8v_tan(__m512d);
+    __m512d _ZGVeN8v_log10(__m512d);
+    #endif
+}
+
+// Apply the vector function to all full vectors of values. The number of values treated is returned:
+__attribute__((target("avx512f"))) static long long int applyvectormath(__m512d (*func)(__m512d), double* vals, long long int numentries)
+{
+    long long int numvectorized = numentries - numentries%8;
+    for (long long int i = 0; i < numvectorized; i += 8)
+        _mm512_storeu_pd(vals+i, func(_mm512_loadu_pd(vals+i)));
+    return numvectorized;
+}
+
+__attribute__((target("avx2"))) static long long int applyvectormath(__m256d (*func)(__m256d), double* vals, long long int numentries)
+{
+    long long int numvectorized = numentries - numentries%4;
+    for (long long int i = 0; i < numvectorized; i += 4)
+        _mm256_storeu_pd(vals+i, func(_mm256_loadu_pd(vals+i)));
+    return numvectorized;
+}
+
+__attribute__((target("avx512f"))) static long long int applyvectormath(__m512d (*func)(__m512d, __m512d), double* vals, double* args, long long int numentries)
+{
+    long long int numvectorized = numentries - numentries%8;
+    for (long long int i = 0; i < numvectorized; i += 8)
+        _mm512_storeu_pd(vals+i, func(_mm512_loadu_pd(vals+i), _mm512_loadu_pd(args+i)));
+    return numvectorized;
+}
+
+__attribute__((target("avx2"))) static long long int applyvectormath(__m256d (*func)(__m256d, __m256d), double* vals, double* args, long long int numentries)
+{
+    long long int numvectorized = numentries - numentries%4;
+    for (long long int i = 0; i < numvectorized; i += 4)
+        _mm256_storeu_pd(vals+i, func(_mm256_loadu_pd(vals+i), _mm256_loadu_pd(args+i)));
+    return numvectorized;
+}
+
+// Select the widest vector functions supported by the processor (returns 0 if none):
+static long long int applyvectormath(__m512d (*avx512func)(__m512d), __m256d (*avx2func)(__m256d), double* vals, long long int numentries)
+{
+    if (__builtin_cpu_supports("avx512f"))
+        return applyvectormath(avx512func, vals, numentries);
+    if (__builtin_cpu_supports("avx2"))
+        return applyvectormath(avx2func, vals, numentries);
+    return 0;
+}
+
+static long long int applyvectormath(__m512d (*avx512func)(__m512d, __m512d), __m256d (*avx2func)(__m256d, __m256d), double* vals, double* args, long long int numentries)
+{
+    if (__builtin_cpu_supports("avx512f"))
+        return applyvectormath(avx512func, vals, args, numentries);
+    if (__builtin_cpu_supports("avx2"))
+        return applyvectormath(avx2func, vals, args, numentries);
+    return 0;
+}
+
+#pragma GCC diagnostic pop
+#endif
+
 void densematrix::errorifempty(void)
 {
     if (numrows*numcols == 0)
@@ -15,43 +113,40 @@ densematrix::densematrix(long long int numberofrows, long long int numberofcolum
 {
     numrows = numberofrows;
     numcols = numberofcolumns;
-    myvalues = std::shared_ptr<double>(new double[numcols*numrows]);
+    myvalues = memorypool::getbuffer<double>(numcols*numrows);
 }
 
 densematrix::densematrix(long long int numberofrows, long long int numberofcolumns, double initvalue)
 {
     numrows = numberofrows;
     numcols = numberofcolumns;
-    double* myvaluesptr = new double[numcols*numrows];
+    myvalues = memorypool::getbuffer<double>(numcols*numrows);
+    double* myvaluesptr = myvalues.get();
     
     for (long long int i = 0; i < numcols*numrows; i++)
         myvaluesptr[i] = initvalue;
-    
-    myvalues = std::shared_ptr<double>(myvaluesptr);
 }
 
 densematrix::densematrix(long long int numberofrows, long long int numberofcolumns, std::vector<double> valvec)
 {
     numrows = numberofrows;
     numcols = numberofcolumns;
-    double* myvaluesptr = new double[numcols*numrows];
+    myvalues = memorypool::getbuffer<double>(numcols*numrows);
+    double* myvaluesptr = myvalues.get();
     
     for (long long int i = 0; i < numcols*numrows; i++)
         myvaluesptr[i] = valvec[i];
-    
-    myvalues = std::shared_ptr<double>(myvaluesptr);
 }
 
 densematrix::densematrix(long long int numberofrows, long long int numberofcolumns, double init, double step)
 {
     numrows = numberofrows;
     numcols = numberofcolumns;
-    double* myvaluesptr = new double[numcols*numrows];
+    myvalues = memorypool::getbuffer<double>(numcols*numrows);
+    double* myvaluesptr = myvalues.get();
     
     for (long long int i = 0; i < numcols*numrows; i++)
         myvaluesptr[i] = init+i*step;
-    
-    myvalues = std::shared_ptr<double>(myvaluesptr);
 }
 
 densematrix::densematrix(std::vector<densematrix> input)
@@ -71,7 +166,8 @@ densematrix::densematrix(std::vector<densematrix> input)
             abort();
         }
     }
-    double* myvaluesptr = new double[numrows*numcols];
+    myvalues = memorypool::getbuffer<double>(numrows*numcols);
+    double* myvaluesptr = myvalues.get();
     
     long long int index = 0;
     for (long long int i = 0; i < input.size(); i++)
@@ -83,8 +179,6 @@ densematrix::densematrix(std::vector<densematrix> input)
             index++;
         }
     }
-    
-    myvalues = std::shared_ptr<double>(myvaluesptr);
 }
 
 void densematrix::setrow(long long int rownumber, std::vector<double> rowvals)
@@ -171,7 +265,7 @@ densematrix densematrix::copy(void)
     // The pointed value has to be copied as well.
     if (densematrixcopy.myvalues != NULL)
     {
-        densematrixcopy.myvalues = std::shared_ptr<double>(new double[numcols*numrows]);
+        densematrixcopy.myvalues = memorypool::getbuffer<double>(numcols*numrows);
         double* copiedmyvaluesptr = densematrixcopy.myvalues.get();
         double* myvaluesptr = myvalues.get();
         for (long long int i = 0; i < numcols*numrows; i++)
@@ -302,30 +396,28 @@ densematrix densematrix::multiply(densematrix B)
 
 double* densematrix::getvalues(void) { return myvalues.get(); }
 
+SIMDCLONES
 void densematrix::addproduct(double coef, densematrix B)
 {
     double* myvaluesptr = myvalues.get();
     double* Bmyvaluesptr = B.myvalues.get();
+    long long int numentries = numrows*numcols;
     
-    if (coef == 1)
-    {
-        for (long long int i = 0; i < numrows*numcols; i++)
-            myvaluesptr[i] += Bmyvaluesptr[i];
-    }
-    else
-    {
-        for (long long int i = 0; i < numrows*numcols; i++)
-            myvaluesptr[i] += coef*Bmyvaluesptr[i];
-    }
+    #pragma omp simd aligned(myvaluesptr, Bmyvaluesptr : 64)
+    for (long long int i = 0; i < numentries; i++)
+        myvaluesptr[i] += coef*Bmyvaluesptr[i];
 }
 
+SIMDCLONES
 void densematrix::addproduct(densematrix A, densematrix B)
 {
     double* myvaluesptr = myvalues.get();
     double* Amyvaluesptr = A.myvalues.get();
     double* Bmyvaluesptr = B.myvalues.get();
+    long long int numentries = numrows*numcols;
 
-    for (long long int i = 0; i < numrows*numcols; i++)
+    #pragma omp simd aligned(myvaluesptr, Amyvaluesptr, Bmyvaluesptr : 64)
+    for (long long int i = 0; i < numentries; i++)
         myvaluesptr[i] += Amyvaluesptr[i]*Bmyvaluesptr[i];
 }
 
@@ -401,46 +493,126 @@ densematrix densematrix::getinverse(void)
     return output.gettranspose();
 }
 
+densematrix densematrix::getinverse(bool& issingular)
+{
+    int n = numrows;
+    if (numrows != numcols)
+    {
+        std::cout << "Error in 'densematrix' object: can only invert a square densematrix" << std::endl;
+        abort();
+    }
+    
+    issingular = false;
+    
+    densematrix work = copy();
+    densematrix output(n,n, 0.0);
+    double* wptr = work.getvalues();
+    double* optr = output.getvalues();
+    for (int i = 0; i < n; i++)
+        optr[i*n+i] = 1.0;
+    
+    double pivottol = 1e-12 * maxabs();
+
+    for (int c = 0; c < n; c++)
+    {
+        // Partial pivoting:
+        int pivotrow = c;
+        for (int r = c+1; r < n; r++)
+        {
+            if (std::abs(wptr[r*n+c]) > std::abs(wptr[pivotrow*n+c]))
+                pivotrow = r;
+        }
+        if (std::abs(wptr[pivotrow*n+c]) <= pivottol)
+        {
+            issingular = true;
+            return output;
+        }
+        if (pivotrow != c)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                std::swap(wptr[c*n+j], wptr[pivotrow*n+j]);
+                std::swap(optr[c*n+j], optr[pivotrow*n+j]);
+            }
+        }
+        
+        double invpivot = 1.0/wptr[c*n+c];
+        for (int j = 0; j < n; j++)
+        {
+            wptr[c*n+j] *= invpivot;
+            optr[c*n+j] *= invpivot;
+        }
+        for (int r = 0; r < n; r++)
+        {
+            double factor = wptr[r*n+c];
+            if (r == c || factor == 0)
+                continue;
+            for (int j = 0; j < n; j++)
+            {
+                wptr[r*n+j] -= factor*wptr[c*n+j];
+                optr[r*n+j] -= factor*optr[c*n+j];
+            }
+        }
+    }
+    
+    return output;
+}
+
+SIMDCLONES
 void densematrix::multiplyelementwise(densematrix B)
 {
     double* myvaluesptr = myvalues.get();
     double* Bmyvaluesptr = B.myvalues.get();
+    long long int numentries = numrows*numcols;
     
-    for (long long int i = 0; i < numrows*numcols; i++)
+    #pragma omp simd aligned(myvaluesptr, Bmyvaluesptr : 64)
+    for (long long int i = 0; i < numentries; i++)
         myvaluesptr[i] *= Bmyvaluesptr[i];
 }
 
+SIMDCLONES
 void densematrix::multiplyelementwise(double val)
 {
     double* myvaluesptr = myvalues.get();
+    long long int numentries = numrows*numcols;
     
-    for (long long int i = 0; i < numrows*numcols; i++)
+    #pragma omp simd aligned(myvaluesptr : 64)
+    for (long long int i = 0; i < numentries; i++)
         myvaluesptr[i] *= val;
 }
 
+SIMDCLONES
 void densematrix::add(densematrix B)
 {
     double* myvaluesptr = myvalues.get();
     double* Bmyvaluesptr = B.myvalues.get();
+    long long int numentries = numrows*numcols;
     
-    for (long long int i = 0; i < numrows*numcols; i++)
+    #pragma omp simd aligned(myvaluesptr, Bmyvaluesptr : 64)
+    for (long long int i = 0; i < numentries; i++)
         myvaluesptr[i] += Bmyvaluesptr[i];
 }
 
+SIMDCLONES
 void densematrix::subtract(densematrix B)
 {
     double* myvaluesptr = myvalues.get();
     double* Bmyvaluesptr = B.myvalues.get();
+    long long int numentries = numrows*numcols;
     
-    for (long long int i = 0; i < numrows*numcols; i++)
+    #pragma omp simd aligned(myvaluesptr, Bmyvaluesptr : 64)
+    for (long long int i = 0; i < numentries; i++)
         myvaluesptr[i] -= Bmyvaluesptr[i];
 }
 
+SIMDCLONES
 void densematrix::minus(void)
 {
     double* myvaluesptr = myvalues.get();
+    long long int numentries = numrows*numcols;
     
-    for (long long int i = 0; i < numrows*numcols; i++)
+    #pragma omp simd aligned(myvaluesptr : 64)
+    for (long long int i = 0; i < numentries; i++)
         myvaluesptr[i] = -myvaluesptr[i];
 }
 
@@ -448,88 +620,136 @@ void densematrix::power(densematrix exponent)
 {
     double* myvaluesptr = myvalues.get();
     double* expmyvaluesptr = exponent.myvalues.get();
+    long long int numentries = numrows*numcols;
     
-    for (long long int i = 0; i < numrows*numcols; i++)
-            myvaluesptr[i] = std::pow(myvaluesptr[i], expmyvaluesptr[i]);
+    long long int numvectorized = 0;
+    #ifdef LIBMVEC
+    numvectorized = applyvectormath(_ZGVeN8vv_pow, _ZGVdN4vv_pow, myvaluesptr, expmyvaluesptr, numentries);
+    #endif
+    
+    for (long long int i = numvectorized; i < numentries; i++)
+        myvaluesptr[i] = std::pow(myvaluesptr[i], expmyvaluesptr[i]);
 }
 
+SIMDCLONES
 void densematrix::invert(void)
 {
     double* myvaluesptr = myvalues.get();
+    long long int numentries = numrows*numcols;
     
-    for (long long int i = 0; i < numrows*numcols; i++)
+    #pragma omp simd aligned(myvaluesptr : 64)
+    for (long long int i = 0; i < numentries; i++)
         myvaluesptr[i] = 1.0/myvaluesptr[i];
 }
 
+SIMDCLONES
 void densematrix::abs(void)
 {
     double* myvaluesptr = myvalues.get();
-
-    for (long long int i = 0; i < numrows*numcols; i++)
+    long long int numentries = numrows*numcols;
+    
+    #pragma omp simd aligned(myvaluesptr : 64)
+    for (long long int i = 0; i < numentries; i++)
         myvaluesptr[i] = std::abs(myvaluesptr[i]);
 }
 
 void densematrix::sin(void)
 {
     double* myvaluesptr = myvalues.get();
-
-    for (long long int i = 0; i < numrows*numcols; i++)
+    long long int numentries = numrows*numcols;
+    
+    long long int numvectorized = 0;
+    #ifdef LIBMVEC
+    numvectorized = applyvectormath(_ZGVeN8v_sin, _ZGVdN4v_sin, myvaluesptr, numentries);
+    #endif
+    
+    for (long long int i = numvectorized; i < numentries; i++)
         myvaluesptr[i] = std::sin(myvaluesptr[i]);
 }
 
 void densematrix::cos(void)
 {
     double* myvaluesptr = myvalues.get();
-
-    for (long long int i = 0; i < numrows*numcols; i++)
+    long long int numentries = numrows*numcols;
+    
+    long long int numvectorized = 0;
+    #ifdef LIBMVEC
+    numvectorized = applyvectormath(_ZGVeN8v_cos, _ZGVdN4v_cos, myvaluesptr, numentries);
+    #endif
+    
+    for (long long int i = numvectorized; i < numentries; i++)
         myvaluesptr[i] = std::cos(myvaluesptr[i]);
 }
 
 void densematrix::tan(void)
 {
     double* myvaluesptr = myvalues.get();
-
-    for (long long int i = 0; i < numrows*numcols; i++)
+    long long int numentries = numrows*numcols;
+    
+    long long int numvectorized = 0;
+    #ifdef LIBMVECTANLOG10
+    numvectorized = applyvectormath(_ZGVeN8v_tan, _ZGVdN4v_tan, myvaluesptr, numentries);
+    #endif
+    
+    for (long long int i = numvectorized; i < numentries; i++)
         myvaluesptr[i] = std::tan(myvaluesptr[i]);
 }
 
+SIMDCLONES
 void densematrix::asin(void)
 {
     double* myvaluesptr = myvalues.get();
-
-    for (long long int i = 0; i < numrows*numcols; i++)
+    long long int numentries = numrows*numcols;
+    
+    #pragma omp simd aligned(myvaluesptr : 64)
+    for (long long int i = 0; i < numentries; i++)
         myvaluesptr[i] = std::asin(myvaluesptr[i]);
 }
 
+SIMDCLONES
 void densematrix::acos(void)
 {
     double* myvaluesptr = myvalues.get();
-
-    for (long long int i = 0; i < numrows*numcols; i++)
+    long long int numentries = numrows*numcols;
+    
+    #pragma omp simd aligned(myvaluesptr : 64)
+    for (long long int i = 0; i < numentries; i++)
         myvaluesptr[i] = std::acos(myvaluesptr[i]);
 }
 
+SIMDCLONES
 void densematrix::atan(void)
 {
     double* myvaluesptr = myvalues.get();
-
-    for (long long int i = 0; i < numrows*numcols; i++)
+    long long int numentries = numrows*numcols;
+    
+    #pragma omp simd aligned(myvaluesptr : 64)
+    for (long long int i = 0; i < numentries; i++)
         myvaluesptr[i] = std::atan(myvaluesptr[i]);
 }
 
 void densematrix::log10(void)
 {
     double* myvaluesptr = myvalues.get();
-
-    for (long long int i = 0; i < numrows*numcols; i++)
+    long long int numentries = numrows*numcols;
+    
+    long long int numvectorized = 0;
+    #ifdef LIBMVECTANLOG10
+    numvectorized = applyvectormath(_ZGVeN8v_log10, _ZGVdN4v_log10, myvaluesptr, numentries);
+    #endif
+    
+    for (long long int i = numvectorized; i < numentries; i++)
         myvaluesptr[i] = std::log10(myvaluesptr[i]);
 }
 
+SIMDCLONES
 void densematrix::mod(double modval)
 {
     double* myvaluesptr = myvalues.get();
-
-    for (long long int i = 0; i < numrows*numcols; i++)
+    long long int numentries = numrows*numcols;
+    
+    #pragma omp simd aligned(myvaluesptr : 64)
+    for (long long int i = 0; i < numentries; i++)
         myvaluesptr[i] = std::fmod(myvaluesptr[i], modval);
 }
 
@@ -584,27 +804,36 @@ double densematrix::maxabs(void)
     return val;
 }
 
+SIMDCLONES
 double densematrix::sum(void)
 {
     double* myvaluesptr = myvalues.get();
+    long long int numentries = numrows*numcols;
     double val = 0;
 
-    for (long long int i = 0; i < numrows*numcols; i++)
-            val += myvaluesptr[i];
+    #pragma omp simd aligned(myvaluesptr : 64) reduction(+:val)
+    for (long long int i = 0; i < numentries; i++)
+        val += myvaluesptr[i];
     return val;
 }
 
+SIMDCLONES
 void densematrix::multiplycolumns(std::vector<double> input)
 {
     double* myvaluesptr = myvalues.get();
+    double* inputptr = input.data();
     
     for (long long int i = 0; i < numrows; i++)
     {
+        double* rowptr = myvaluesptr + i*numcols;
+        
+        #pragma omp simd
         for (long long int j = 0; j < numcols; j++)
-            myvaluesptr[i*numcols + j] *= input[j];
+            rowptr[j] *= inputptr[j];
     }
 }
 
+SIMDCLONES
 densematrix densematrix::multiplyallrows(densematrix input)
 {
     densematrix output(numrows*input.numrows, numcols);
@@ -615,15 +844,21 @@ densematrix densematrix::multiplyallrows(densematrix input)
     
     for (long long int i = 0; i < numrows; i++)
     {
+        double* rowptr = myvaluesptr + i*numcols;
         for (long long int j = 0; j < input.numrows; j++)
         {
+            double* inrowptr = inmyvaluesptr + j*input.numcols;
+            double* outrowptr = outmyvaluesptr + (i*input.numrows + j)*numcols;
+            
+            #pragma omp simd
             for (long long int k = 0; k < numcols; k++)
-                outmyvaluesptr[(i*input.numrows + j)*numcols + k] = myvaluesptr[i*numcols+k] * inmyvaluesptr[j*input.numcols+k];
+                outrowptr[k] = rowptr[k] * inrowptr[k];
         }
     }
     return output;
 }
 
+SIMDCLONES
 densematrix densematrix::dofinterpoltimestf(densematrix tfval)
 {
     long long int fft = tfval.countrows();
@@ -642,13 +877,16 @@ densematrix densematrix::dofinterpoltimestf(densematrix tfval)
     {
         for (long long int ifft = 0; ifft < fft; ifft++)
         {
+            double* tfptr = tfvaluesptr + ifft*gp;
             for (long long int iffd = 0; iffd < ffd; iffd++)
             {
+                double* dofptr = myvaluesptr + ielem*numcols+iffd*gp;
+                double* outptr = outmyvaluesptr + ind;
+                
+                #pragma omp simd
                 for (long long int igp = 0; igp < gp; igp++)
-                {
-                    outmyvaluesptr[ind] = myvaluesptr[ ielem*numcols+iffd*gp+igp ] * tfvaluesptr[ifft*gp+igp];
-                    ind++;
-                }
+                    outptr[igp] = dofptr[igp] * tfptr[igp];
+                ind += gp;
             }
         }
     }
@@ -656,6 +894,7 @@ densematrix densematrix::dofinterpoltimestf(densematrix tfval)
     return output;
 }
 
+SIMDCLONES
 void densematrix::multiplycolumns(densematrix input)
 {
     long long int collen = input.countcolumns();
@@ -667,13 +906,15 @@ void densematrix::multiplycolumns(densematrix input)
     long long int ind = 0;
     for (long long int i = 0; i < numrows; i++)
     {
+        double* inrowptr = invaluesptr + i*collen;
         for (long long int b = 0; b < numblocks; b++)
         {
+            double* blockptr = myvaluesptr + ind;
+            
+            #pragma omp simd
             for (long long int c = 0; c < collen; c++)
-            {
-                myvaluesptr[ind] *= invaluesptr[i*collen+c];
-                ind++;
-            }
+                blockptr[c] *= inrowptr[c];
+            ind += collen;
         }
     }
 }
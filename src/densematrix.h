@@ -7,6 +7,7 @@
 
 // This object stores the ROW-MAJOR values of a dense matrix of doubles.
 // In other words the matrix is stored as [row1 row2 row3 ...].
+// The values are stored in a 64-byte aligned buffer provided by the 'memorypool' object.
 
 #ifndef DENSEMATRIX_H
 #define DENSEMATRIX_H
@@ -15,6 +16,7 @@
 #include <vector>
 #include <cmath>
 #include <memory>
+#include "memorypool.h"
 #include "petscmat.h"
 #include "intdensematrix.h"
 
@@ -108,6 +110,8 @@ class densematrix
         
         // Get the matrix inverse (must be square):
         densematrix getinverse(void);
+        // Same with a Gauss-Jordan elimination. 'issingular' is set to true if a pivot is numerically zero (the output is then meaningless):
+        densematrix getinverse(bool& issingular);
 
         // Elementwise operations below. 
         // Matrices must all have the same size.
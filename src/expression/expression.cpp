@@ -1431,6 +1431,18 @@ expression expression::resize(int numrows, int numcols)
 }
 
 
+expression expression::derivative(field input)
+{
+    std::vector<std::shared_ptr<rawfield>> rfs = input.getpointer()->getsons();
+    rfs.push_back(input.getpointer());
+    
+    expression output = getcopy();
+    for (int i = 0; i < mynumrows*mynumcols; i++)
+        output.myoperations[i] = myoperations[i]->derivative(rfs);
+    
+    return output;
+}
+
 expression expression::spacederivative(int whichderivative)
 {
     if (mynumrows > 3 || mynumcols != 1)
@@ -169,6 +169,10 @@ class expression
         // Output the resized expression (filled with zero if larger):
         expression resize(int numrows, int numcols);
         
+        // Get the derivative of the expression with respect to field 'input' in the direction of dof(input). This is the
+        // linearization of the expression around the current field value (e.g. to get the Newton tangent of a residual):
+        expression derivative(field input);
+        
         
         
         // THE FUNCTIONS BELOW ARE NOT MEANT TO BE CALLED BY THE USER!
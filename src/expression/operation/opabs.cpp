@@ -54,6 +54,12 @@ std::shared_ptr<operation> opabs::simplify(std::vector<int> disjregs)
         return shared_from_this();
 }
 
+std::shared_ptr<operation> opabs::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    // d(abs(a)) = sign(a) da:
+    return chainrule(std::shared_ptr<operation>(new opcondition(myarg, std::shared_ptr<operation>(new opconstant(1)), std::shared_ptr<operation>(new opconstant(-1)))), myarg->derivative(rfs));
+}
+
 std::shared_ptr<operation> opabs::copy(void)
 {
     std::shared_ptr<opabs> op(new opabs(myarg));
@@ -54,6 +54,12 @@ std::shared_ptr<operation> opacos::simplify(std::vector<int> disjregs)
         return shared_from_this();
 }
 
+std::shared_ptr<operation> opacos::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    // d(acos(a)) = -da / sqrt(1 - a^2):
+    return chainrule(std::shared_ptr<operation>(new opproduct({std::shared_ptr<operation>(new opconstant(-1)), std::shared_ptr<operation>(new oppower(std::shared_ptr<operation>(new opsum({std::shared_ptr<operation>(new opconstant(1)), std::shared_ptr<operation>(new opproduct({std::shared_ptr<operation>(new opconstant(-1)), myarg, myarg}))})), std::shared_ptr<operation>(new opconstant(-0.5))))})), myarg->derivative(rfs));
+}
+
 std::shared_ptr<operation> opacos::copy(void)
 {
     std::shared_ptr<opacos> op(new opacos(myarg));
@@ -54,6 +54,12 @@ std::shared_ptr<operation> opatan::simplify(std::vector<int> disjregs)
         return shared_from_this();
 }
 
+std::shared_ptr<operation> opatan::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    // d(atan(a)) = da / (1 + a^2):
+    return chainrule(std::shared_ptr<operation>(new opinversion(std::shared_ptr<operation>(new opsum({std::shared_ptr<operation>(new opconstant(1)), std::shared_ptr<operation>(new opproduct({myarg, myarg}))})))), myarg->derivative(rfs));
+}
+
 std::shared_ptr<operation> opatan::copy(void)
 {
     std::shared_ptr<opatan> op(new opatan(myarg));
@@ -85,6 +85,22 @@ std::shared_ptr<operation> opcondition::simplify(std::vector<int> disjregs)
     return shared_from_this();
 }
 
+std::shared_ptr<operation> opcondition::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    // The condition is piecewise constant:
+    std::shared_ptr<operation> istrue(new opcondition(mycond, std::shared_ptr<operation>(new opconstant(1)), std::shared_ptr<operation>(new opconstant(0))));
+    std::shared_ptr<operation> isfalse(new opcondition(mycond, std::shared_ptr<operation>(new opconstant(0)), std::shared_ptr<operation>(new opconstant(1))));
+    
+    std::shared_ptr<operation> dtrue = chainrule(istrue, mytrue->derivative(rfs));
+    std::shared_ptr<operation> dfalse = chainrule(isfalse, myfalse->derivative(rfs));
+    
+    if (dtrue->iszero())
+        return dfalse;
+    if (dfalse->iszero())
+        return dtrue;
+    return std::shared_ptr<operation>(new opsum({dtrue, dfalse}));
+}
+
 std::shared_ptr<operation> opcondition::copy(void)
 {
     std::shared_ptr<opcondition> op(new opcondition(mycond,mytrue,myfalse));
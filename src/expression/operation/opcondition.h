@@ -29,6 +29,7 @@ class opcondition: public operation
         std::vector<std::shared_ptr<operation>> getarguments(void) { return {mycond, mytrue, myfalse}; };
         std::shared_ptr<operation> simplify(std::vector<int> disjregs);
         
+        std::shared_ptr<operation> derivative(std::vector<std::shared_ptr<rawfield>>& rfs);
         std::shared_ptr<operation> copy(void);
         
         void reuseit(bool istobereused) { reuse = istobereused; };
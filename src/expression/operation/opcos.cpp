@@ -54,6 +54,12 @@ std::shared_ptr<operation> opcos::simplify(std::vector<int> disjregs)
         return shared_from_this();
 }
 
+std::shared_ptr<operation> opcos::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    // d(cos(a)) = -sin(a) da:
+    return chainrule(std::shared_ptr<operation>(new opproduct({std::shared_ptr<operation>(new opconstant(-1)), std::shared_ptr<operation>(new opsin(myarg))})), myarg->derivative(rfs));
+}
+
 std::shared_ptr<operation> opcos::copy(void)
 {
     std::shared_ptr<opcos> op(new opcos(myarg));
@@ -144,6 +144,43 @@ std::shared_ptr<operation> operation::copy(void)
     abort();
 }
 
+std::shared_ptr<operation> operation::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    // Operations that do not depend on the fields (e.g. time, Jacobian terms, constants, splines):
+    if (istf() || not(isfieldincluded(rfs)))
+        return std::shared_ptr<operation>(new opconstant(0));
+    
+    std::cout << "Error in 'operation' object: cannot differentiate the operation" << std::endl;
+    std::cout << "Operation was:" << std::endl;
+    this->print();
+    std::cout << std::endl;
+    abort();
+}
+
+std::shared_ptr<operation> operation::chainrule(std::shared_ptr<operation> outerderivative, std::shared_ptr<operation> argderivative)
+{
+    if (argderivative->iszero())
+        return argderivative;
+    
+    return std::shared_ptr<operation>(new opproduct({outerderivative, argderivative}));
+}
+
+bool operation::isfieldincluded(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    if (isfield())
+        return (std::find(rfs.begin(), rfs.end(), getfieldpointer()) != rfs.end());
+    if (isparameter())
+        return getparameterpointer()->isfieldincluded(rfs);
+    
+    std::vector<std::shared_ptr<operation>> args = getarguments();
+    for (int i = 0; i < args.size(); i++)
+    {
+        if (args[i]->isfieldincluded(rfs))
+            return true;
+    }
+    return false;
+}
+
 std::vector<double> operation::evaluate(std::vector<double>& xcoords, std::vector<double>& ycoords, std::vector<double>& zcoords)
 {
     std::cout << "Error in 'operation' object: cannot evaluate the operation" << std::endl;
@@ -137,6 +137,13 @@ class operation : public std::enable_shared_from_this<operation>
         // Simplify the operation as it is on the disjoint regions:
         virtual std::shared_ptr<operation> simplify(std::vector<int> disjregs) { return shared_from_this(); };
      
+        // Get the derivative with respect to the fields in 'rfs' in the direction of their dof (a constant 0 if independent of the fields):
+        virtual std::shared_ptr<operation> derivative(std::vector<std::shared_ptr<rawfield>>& rfs);
+        // True if the operation includes a field in 'rfs' (also through parameters):
+        bool isfieldincluded(std::vector<std::shared_ptr<rawfield>>& rfs);
+        // Product of the derivative of an outer function with the derivative of its argument (a constant 0 if the latter is zero):
+        static std::shared_ptr<operation> chainrule(std::shared_ptr<operation> outerderivative, std::shared_ptr<operation> argderivative);
+     
         // Evaluate an operation that only contains x, y and/or z fields without derivatives.
         virtual std::vector<double> evaluate(std::vector<double>& xcoords, std::vector<double>& ycoords, std::vector<double>& zcoords);
         
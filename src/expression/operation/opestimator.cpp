@@ -1,10 +1,128 @@
 #include "opestimator.h"
 
 
-opestimator::opestimator(std::string estimatortype, std::shared_ptr<operation> arg)
+bool opestimator::getfields(std::shared_ptr<operation> op, std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    if (op->isconstant())
+        return true;
+    
+    if (op->isfield())
+    {
+        // Time derivative values are not in the field coefficients:
+        if (std::dynamic_pointer_cast<opfield>(op)->gettimederivative() > 0)
+            return false;
+    
+        std::vector<std::pair<std::vector<int>, std::shared_ptr<rawfield>>> sons = op->getfieldpointer()->getallsons();
+        for (int i = 0; i < sons.size(); i++)
+        {
+            if (std::find(rfs.begin(), rfs.end(), sons[i].second) == rfs.end())
+                rfs.push_back(sons[i].second);
+        }
+        return true;
+    }
+    
+    // These depend on values outside of the element:
+    if (std::dynamic_pointer_cast<opestimator>(op) != NULL || std::dynamic_pointer_cast<opon>(op) != NULL || std::dynamic_pointer_cast<opathp>(op) != NULL || std::dynamic_pointer_cast<opcustom>(op) != NULL)
+        return false;
+    
+    // Parameters, time, ... cannot be tracked:
+    std::vector<std::shared_ptr<operation>> args = op->getarguments();
+    if (args.size() == 0)
+        return false;
+        
+    for (int i = 0; i < args.size(); i++)
+    {
+        if (getfields(args[i], rfs) == false)
+            return false;
+    }
+    return true;
+}
+
+std::vector<std::vector<bool>> opestimator::getchangedelements(void)
+{
+    int problemdimension = universe::mymesh->getmeshdimension();
+    
+    elements* myelements = universe::mymesh->getelements();
+    disjointregions* mydisjointregions = universe::mymesh->getdisjointregions();
+    std::vector<double>* nodecoords = universe::mymesh->getnodes()->getcoordinates();
+    
+    std::vector<int> alldisjregsinmaxdim = mydisjointregions->getindim(problemdimension);
+    
+    std::vector<std::vector<bool>> output(8);
+    for (int i = 0; i < 8; i++)
+        output[i] = std::vector<bool>(myelements->count(i), true);
+    
+    std::vector<std::shared_ptr<rawfield>> fields = {};
+    if (myisincremental == false || getfields(myarg, fields) == false)
+    {
+        myptracker = NULL;
+        myfields = {};
+        myfieldorders = {};
+        mycoefs = {};
+        mynodecoordinates = {};
+        return output;
+    }
+    
+    std::vector<std::vector<int>> fieldorders(fields.size(), std::vector<int>(alldisjregsinmaxdim.size()));
+    for (int f = 0; f < fields.size(); f++)
+    {
+        for (int i = 0; i < alldisjregsinmaxdim.size(); i++)
+            fieldorders[f][i] = fields[f]->getinterpolationorder(alldisjregsinmaxdim[i]);
+    }
+    
+    // The last estimate can only be reused on the same mesh with the same field orders:
+    bool isreusable = (myptracker == universe::mymesh->getptracker() && myfields == fields && myfieldorders == fieldorders && mynodecoordinates == *nodecoords);
+    
+    if (isreusable)
+    {
+        for (int i = 0; i < 8; i++)
+            output[i] = std::vector<bool>(myelements->count(i), false);
+    }
+    
+    std::vector<std::vector<densematrix>> coefs(fields.size(), std::vector<densematrix>(alldisjregsinmaxdim.size()));
+    for (int f = 0; f < fields.size(); f++)
+    {
+        for (int i = 0; i < alldisjregsinmaxdim.size(); i++)
+        {
+            int curdisjreg = alldisjregsinmaxdim[i];
+            int elementtypenumber = mydisjointregions->getelementtypenumber(curdisjreg);
+            int rb = mydisjointregions->getrangebegin(curdisjreg);
+            int numelems = mydisjointregions->countelements(curdisjreg);
+            
+            coefs[f][i] = fields[f]->getcoefficients(elementtypenumber, fieldorders[f][i], myalgorithm::getequallyspaced(rb, 1, numelems));
+            
+            if (isreusable == false)
+                continue;
+            
+            // Flag the elements with at least one changed coefficient:
+            int numff = coefs[f][i].countrows();
+            double* newvals = coefs[f][i].getvalues();
+            double* oldvals = mycoefs[f][i].getvalues();
+            for (int ff = 0; ff < numff; ff++)
+            {
+                for (int e = 0; e < numelems; e++)
+                {
+                    if (newvals[ff*numelems+e] != oldvals[ff*numelems+e])
+                        output[elementtypenumber][rb+e] = true;
+                }
+            }
+        }
+    }
+    
+    myptracker = universe::mymesh->getptracker();
+    myfields = fields;
+    myfieldorders = fieldorders;
+    mycoefs = coefs;
+    mynodecoordinates = *nodecoords;
+    
+    return output;
+}
+
+opestimator::opestimator(std::string estimatortype, std::shared_ptr<operation> arg, bool isincremental)
 {
     mytype = estimatortype;
     myarg = arg;
+    myisincremental = isincremental;
     
     if (mytype == "zienkiewiczzhu")
     {
@@ -71,7 +189,7 @@ std::shared_ptr<operation> opestimator::simplify(std::vector<int> disjregs)
 
 std::shared_ptr<operation> opestimator::copy(void)
 {
-    std::shared_ptr<opestimator> op(new opestimator(mytype, myarg));
+    std::shared_ptr<opestimator> op(new opestimator(mytype, myarg, myisincremental));
     // 'myvalue' should not be the same one as in this object thus do not do '*op = *this'.
     op->mystatenumber = 0; // to make sure 'myvalue' is recalculated when allowed (it is all zero here)
     return op;
@@ -91,18 +209,43 @@ void opestimator::estimatezienkiewiczzhu(void)
     elements* myelements = universe::mymesh->getelements();
     disjointregions* mydisjointregions = universe::mymesh->getdisjointregions();
     
+    // Only the elements whose field coefficients have changed are recomputed in incremental mode:
+    std::vector<std::vector<bool>> ischanged = getchangedelements();
+    
+    // Element types in the max dimension:
+    std::vector<int> maxdimtypes = {};
+    long long int numnodalvalues = 0;
+    for (int i = 0; i <= 7; i++)
+    {
+        int numelems = myelements->count(i);
+        
+        element elem(i);
+        if (numelems == 0 || elem.getelementdimension() != problemdimension)
+            continue;
+        
+        maxdimtypes.push_back(i);
+        numnodalvalues += numelems*elem.countnodes();
+    }
+    
+    mynodalvalues.resize(8);
+    for (int j = 0; j < maxdimtypes.size(); j++)
+    {
+        int i = maxdimtypes[j];
+        int numelems = myelements->count(i);
+        int nn = element(i).countnodes();
+        
+        if (mynodalvalues[i].countrows() != numelems || mynodalvalues[i].countcolumns() != nn)
+        {
+            mynodalvalues[i] = densematrix(numelems, nn);
+            ischanged[i] = std::vector<bool>(numelems, true);
+        }
+    }
+    
     // Compute 'myarg' at all mesh nodes: 
     std::vector<int> alldisjregsinmaxdim = mydisjointregions->getindim(problemdimension);
 
     int numnodes = universe::mymesh->getnodes()->count();
 
-    densematrix nodalvaluesmin(numnodes, 1);
-    densematrix nodalvaluesmax(numnodes, 1);
-    double* nvmin = nodalvaluesmin.getvalues();
-    double* nvmax = nodalvaluesmax.getvalues();
-    
-    std::vector<int> numcontribs(numnodes, 0);
-
     // Send the disjoint regions with same element type numbers together:
     disjointregionselector mydisjregselector(alldisjregsinmaxdim, {});
     for (int i = 0; i < mydisjregselector.countgroups(); i++)
@@ -111,15 +254,32 @@ void opestimator::estimatezienkiewiczzhu(void)
 
         // Evaluate at the corner nodes:
         int elementtypenumber = mydisjointregions->getelementtypenumber(mydisjregs[0]);
+        
+        // Get the elements to recompute:
+        std::vector<int> elemstoupdate = {};
+        for (int d = 0; d < mydisjregs.size(); d++)
+        {
+            int rb = mydisjointregions->getrangebegin(mydisjregs[d]);
+            int numelems = mydisjointregions->countelements(mydisjregs[d]);
+            for (int e = rb; e < rb+numelems; e++)
+            {
+                if (ischanged[elementtypenumber][e])
+                    elemstoupdate.push_back(e);
+            }
+        }
+        if (elemstoupdate.size() == 0)
+            continue;
     
         lagrangeformfunction mylagrange(elementtypenumber, 1, {});
         std::vector<double> evaluationpoints = mylagrange.getnodecoordinates();
         
         int nn = evaluationpoints.size()/3;
+        
+        double* nodalvals = mynodalvalues[elementtypenumber].getvalues();
 
         // Loop on all total orientations (if required):
         bool isorientationdependent = myarg->isvalueorientationdependent(mydisjregs);
-        elementselector myselector(mydisjregs, isorientationdependent);
+        elementselector myselector(mydisjregs, elemstoupdate, isorientationdependent);
         do
         {
             std::vector<int> elemnums = myselector.getelementnumbers();
@@ -132,14 +292,43 @@ void opestimator::estimatezienkiewiczzhu(void)
             
             for (int e = 0; e < elemnums.size(); e++)
             {
-                int curelem = elemnums[e];
+                for (int n = 0; n < nn; n++)
+                    nodalvals[elemnums[e]*nn+n] = interpvals[e*nn+n];
+            }
+        }
+        while (myselector.next());
+    }
+    
+    // Get the min and max value at every node. Each thread treats a range of elements of every type:
+    int numthreads = std::min((int)(numnodalvalues/10000)+1, universe::getmaxnumthreads()); // require a min work per thread
+    
+    std::vector<std::vector<double>> threadmin(numthreads), threadmax(numthreads);
+    std::vector<std::vector<int>> threadnumcontribs(numthreads);
+    
+    threadpool::run(numthreads, [&](int t)
+    {
+        std::vector<double> nvmin(numnodes), nvmax(numnodes);
+        std::vector<int> numcontribs(numnodes, 0);
+        
+        for (int j = 0; j < maxdimtypes.size(); j++)
+        {
+            int i = maxdimtypes[j];
+            int numelems = myelements->count(i);
+            int nn = mynodalvalues[i].countcolumns();
+            double* nodalvals = mynodalvalues[i].getvalues();
+            
+            int firstelem = (long long int)numelems*t/numthreads;
+            int lastelem = (long long int)numelems*(t+1)/numthreads;
+            
+            for (int e = firstelem; e < lastelem; e++)
+            {
                 for (int n = 0; n < nn; n++)
                 {
-                    int curnode = myelements->getsubelement(0, elementtypenumber, curelem, n);
-                    double curval = interpvals[e*nn+n];
+                    int curnode = myelements->getsubelement(0, i, e, n);
+                    double curval = nodalvals[e*nn+n];
                     
                     int numcont = numcontribs[curnode];
-                
+                    
                     if (numcont == 0 || curval < nvmin[curnode])
                         nvmin[curnode] = curval;
                     if (numcont == 0 || curval > nvmax[curnode])
@@ -149,38 +338,79 @@ void opestimator::estimatezienkiewiczzhu(void)
                 }
             }
         }
-        while (myselector.next());
-    }
+        
+        threadmin[t] = nvmin;
+        threadmax[t] = nvmax;
+        threadnumcontribs[t] = numcontribs;
+    });
+    
+    // Merge the thread contributions (in the first thread's containers):
+    std::vector<double>& nvmin = threadmin[0];
+    std::vector<double>& nvmax = threadmax[0];
+    std::vector<int>& numcontribs = threadnumcontribs[0];
+    threadpool::run(numthreads, [&](int t)
+    {
+        int firstnode = (long long int)numnodes*t/numthreads;
+        int lastnode = (long long int)numnodes*(t+1)/numthreads;
+        
+        for (int th = 1; th < numthreads; th++)
+        {
+            for (int n = firstnode; n < lastnode; n++)
+            {
+                if (threadnumcontribs[th][n] == 0)
+                    continue;
+                    
+                if (numcontribs[n] == 0 || threadmin[th][n] < nvmin[n])
+                    nvmin[n] = threadmin[th][n];
+                if (numcontribs[n] == 0 || threadmax[th][n] > nvmax[n])
+                    nvmax[n] = threadmax[th][n];
+                    
+                numcontribs[n] += threadnumcontribs[th][n];
+            }
+        }
+    });
     
     // Populate 'myvalue':
     std::shared_ptr<rawfield> rf = myvalue->getfieldpointer();
     std::shared_ptr<coefmanager> cm = rf->getcoefmanager();
     
-    for (int i = 0; i <= 7; i++)
+    for (int j = 0; j < maxdimtypes.size(); j++)
     {
+        int i = maxdimtypes[j];
         int numelems = myelements->count(i);
+        int nn = mynodalvalues[i].countcolumns();
         
-        element elem(i);
-        if (numelems == 0 || elem.getelementdimension() != problemdimension)
-            continue;
-    
-        int nn = elem.countnodes();
+        // Max error in every element:
+        std::vector<double> maxerrors(numelems);
+        threadpool::run(numthreads, [&](int t)
+        {
+            int firstelem = (long long int)numelems*t/numthreads;
+            int lastelem = (long long int)numelems*(t+1)/numthreads;
+            
+            for (int e = firstelem; e < lastelem; e++)
+            {
+                double curmaxerror = -1;
+                for (int n = 0; n < nn; n++)
+                {
+                    int curnode = myelements->getsubelement(0, i, e, n);
+                    double curerror = std::abs(nvmax[curnode]-nvmin[curnode]);
+                    if (curerror > curmaxerror)
+                        curmaxerror = curerror;
+                }
+                maxerrors[e] = curmaxerror;
+            }
+        });
     
         for (int e = 0; e < numelems; e++)
         {
             int curdisjreg = myelements->getdisjointregion(i, e);
             int rb = mydisjointregions->getrangebegin(curdisjreg);
-        
-            double curmaxerror = -1;
-            for (int n = 0; n < nn; n++)
-            {
-                int curnode = myelements->getsubelement(0, i, e, n);
-                double curerror = std::abs(nvmax[curnode]-nvmin[curnode]);
-                if (curerror > curmaxerror)
-                    curmaxerror = curerror;
-            }
             
-            cm->setcoef(curdisjreg, 0, e-rb, curmaxerror);
+            cm->setcoef(curdisjreg, 0, e-rb, maxerrors[e]);
         }
     }
+    
+    // The nodal values are only needed in incremental mode:
+    if (myisincremental == false)
+        mynodalvalues = {};
 }
@@ -9,6 +9,9 @@
 
 #include "operation.h"
 #include "opfield.h"
+#include "ptracker.h"
+#include "threadpool.h"
+#include <algorithm>
 
 class opfield;
 
@@ -27,9 +30,27 @@ class opestimator: public operation
         
         long long int mystatenumber = 0;
         
+        // In incremental mode the argument is only recomputed on the elements whose field coefficients have changed:
+        bool myisincremental = false;
+        
+        // Data of the last estimate for the incremental mode:
+        std::shared_ptr<ptracker> myptracker = NULL;
+        std::vector<double> mynodecoordinates = {};
+        std::vector<std::shared_ptr<rawfield>> myfields = {};
+        std::vector<std::vector<int>> myfieldorders = {};
+        // Coefficients of every field on every max dimension disjoint region ([field][disjreg]):
+        std::vector<std::vector<densematrix>> mycoefs = {};
+        // Argument value at the corner nodes of all max dimension elements (one row per element, one densematrix per type):
+        std::vector<densematrix> mynodalvalues = {};
+        
+        // Get all fields in 'op'. Returns false if 'op' depends on anything else than the field coefficients on the element:
+        bool getfields(std::shared_ptr<operation> op, std::vector<std::shared_ptr<rawfield>>& rfs);
+        // Get the elements whose field coefficients have changed since the last call ([type][element]):
+        std::vector<std::vector<bool>> getchangedelements(void);
+        
     public:
         
-        opestimator(std::string estimatortype, std::shared_ptr<operation> arg);
+        opestimator(std::string estimatortype, std::shared_ptr<operation> arg, bool isincremental = false);
         
         std::vector<std::vector<densematrix>> interpolate(elementselector& elemselect, std::vector<double>& evaluationcoordinates, expression* meshdeform);
         densematrix multiharmonicinterpolate(int numtimeevals, elementselector& elemselect, std::vector<double>& evaluationcoordinates, expression* meshdeform);
@@ -45,7 +66,7 @@ class opestimator: public operation
 
         void print(void);
         
-        // Update 'myvalue' with the estimate:
+        // Update 'myvalue' with the estimate (nodal values are gathered in parallel):
         void estimatezienkiewiczzhu(void);
 
 };
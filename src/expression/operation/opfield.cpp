@@ -187,6 +187,25 @@ bool opfield::isvalueorientationdependent(std::vector<int> disjregs)
     return false;
 }
 
+std::shared_ptr<operation> opfield::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    if (std::find(rfs.begin(), rfs.end(), myfield) == rfs.end())
+        return std::shared_ptr<operation>(new opconstant(0));
+    
+    // The direction is the dof of the field with the same derivatives applied:
+    std::shared_ptr<opdof> op(new opdof(myfield));
+    op->selectformfunctioncomponent(formfunctioncomponent);
+    op->setfieldcomponent(fieldcomponent);
+    if (spacederivative != 0)
+        op->setspacederivative(spacederivative);
+    if (kietaphiderivative != 0)
+        op->setkietaphiderivative(kietaphiderivative);
+    if (timederivativeorder != 0)
+        op->increasetimederivativeorder(timederivativeorder);
+    
+    return op;
+}
+
 std::shared_ptr<operation> opfield::copy(void)
 {
     std::shared_ptr<opfield> op(new opfield(myfield));
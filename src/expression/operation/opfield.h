@@ -59,6 +59,7 @@ class opfield: public operation
 
         bool isvalueorientationdependent(std::vector<int> disjregs);
 
+        std::shared_ptr<operation> derivative(std::vector<std::shared_ptr<rawfield>>& rfs);
         std::shared_ptr<operation> copy(void);
 
         std::vector<double> evaluate(std::vector<double>& xcoords, std::vector<double>& ycoords, std::vector<double>& zcoords);
@@ -54,6 +54,12 @@ std::shared_ptr<operation> opinversion::simplify(std::vector<int> disjregs)
         return shared_from_this();
 }
 
+std::shared_ptr<operation> opinversion::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    // d(1/a) = -da / a^2:
+    return chainrule(std::shared_ptr<operation>(new opproduct({std::shared_ptr<operation>(new opconstant(-1)), std::shared_ptr<operation>(new opinversion(std::shared_ptr<operation>(new opproduct({myarg, myarg}))))})), myarg->derivative(rfs));
+}
+
 std::shared_ptr<operation> opinversion::copy(void)
 {
     std::shared_ptr<opinversion> op(new opinversion(myarg));
@@ -54,6 +54,12 @@ std::shared_ptr<operation> oplog10::simplify(std::vector<int> disjregs)
         return shared_from_this();
 }
 
+std::shared_ptr<operation> oplog10::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    // d(log10(a)) = da / (ln(10) a):
+    return chainrule(std::shared_ptr<operation>(new opinversion(std::shared_ptr<operation>(new opproduct({std::shared_ptr<operation>(new opconstant(std::log(10.0))), myarg})))), myarg->derivative(rfs));
+}
+
 std::shared_ptr<operation> oplog10::copy(void)
 {
     std::shared_ptr<oplog10> op(new oplog10(myarg));
@@ -54,6 +54,12 @@ std::shared_ptr<operation> opmod::simplify(std::vector<int> disjregs)
         return shared_from_this();
 }
 
+std::shared_ptr<operation> opmod::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    // The modulo is a shift by a piecewise constant:
+    return myarg->derivative(rfs);
+}
+
 std::shared_ptr<operation> opmod::copy(void)
 {
     std::shared_ptr<opmod> op(new opmod(myarg, mymodval));
@@ -60,6 +60,14 @@ bool opparameter::isvalueorientationdependent(std::vector<int> disjregs)
     return false;
 }
 
+std::shared_ptr<operation> opparameter::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    if (not(myparameter->isfieldincluded(rfs)))
+        return std::shared_ptr<operation>(new opconstant(0));
+        
+    return myparameter->derivative(myrow, mycolumn, rfs);
+}
+
 std::shared_ptr<operation> opparameter::copy(void)
 {
     std::shared_ptr<opparameter> op(new opparameter(myparameter, myrow, mycolumn));
@@ -43,6 +43,7 @@ class opparameter: public operation
         std::shared_ptr<operation> simplify(std::vector<int> disjregs);
         bool isvalueorientationdependent(std::vector<int> disjregs);
         
+        std::shared_ptr<operation> derivative(std::vector<std::shared_ptr<rawfield>>& rfs);
         std::shared_ptr<operation> copy(void);
         
         void print(void);
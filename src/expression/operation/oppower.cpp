@@ -58,6 +58,36 @@ std::shared_ptr<operation> oppower::simplify(std::vector<int> disjregs)
         return shared_from_this();
 }
 
+std::shared_ptr<operation> oppower::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    std::shared_ptr<operation> dbase = mybase->derivative(rfs);
+    std::shared_ptr<operation> dexponent = myexponent->derivative(rfs);
+    
+    // d(a^b) = b a^(b-1) da + a^b ln(a) db:
+    std::shared_ptr<opsum> op(new opsum);
+    if (not(dbase->iszero()))
+    {
+        std::shared_ptr<operation> exponentminusone;
+        if (myexponent->isconstant())
+            exponentminusone = std::shared_ptr<operation>(new opconstant(myexponent->getvalue()-1));
+        else
+            exponentminusone = std::shared_ptr<operation>(new opsum({myexponent, std::shared_ptr<operation>(new opconstant(-1))}));
+        
+        op->addterm(std::shared_ptr<operation>(new opproduct({myexponent, std::shared_ptr<operation>(new oppower(mybase, exponentminusone)), dbase})));
+    }
+    if (not(dexponent->iszero()))
+    {
+        std::shared_ptr<operation> lnbase(new opproduct({std::shared_ptr<operation>(new opconstant(std::log(10.0))), std::shared_ptr<operation>(new oplog10(mybase))}));
+        op->addterm(std::shared_ptr<operation>(new opproduct({shared_from_this(), lnbase, dexponent})));
+    }
+    
+    if (op->count() == 0)
+        return std::shared_ptr<operation>(new opconstant(0));
+    if (op->count() == 1)
+        return op->getargument(0);
+    return op;
+}
+
 std::shared_ptr<operation> oppower::copy(void)
 {
     std::shared_ptr<oppower> op(new oppower(mybase, myexponent));
@@ -239,6 +239,33 @@ std::shared_ptr<operation> opproduct::simplify(std::vector<int> disjregs)
     return shared_from_this();
 }
 
+std::shared_ptr<operation> opproduct::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    // Product rule:
+    std::shared_ptr<opsum> op(new opsum);
+    for (int i = 0; i < productterms.size(); i++)
+    {
+        std::shared_ptr<operation> curderivative = productterms[i]->derivative(rfs);
+        if (curderivative->iszero())
+            continue;
+        
+        std::shared_ptr<opproduct> curterm(new opproduct);
+        for (int j = 0; j < productterms.size(); j++)
+        {
+            if (j != i)
+                curterm->multiplybyterm(productterms[j]);
+        }
+        curterm->multiplybyterm(curderivative);
+        op->addterm(curterm);
+    }
+    
+    if (op->count() == 0)
+        return std::shared_ptr<operation>(new opconstant(0));
+    if (op->count() == 1)
+        return op->getargument(0);
+    return op;
+}
+
 std::shared_ptr<operation> opproduct::copy(void)
 {
     std::shared_ptr<opproduct> op(new opproduct);
@@ -54,6 +54,12 @@ std::shared_ptr<operation> opsin::simplify(std::vector<int> disjregs)
         return shared_from_this();
 }
 
+std::shared_ptr<operation> opsin::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    // d(sin(a)) = cos(a) da:
+    return chainrule(std::shared_ptr<operation>(new opcos(myarg)), myarg->derivative(rfs));
+}
+
 std::shared_ptr<operation> opsin::copy(void)
 {
     std::shared_ptr<opsin> op(new opsin(myarg));
@@ -144,6 +144,23 @@ std::shared_ptr<operation> opsum::simplify(std::vector<int> disjregs)
     return shared_from_this();
 }
 
+std::shared_ptr<operation> opsum::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    std::shared_ptr<opsum> op(new opsum);
+    for (int i = 0; i < sumterms.size(); i++)
+    {
+        std::shared_ptr<operation> curderivative = sumterms[i]->derivative(rfs);
+        if (not(curderivative->iszero()))
+            op->addterm(curderivative);
+    }
+    
+    if (op->count() == 0)
+        return std::shared_ptr<operation>(new opconstant(0));
+    if (op->count() == 1)
+        return op->getargument(0);
+    return op;
+}
+
 std::shared_ptr<operation> opsum::copy(void)
 {
     std::shared_ptr<opsum> op(new opsum);
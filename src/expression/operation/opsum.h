@@ -42,6 +42,7 @@ class opsum: public operation
         void group(void);
         std::shared_ptr<operation> simplify(std::vector<int> disjregs);
 
+        std::shared_ptr<operation> derivative(std::vector<std::shared_ptr<rawfield>>& rfs);
         std::shared_ptr<operation> copy(void);
         
         void reuseit(bool istobereused) { reuse = istobereused; };
@@ -54,6 +54,12 @@ std::shared_ptr<operation> optan::simplify(std::vector<int> disjregs)
         return shared_from_this();
 }
 
+std::shared_ptr<operation> optan::derivative(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    // d(tan(a)) = da / cos(a)^2:
+    return chainrule(std::shared_ptr<operation>(new opinversion(std::shared_ptr<operation>(new opproduct({std::shared_ptr<operation>(new opcos(myarg)), std::shared_ptr<operation>(new opcos(myarg))})))), myarg->derivative(rfs));
+}
+
 std::shared_ptr<operation> optan::copy(void)
 {
     std::shared_ptr<optan> op(new optan(myarg));
@@ -4,6 +4,7 @@
 #include "rawsurface.h"
 #include "rawvolume.h"
 #include "slmpi.h"
+#include "andersonacceleration.h"
 
 
 int sl::getversion(void)
@@ -194,20 +195,54 @@ std::vector<double> sl::loadvector(std::string filename, char delimiter, bool si
     return output;
 }
 
+std::string sl::allpartition(std::string meshfile, std::vector<int> physregs, std::vector<int> orders)
+{
+    if (physregs.size() != orders.size())
+    {
+        std::cout << "Error in 'sl' namespace: expected one order per physical region to weight the partition" << std::endl;
+        abort();
+    }
+    
+    if (slmpi::count() == 1)
+        return meshfile;
+    
+    universe::partitionweights = {physregs, orders};
+    
+    // The partitioning is done in memory when loading the mesh:
+    universe::partitionnextmesh = true;
+    return meshfile;
+}
+
 #ifndef HAVE_GMSH
-std::string sl::allpartition(std::string meshfile)
+std::string sl::allpartition(std::string meshfile, std::string partitioner)
 {
+    if (partitioner == "metis")
+        return allpartition(meshfile);
+    if (partitioner != "gmsh")
+    {
+        std::cout << "Error in 'sl' namespace: unknown partitioner '" << partitioner << "' (use 'metis' or 'gmsh')" << std::endl;
+        abort();
+    }
+    
     if (slmpi::count() == 1)
         return meshfile;
     
-    std::cout << "Error in 'sl' namespace: GMSH API is required to partition the mesh" << std::endl;
+    std::cout << "Error in 'sl' namespace: GMSH API is required to partition the mesh with GMSH" << std::endl;
     abort();
 }
 #endif
 #ifdef HAVE_GMSH
 #include "gmsh.h"
-std::string sl::allpartition(std::string meshfile)
+std::string sl::allpartition(std::string meshfile, std::string partitioner)
 {
+    if (partitioner == "metis")
+        return allpartition(meshfile);
+    if (partitioner != "gmsh")
+    {
+        std::cout << "Error in 'sl' namespace: unknown partitioner '" << partitioner << "' (use 'metis' or 'gmsh')" << std::endl;
+        abort();
+    }
+    
     int rank = slmpi::getrank();
     int numranks = slmpi::count();
     
@@ -620,6 +655,26 @@ std::vector<double> sl::printtotalforce(int physreg, expression meshdeform, expr
 
 void sl::setphysicalregionshift(int shiftamount) { universe::physregshift = shiftamount; }
 
+void sl::setmeshrenumbering(std::string curvetype)
+{
+    if (curvetype != "hilbert" && curvetype != "morton" && curvetype != "none")
+    {
+        std::cout << "Error in 'sl' namespace: unknown mesh renumbering '" << curvetype << "' (use 'hilbert', 'morton' or 'none')" << std::endl;
+        abort();
+    }
+    universe::meshrenumbering = curvetype;
+}
+
+void sl::setsumfactorization(int minorder)
+{
+    if (minorder < -1)
+    {
+        std::cout << "Error in 'sl' namespace: expected an interpolation order of at least 0 or -1 to never use sum factorization" << std::endl;
+        abort();
+    }
+    universe::sumfactorizationorder = minorder;
+}
+
 void sl::writeshapefunctions(std::string filename, std::string sftypename, int elementtypenumber, int maxorder, bool allorientations)
 {
     if (elementtypenumber == 7)
@@ -1330,7 +1385,7 @@ bool sl::adapt(int verbosity)
     return universe::mymesh->adapthp(verbosity);
 }
 
-expression sl::zienkiewiczzhu(expression input)
+expression sl::zienkiewiczzhu(expression input, bool isincremental)
 {
     std::vector<int> alldisjregs(universe::mymesh->getdisjointregions()->count());
     std::iota(alldisjregs.begin(), alldisjregs.end(), 0);
@@ -1352,7 +1407,7 @@ expression sl::zienkiewiczzhu(expression input)
                 zzexprs[i*n+j] = 0;
             else
             {
-                std::shared_ptr<opestimator> op(new opestimator("zienkiewiczzhu", input.getoperationinarray(i,j)));
+                std::shared_ptr<opestimator> op(new opestimator("zienkiewiczzhu", input.getoperationinarray(i,j), isincremental));
                 zzexprs[i*n+j] = expression(op);
             }
         }
@@ -1407,11 +1462,11 @@ expression sl::array3x3(expression term11, expression term12, expression term13,
     return expression(3,3, {term11, term12, term13, term21, term22, term23, term31, term32, term33});
 }
 
-vec sl::solve(mat A, vec b, std::string soltype, bool diagscaling)
+vec sl::solve(mat A, vec b, std::string soltype, bool diagscaling, double refinementtol, int maxrefinementits)
 {
-    if (soltype != "lu" && soltype != "cholesky")
+    if (soltype != "lu" && soltype != "cholesky" && soltype != "mixedlu")
     {
-        std::cout << "Error in 'sl' namespace: unknown direct solver type '" << soltype << "' (use 'lu' or 'cholesky')" << std::endl;
+        std::cout << "Error in 'sl' namespace: unknown direct solver type '" << soltype << "' (use 'lu', 'cholesky' or 'mixedlu')" << std::endl;
         abort();
     }
     if (A.countrows() != b.size())
@@ -1425,6 +1480,11 @@ vec sl::solve(mat A, vec b, std::string soltype, bool diagscaling)
         std::cout << "Error in 'sl' namespace: direct solve of Ax = b failed (A or b is undefined)" << std::endl;
         abort();
     }
+    if (soltype == "mixedlu" && (refinementtol <= 0 || maxrefinementits < 1))
+    {
+        std::cout << "Error in 'sl' namespace: mixedlu refinement tolerance must be positive and at least one refinement iteration is required" << std::endl;
+        abort();
+    }
     
     vec breduced = A.eliminate(b);
     
@@ -1445,19 +1505,66 @@ vec sl::solve(mat A, vec b, std::string soltype, bool diagscaling)
         // This modifies the matrix A and right handside b!
         if (diagscaling == true)
             KSPSetDiagonalScale(*ksp, PETSC_TRUE);
-        KSPSetFromOptions(*ksp);
+        // Keep what is needed to undo the scaling of A in case the mixedlu refinement falls back to a double precision factorization:
+        if (diagscaling == true && soltype == "mixedlu")
+        {
+            Vec* scalingvec = A.getpointer()->getdiagscaling();
+            if (*scalingvec != PETSC_NULL)
+                VecDestroy(scalingvec);
+            MatCreateVecs(Apetsc, scalingvec, PETSC_NULL);
+            MatGetDiagonal(Apetsc, *scalingvec);
+            VecSqrtAbs(*scalingvec);
+        }
 
         KSPGetPC(*ksp,&pc);
-        if (soltype == "lu")
+        if (soltype == "lu" || soltype == "mixedlu")
             PCSetType(pc,PCLU);
         if (soltype == "cholesky")
             PCSetType(pc,PCCHOLESKY);
         PCFactorSetMatSolverType(pc,MATSOLVERMUMPS);
+        
+        // The factorization is only accurate to single precision. The double precision
+        // accuracy is recovered by a gmres iterative refinement on the double precision matrix:
+        if (soltype == "mixedlu")
+        {
+            KSPSetType(*ksp, KSPGMRES);
+            KSPSetTolerances(*ksp, refinementtol, PETSC_DEFAULT, PETSC_DEFAULT, maxrefinementits);
+            
+            Mat F;
+            PCFactorSetUpMatSolverType(pc);
+            PCFactorGetMatrix(pc, &F);
+            // Block low-rank compression with a single precision dropping threshold:
+            MatMumpsSetIcntl(F, 35, 2);
+            MatMumpsSetCntl(F, 7, 1e-7);
+        }
+        
+        // Command line options override the settings above:
+        KSPSetFromOptions(*ksp);
     }
 
     KSPSolve(*ksp, bpetsc, solpetsc);
 
     A.getpointer()->isfactored(true);
+    
+    // Fall back to a full double precision factorization if the refinement stalled:
+    if (soltype == "mixedlu")
+    {
+        KSPConvergedReason reason;
+        KSPGetConvergedReason(*ksp, &reason);
+        if (reason < 0)
+        {
+            KSPDestroy(ksp);
+            A.getpointer()->isfactored(false);
+            // The fallback must not scale an already scaled matrix:
+            Vec* scalingvec = A.getpointer()->getdiagscaling();
+            if (*scalingvec != PETSC_NULL)
+            {
+                MatDiagonalScale(Apetsc, *scalingvec, *scalingvec);
+                VecDestroy(scalingvec);
+            }
+            return solve(A, b, "lu", diagscaling);
+        }
+    }
 
     if (A.getpointer()->isfactorizationreuseallowed() == false)
     {
@@ -1468,6 +1575,211 @@ vec sl::solve(mat A, vec b, std::string soltype, bool diagscaling)
     return A.xbmerge(sol, b);
 }
 
+vec sl::condensedsolve(mat A, vec b, std::string soltype)
+{
+    if (soltype != "lu" && soltype != "cholesky")
+    {
+        std::cout << "Error in 'sl' namespace: unknown direct solver type '" << soltype << "' (use 'lu' or 'cholesky')" << std::endl;
+        abort();
+    }
+    if (A.getpointer() == NULL || b.getpointer() == NULL)
+    {
+        std::cout << "Error in 'sl' namespace: condensed solve of Ax = b failed (A or b is undefined)" << std::endl;
+        abort();
+    }
+    if (A.countrows() != b.size())
+    {
+        std::cout << "Error in 'sl' namespace: condensed solve of Ax = b failed (size of A and b do not match)" << std::endl;
+        abort();
+    }
+    
+    vec breduced = A.eliminate(b);
+    Mat Apetsc = A.getapetsc();
+    
+    intdensematrix ainds = A.getainds();
+    int* aindsptr = ainds.getvalues();
+    int na = ainds.count();
+    
+    // Element interior of every unconstrained dof (-1 if none):
+    std::vector<int> interiorelems = A.getpointer()->getdofmanager()->getinteriorelements();
+    std::vector<int> blockof(na);
+    int numelems = 0;
+    for (int i = 0; i < na; i++)
+    {
+        blockof[i] = interiorelems[aindsptr[i]];
+        numelems = std::max(numelems, blockof[i]+1);
+    }
+    
+    // Interior dofs coupled to the interior of another element (e.g. by a dof interpolation) are kept in the condensed system:
+    std::vector<bool> iscoupled(numelems, false);
+    for (int i = 0; i < na; i++)
+    {
+        if (blockof[i] == -1)
+            continue;
+        
+        PetscInt ncols; const PetscInt* cols;
+        MatGetRow(Apetsc, i, &ncols, &cols, PETSC_NULL);
+        for (int j = 0; j < ncols; j++)
+        {
+            int colblock = blockof[cols[j]];
+            if (colblock != -1 && colblock != blockof[i])
+            {
+                iscoupled[blockof[i]] = true;
+                iscoupled[colblock] = true;
+            }
+        }
+        MatRestoreRow(Apetsc, i, &ncols, &cols, PETSC_NULL);
+    }
+    
+    // Interior dofs of every uncoupled element:
+    std::vector<std::vector<PetscInt>> blockdofs(numelems);
+    for (int i = 0; i < na; i++)
+    {
+        if (blockof[i] != -1 && not(iscoupled[blockof[i]]))
+            blockdofs[blockof[i]].push_back(i);
+    }
+    
+    // Local inversion of the interior block of every element. Singular blocks
+    // (e.g. Hcurl curl-curl bubbles without a gauge) are kept in the condensed system:
+    std::vector<densematrix> blockinverses(numelems);
+    for (int e = 0; e < numelems; e++)
+    {
+        int bs = blockdofs[e].size();
+        if (bs == 0)
+            continue;
+        
+        densematrix block(bs, bs);
+        MatGetValues(Apetsc, bs, blockdofs[e].data(), bs, blockdofs[e].data(), block.getvalues());
+        
+        bool issingular;
+        blockinverses[e] = block.getinverse(issingular);
+        if (issingular)
+        {
+            blockdofs[e] = {};
+            blockinverses[e] = densematrix();
+        }
+    }
+    
+    // Interior dofs sorted by element and remaining dofs:
+    std::vector<PetscInt> iinds = {}, binds = {};
+    std::vector<bool> isinterior(na, false);
+    for (int e = 0; e < numelems; e++)
+    {
+        for (int j = 0; j < blockdofs[e].size(); j++)
+        {
+            iinds.push_back(blockdofs[e][j]);
+            isinterior[blockdofs[e][j]] = true;
+        }
+    }
+    for (int i = 0; i < na; i++)
+    {
+        if (not(isinterior[i]))
+            binds.push_back(i);
+    }
+    int ni = iinds.size(), nb = binds.size();
+    
+    // Nothing to condense:
+    if (ni == 0)
+        return sl::solve(A, b, soltype);
+    
+    IS isi, isb;
+    ISCreateGeneral(PETSC_COMM_SELF, ni, iinds.data(), PETSC_USE_POINTER, &isi);
+    ISCreateGeneral(PETSC_COMM_SELF, nb, binds.data(), PETSC_USE_POINTER, &isb);
+    
+    Mat Aib, Abi, Abb;
+    MatCreateSubMatrix(Apetsc, isi, isb, MAT_INITIAL_MATRIX, &Aib);
+    MatCreateSubMatrix(Apetsc, isb, isi, MAT_INITIAL_MATRIX, &Abi);
+    MatCreateSubMatrix(Apetsc, isb, isb, MAT_INITIAL_MATRIX, &Abb);
+    
+    std::vector<PetscInt> nnz(ni);
+    for (int e = 0, row = 0; e < numelems; e++)
+    {
+        int bs = blockdofs[e].size();
+        for (int r = 0; r < bs; r++)
+            nnz[row+r] = bs;
+        row += bs;
+    }
+    Mat Aiiinv;
+    MatCreateSeqAIJ(PETSC_COMM_SELF, ni, ni, 0, nnz.data(), &Aiiinv);
+    std::vector<PetscInt> cols;
+    for (int e = 0, offset = 0; e < numelems; e++)
+    {
+        int bs = blockdofs[e].size();
+        if (bs == 0)
+            continue;
+        cols.resize(bs);
+        for (int c = 0; c < bs; c++)
+            cols[c] = offset + c;
+        // The inverse is row-major:
+        MatSetValues(Aiiinv, bs, cols.data(), bs, cols.data(), blockinverses[e].getvalues(), INSERT_VALUES);
+        offset += bs;
+    }
+    MatAssemblyBegin(Aiiinv, MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd(Aiiinv, MAT_FINAL_ASSEMBLY);
+    
+    // Schur complement S = Abb - Abi * Aii^-1 * Aib:
+    Mat X, S;
+    MatMatMult(Aiiinv, Aib, MAT_INITIAL_MATRIX, PETSC_DEFAULT, &X);
+    MatMatMult(Abi, X, MAT_INITIAL_MATRIX, PETSC_DEFAULT, &S);
+    MatScale(S, -1);
+    MatAXPY(S, 1, Abb, DIFFERENT_NONZERO_PATTERN);
+    
+    // Condensed right handside bb - Abi * Aii^-1 * bi:
+    Vec bpetsc = breduced.getpetsc();
+    Vec bi, bb, yi, xb, bschur;
+    VecGetSubVector(bpetsc, isi, &bi);
+    VecGetSubVector(bpetsc, isb, &bb);
+    VecDuplicate(bi, &yi);
+    VecDuplicate(bb, &bschur);
+    VecDuplicate(bb, &xb);
+    MatMult(Aiiinv, bi, yi);
+    MatMult(Abi, yi, bschur);
+    VecAYPX(bschur, -1, bb);
+    
+    KSP ksp;
+    PC pc;
+    KSPCreate(PETSC_COMM_SELF, &ksp);
+    KSPSetOperators(ksp, S, S);
+    KSPSetType(ksp, KSPPREONLY);
+    KSPGetPC(ksp, &pc);
+    if (soltype == "lu")
+        PCSetType(pc, PCLU);
+    if (soltype == "cholesky")
+        PCSetType(pc, PCCHOLESKY);
+    PCFactorSetMatSolverType(pc, MATSOLVERMUMPS);
+    KSPSetFromOptions(ksp);
+    KSPSolve(ksp, bschur, xb);
+    KSPDestroy(&ksp);
+    
+    // Back-substitution xi = Aii^-1 * bi - X * xb:
+    Vec xi;
+    VecDuplicate(bi, &xi);
+    MatMult(X, xb, xi);
+    VecAYPX(xi, -1, yi);
+    
+    VecRestoreSubVector(bpetsc, isi, &bi);
+    VecRestoreSubVector(bpetsc, isb, &bb);
+    
+    vec sol(std::shared_ptr<rawvec>(new rawvec(breduced.getpointer()->getdofmanager())));
+    Vec solpetsc = sol.getpetsc();
+    const PetscScalar *xivals, *xbvals;
+    VecGetArrayRead(xi, &xivals);
+    VecGetArrayRead(xb, &xbvals);
+    VecSetValues(solpetsc, ni, iinds.data(), xivals, INSERT_VALUES);
+    VecSetValues(solpetsc, nb, binds.data(), xbvals, INSERT_VALUES);
+    VecRestoreArrayRead(xi, &xivals);
+    VecRestoreArrayRead(xb, &xbvals);
+    VecAssemblyBegin(solpetsc);
+    VecAssemblyEnd(solpetsc);
+    
+    VecDestroy(&yi); VecDestroy(&bschur); VecDestroy(&xb); VecDestroy(&xi);
+    MatDestroy(&Aib); MatDestroy(&Abi); MatDestroy(&Abb);
+    MatDestroy(&Aiiinv); MatDestroy(&X); MatDestroy(&S);
+    ISDestroy(&isi); ISDestroy(&isb);
+    
+    return A.xbmerge(sol, b);
+}
+
 std::vector<vec> sl::solve(mat A, std::vector<vec> b, std::string soltype)
 {
     if (soltype != "lu" && soltype != "cholesky")
@@ -1696,22 +2008,485 @@ void sl::solve(formulation formul, std::string soltype, std::vector<int> blockst
     setdata(sol);
 }
 
+void sl::condensedsolve(formulation formul, std::string soltype)
+{
+    if (formul.isdampingmatrixdefined() || formul.ismassmatrixdefined())
+    {
+        std::cout << "Error in 'sl' namespace: formulation to solve cannot have a damping/mass matrix (use a time resolution algorithm)" << std::endl;
+        abort();  
+    }
+    
+    // Remove leftovers (if any):
+    mat A = formul.A(); vec b = formul.b(false, false);
+    // Generate:
+    formul.generate();
+    // Solve:
+    vec sol = sl::condensedsolve(formul.A(), formul.b(), soltype);
+
+    // Save to fields:
+    setdata(sol);
+}
+
 void sl::solve(std::vector<formulation> formuls, std::string soltype)
 {
     for (int i = 0; i < formuls.size(); i++)
         solve(formuls[i], soltype);
 }
 
+int sl::solvenonlinear(formulation formul, double tol, int maxnumit, int depth, double relaxationfactor, std::string soltype, int verbosity)
+{
+    if (formul.isdampingmatrixdefined() || formul.ismassmatrixdefined())
+    {
+        std::cout << "Error in 'sl' namespace: formulation to solve cannot have a damping/mass matrix (use a time resolution algorithm)" << std::endl;
+        abort();  
+    }
+    
+    // Remove leftovers (if any):
+    mat A = formul.A(); vec b = formul.b(false, false);
+    
+    // Initial solution from the current field values:
+    vec x(formul);
+    x.setdata();
+    
+    andersonacceleration accelerator(depth, relaxationfactor);
+    
+    double relchange = 1; int nlit = 0;
+    while (relchange > tol && (maxnumit <= 0 || nlit < maxnumit))
+    {
+        formul.generate();
+        vec gx = sl::solve(formul.A(), formul.b(), soltype);
+        
+        vec xnext = accelerator.next(x, gx);
+        // The Dirichlet constraints are imposed exactly:
+        intdensematrix constraintindexes = formul.getdofmanager()->getconstrainedindexes();
+        xnext.getpointer()->setvalues(constraintindexes, gx.getpointer()->getvalues(constraintindexes));
+        
+        // Use the absolute change if the iterate is zero:
+        double xnextnorm = xnext.norm();
+        relchange = (xnext-x).norm();
+        if (xnextnorm > 0)
+            relchange /= xnextnorm;
+        
+        x = xnext;
+        setdata(x);
+        
+        if (verbosity > 1)
+            std::cout << relchange << " " << std::flush;
+        
+        nlit++;
+    }
+    
+    if (verbosity > 0)
+        std::cout << "(" << nlit << "NL it) " << std::flush;
+    
+    return nlit;
+}
+
+void sl::distributedsolve(formulation formul, std::string soltype, double relrestol, int maxnumit, std::string precondtype, int verbosity)
+{
+    // Make sure the problem is of the form Ax = b:
+    if (formul.isdampingmatrixdefined() || formul.ismassmatrixdefined())
+    {
+        std::cout << "Error in 'sl' namespace: formulation to solve cannot have a damping/mass matrix (use a time resolution algorithm)" << std::endl;
+        abort();  
+    }
+    bool isdirect = (soltype == "lu" || soltype == "cholesky");
+    if (isdirect == false && soltype != "gmres" && soltype != "bicgstab")
+    {
+        std::cout << "Error in 'sl' namespace: unknown distributed solver type '" << soltype << "' (use 'lu', 'cholesky', 'gmres' or 'bicgstab')" << std::endl;
+        abort();
+    }
+    if (precondtype != "bjacobi" && precondtype != "asm" && precondtype != "gamg")
+    {
+        std::cout << "Error in 'sl' namespace: unknown distributed preconditioner type '" << precondtype << "' (use 'bjacobi', 'asm' or 'gamg')" << std::endl;
+        abort();
+    }
+    
+    wallclock clktot;
+    
+    int rank = slmpi::getrank();
+    int numranks = slmpi::count();
+    
+    if (numranks == 1 && isdirect)
+    {
+        solve(formul, soltype);
+        return;
+    }
+    
+    std::shared_ptr<dofmanager> dm = formul.getdofmanager();
+    std::shared_ptr<dtracker> dt = universe::mymesh->getdtracker();
+    int numneighbours = 0;
+    std::vector<int> neighbours = {};
+    std::vector<std::vector<intdensematrix>> dcdata(4);
+    
+    if (numranks > 1)
+    {
+        if (dt->isoverlap())
+        {
+            std::cout << "Error in 'sl' namespace: distributed solve requires a no-overlap mesh partition" << std::endl;
+            abort();
+        }
+        numneighbours = dt->countneighbours();
+        neighbours = dt->getneighbours();
+    
+        // Get the dofs shared with each neighbour (in the same order on both sides):
+        std::vector<intdensematrix> sendinds, recvinds;
+        mapdofs(dm, dm->getfields(), {true, true, true}, sendinds, recvinds);
+        
+        // A dof constrained on any rank is constrained on all ranks:
+        dcdata = dm->discovernewconstraints(neighbours, sendinds, recvinds);
+    }
+    
+    formul.generate();
+    mat A = formul.getmatrix(0, false, dcdata[1]);
+    vec b = formul.b();
+    
+    // Set the value from the neighbour Dirichlet conditions:
+    std::vector<densematrix> dirichletvalsforneighbours(numneighbours), dirichletvalsfromneighbours(numneighbours);
+    for (int n = 0; n < numneighbours; n++)
+    {
+        dirichletvalsforneighbours[n] = b.getvalues(dcdata[0][n]);
+        dirichletvalsfromneighbours[n] = densematrix(dcdata[1][n].count(), 1);
+    }
+    exchange(neighbours, dirichletvalsforneighbours, dirichletvalsfromneighbours);
+    for (int n = 0; n < numneighbours; n++)
+        b.setvalues(dcdata[1][n], dirichletvalsfromneighbours[n]);
+    
+    // Position of every unconstrained dof in A:
+    intdensematrix ainds = A.getainds();
+    int na = ainds.count();
+    int* aindsptr = ainds.getvalues();
+    std::vector<int> posina(dm->countdofs(), -1);
+    for (int i = 0; i < na; i++)
+        posina[aindsptr[i]] = i;
+    
+    // The dofs shared with lower ranks are owned by these ranks:
+    std::vector<bool> isowned(na, true);
+    for (int n = 0; n < numneighbours; n++)
+    {
+        if (neighbours[n] > rank)
+            continue;
+        int* recvptr = dcdata[3][n].getvalues();
+        for (int i = 0; i < dcdata[3][n].count(); i++)
+            isowned[posina[recvptr[i]]] = false;
+    }
+    int numowned = 0;
+    for (int i = 0; i < na; i++)
+        numowned += isowned[i];
+    
+    std::vector<int> fragment = {numowned}, numownedinranks(numranks);
+    slmpi::allgather(fragment, numownedinranks);
+    int ownedbegin = 0;
+    for (int r = 0; r < rank; r++)
+        ownedbegin += numownedinranks[r];
+    
+    // Global number of all unconstrained dofs (the owners send the number of the shared dofs):
+    std::vector<PetscInt> globalinds(na, -1);
+    int curowned = 0;
+    for (int i = 0; i < na; i++)
+    {
+        if (isowned[i])
+        {
+            globalinds[i] = ownedbegin + curowned;
+            curowned++;
+        }
+    }
+    std::vector<std::vector<int>> globalindsforneighbours(numneighbours), globalindsfromneighbours(numneighbours);
+    for (int n = 0; n < numneighbours; n++)
+    {
+        int* sendptr = dcdata[2][n].getvalues();
+        globalindsforneighbours[n] = std::vector<int>(dcdata[2][n].count());
+        for (int i = 0; i < dcdata[2][n].count(); i++)
+            globalindsforneighbours[n][i] = globalinds[posina[sendptr[i]]];
+        globalindsfromneighbours[n] = std::vector<int>(dcdata[3][n].count());
+    }
+    slmpi::exchange(neighbours, globalindsforneighbours, globalindsfromneighbours);
+    for (int n = 0; n < numneighbours; n++)
+    {
+        int* recvptr = dcdata[3][n].getvalues();
+        for (int i = 0; i < dcdata[3][n].count(); i++)
+        {
+            int pos = posina[recvptr[i]];
+            globalinds[pos] = std::max(globalinds[pos], (PetscInt)globalindsfromneighbours[n][i]);
+        }
+    }
+    
+    // Add the matrix of every rank to the global parallel matrix. The contributions to rows 
+    // owned by another rank are communicated by PETSc during the assembly:
+    wallclock clkassembly;
+    
+    Mat Apetsc = A.getapetsc();
+    
+    std::vector<PetscInt> dnnz(numowned, 0), onnz(numowned, 0);
+    for (int i = 0; i < na; i++)
+    {
+        if (isowned[i] == false)
+            continue;
+        int localrow = globalinds[i]-ownedbegin;
+        
+        PetscInt ncols; const PetscInt* cols;
+        MatGetRow(Apetsc, i, &ncols, &cols, PETSC_NULL);
+        for (int j = 0; j < ncols; j++)
+        {
+            if (isowned[cols[j]])
+                dnnz[localrow]++;
+            else
+                onnz[localrow]++;
+        }
+        MatRestoreRow(Apetsc, i, &ncols, &cols, PETSC_NULL);
+    }
+    
+    Mat Aglobal;
+    MatCreateAIJ(PETSC_COMM_WORLD, numowned, numowned, PETSC_DETERMINE, PETSC_DETERMINE, 0, dnnz.data(), 0, onnz.data(), &Aglobal);
+    // The preallocation above ignores the contributions from the neighbours on the shared rows:
+    MatSetOption(Aglobal, MAT_NEW_NONZERO_ALLOCATION_ERR, PETSC_FALSE);
+    
+    std::vector<PetscInt> globalcols(na);
+    for (int i = 0; i < na; i++)
+    {
+        PetscInt ncols; const PetscInt* cols; const PetscScalar* vals;
+        MatGetRow(Apetsc, i, &ncols, &cols, &vals);
+        for (int j = 0; j < ncols; j++)
+            globalcols[j] = globalinds[cols[j]];
+        MatSetValues(Aglobal, 1, &globalinds[i], ncols, globalcols.data(), vals, ADD_VALUES);
+        MatRestoreRow(Apetsc, i, &ncols, &cols, &vals);
+    }
+    MatAssemblyBegin(Aglobal, MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd(Aglobal, MAT_FINAL_ASSEMBLY);
+    
+    // Same for the right handside (Dirichlet contributions are eliminated on every rank):
+    vec breduced = A.eliminate(b);
+    densematrix bvals = breduced.getallvalues();
+    
+    Vec bglobal, solglobal;
+    VecCreateMPI(PETSC_COMM_WORLD, numowned, PETSC_DETERMINE, &bglobal);
+    VecSetValues(bglobal, na, globalinds.data(), bvals.getvalues(), ADD_VALUES);
+    VecAssemblyBegin(bglobal);
+    VecAssemblyEnd(bglobal);
+    VecDuplicate(bglobal, &solglobal);
+    
+    if (verbosity > 1 && rank == 0)
+        clkassembly.print("Distributed matrix assembled in");
+    
+    // Solve in parallel:
+    KSP ksp;
+    PC pc;
+    KSPCreate(PETSC_COMM_WORLD, &ksp);
+    KSPSetOperators(ksp, Aglobal, Aglobal);
+    KSPGetPC(ksp, &pc);
+    if (isdirect)
+    {
+        KSPSetType(ksp, KSPPREONLY);
+        if (soltype == "lu")
+            PCSetType(pc, PCLU);
+        if (soltype == "cholesky")
+            PCSetType(pc, PCCHOLESKY);
+        PCFactorSetMatSolverType(pc, MATSOLVERMUMPS);
+    }
+    else
+    {
+        if (soltype == "gmres")
+            KSPSetType(ksp, KSPGMRES);
+        if (soltype == "bicgstab")
+            KSPSetType(ksp, KSPBCGS);
+        KSPSetTolerances(ksp, relrestol, PETSC_DEFAULT, PETSC_DEFAULT, maxnumit);
+        if (verbosity > 0 && rank == 0)
+            KSPMonitorSet(ksp, mykspmonitor, PETSC_NULL, PETSC_NULL);
+        if (precondtype == "bjacobi")
+            PCSetType(pc, PCBJACOBI);
+        if (precondtype == "asm")
+            PCSetType(pc, PCASM);
+        if (precondtype == "gamg")
+            PCSetType(pc, PCGAMG);
+    }
+    KSPSetFromOptions(ksp);
+    
+    KSPSolve(ksp, bglobal, solglobal);
+    
+    if (isdirect == false && verbosity > 0 && rank == 0)
+    {
+        PetscInt numits;
+        PetscReal resnorm;
+        KSPGetIterationNumber(ksp, &numits);
+        KSPGetResidualNorm(ksp, &resnorm);
+        std::cout << "Distributed " << soltype << " solve: " << numits << " iterations (residual norm " << resnorm << ")" << std::endl;
+    }
+    
+    // Get the solution on all unconstrained dofs of this rank (the owners send the values of the shared dofs):
+    densematrix solvals(na, 1, 0.0);
+    double* solvalsptr = solvals.getvalues();
+    PetscScalar* ownedvals;
+    VecGetArray(solglobal, &ownedvals);
+    for (int i = 0; i < na; i++)
+    {
+        if (isowned[i])
+            solvalsptr[i] = ownedvals[globalinds[i]-ownedbegin];
+    }
+    VecRestoreArray(solglobal, &ownedvals);
+    
+    std::vector<densematrix> solvalsforneighbours(numneighbours), solvalsfromneighbours(numneighbours);
+    for (int n = 0; n < numneighbours; n++)
+    {
+        int* sendptr = dcdata[2][n].getvalues();
+        std::vector<int> sendpos(dcdata[2][n].count());
+        for (int i = 0; i < sendpos.size(); i++)
+            sendpos[i] = posina[sendptr[i]];
+        // Only the owner sends nonzero values:
+        solvalsforneighbours[n] = solvals.extractrows(sendpos);
+        solvalsfromneighbours[n] = densematrix(dcdata[3][n].count(), 1);
+    }
+    exchange(neighbours, solvalsforneighbours, solvalsfromneighbours);
+    for (int n = 0; n < numneighbours; n++)
+    {
+        int* recvptr = dcdata[3][n].getvalues();
+        double* fromptr = solvalsfromneighbours[n].getvalues();
+        for (int i = 0; i < dcdata[3][n].count(); i++)
+            solvalsptr[posina[recvptr[i]]] += fromptr[i];
+    }
+    
+    KSPDestroy(&ksp);
+    VecDestroy(&bglobal);
+    VecDestroy(&solglobal);
+    MatDestroy(&Aglobal);
+    
+    vec sol(std::shared_ptr<rawvec>(new rawvec(breduced.getpointer()->getdofmanager())));
+    sol.setvalues(intdensematrix(na, 1, 0, 1), solvals);
+    
+    setdata(A.xbmerge(sol, b));
+    
+    if (verbosity > 0 && rank == 0)
+        clktot.print("Distributed solve done in");
+}
+
+// Get the sparse matrix T such that the artificial sources generated by 'artificialterms' at the 'sendinds' rows are T*xa for any solution 
+// x whose values on the constrained dofs are zero (xa are the values on the unconstrained dofs). The matrix is obtained by probing the
+// artificial terms with sums of unit vectors. Columns that do not share any row in the sparsity pattern of A are probed together so that
+// only a few generations are needed. The artificial terms are supposed to couple only dofs that are already coupled in A.
+Mat getartificialtransfer(formulation formul, mat A, std::vector<int> artificialterms, intdensematrix sendinds)
+{
+    intdensematrix ainds = A.getainds();
+    int na = ainds.count();
+    int numrows = sendinds.count();
+    
+    int* aindsptr = ainds.getvalues();
+    int* sendindsptr = sendinds.getvalues();
+    
+    // Renumber from the full dof numbering to the unconstrained dof numbering:
+    int numdofs = A.countrows();
+    std::vector<int> renumber(numdofs, -1);
+    for (int i = 0; i < na; i++)
+        renumber[aindsptr[i]] = i;
+        
+    // Get the columns of A on every send row:
+    Mat Apetsc = A.getapetsc();
+    std::vector<std::vector<int>> rowcols(numrows);
+    for (int r = 0; r < numrows; r++)
+    {
+        int arow = renumber[sendindsptr[r]];
+        if (arow == -1)
+        {
+            std::cout << "Error in 'sl' namespace: expected unconstrained interface dofs to send" << std::endl;
+            abort();
+        }
+        PetscInt ncols; const PetscInt* cols;
+        MatGetRow(Apetsc, arow, &ncols, &cols, NULL);
+        rowcols[r] = std::vector<int>(cols, cols+ncols);
+        MatRestoreRow(Apetsc, arow, &ncols, &cols, NULL);
+    }
+    
+    // Rows in which every column appears:
+    std::vector<std::vector<int>> colrows(na);
+    for (int r = 0; r < numrows; r++)
+    {
+        for (int j = 0; j < rowcols[r].size(); j++)
+            colrows[rowcols[r][j]].push_back(r);
+    }
+    
+    // Greedy coloring of the columns (two columns sharing a row must have a different color):
+    std::vector<int> colors(na, -1);
+    std::vector<int> lastusedby = {};
+    int numcolors = 0;
+    for (int c = 0; c < na; c++)
+    {
+        if (colrows[c].size() == 0)
+            continue;
+        for (int i = 0; i < colrows[c].size(); i++)
+        {
+            std::vector<int>* curcols = &(rowcols[colrows[c][i]]);
+            for (int j = 0; j < curcols->size(); j++)
+            {
+                int curcolor = colors[curcols->at(j)];
+                if (curcolor >= 0)
+                    lastusedby[curcolor] = c;
+            }
+        }
+        int color = 0;
+        while (color < numcolors && lastusedby[color] == c)
+            color++;
+        if (color == numcolors)
+        {
+            lastusedby.push_back(-1);
+            numcolors++;
+        }
+        colors[c] = color;
+    }
+    
+    // Probe the artificial terms for every color:
+    std::vector<std::vector<double>> rowvals(numrows);
+    for (int r = 0; r < numrows; r++)
+        rowvals[r] = std::vector<double>(rowcols[r].size(), 0.0);
+        
+    for (int color = 0; color < numcolors; color++)
+    {
+        densematrix probe(na, 1, 0.0);
+        double* probeptr = probe.getvalues();
+        for (int c = 0; c < na; c++)
+        {
+            if (colors[c] == color)
+                probeptr[c] = 1.0;
+        }
+        vec probea(na, intdensematrix(na, 1, 0, 1), probe);
+        sl::setdata(A.x0merge(probea));
+        
+        formul.generatein(0, artificialterms);
+        densematrix gartificial = formul.b(false, false).getvalues(sendinds);
+        double* gartificialptr = gartificial.getvalues();
+        
+        for (int r = 0; r < numrows; r++)
+        {
+            for (int j = 0; j < rowcols[r].size(); j++)
+            {
+                if (colors[rowcols[r][j]] == color)
+                    rowvals[r][j] = gartificialptr[r];
+            }
+        }
+    }
+    
+    // Create the sparse matrix:
+    std::vector<PetscInt> nnz(numrows);
+    for (int r = 0; r < numrows; r++)
+        nnz[r] = rowcols[r].size();
+    
+    Mat T;
+    MatCreateSeqAIJ(PETSC_COMM_SELF, numrows, na, 0, nnz.data(), &T);
+    for (int r = 0; r < numrows; r++)
+    {
+        PetscInt row = r;
+        MatSetValues(T, 1, &row, rowcols[r].size(), rowcols[r].data(), rowvals[r].data(), INSERT_VALUES);
+    }
+    MatAssemblyBegin(T, MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd(T, MAT_FINAL_ASSEMBLY);
+    
+    return T;
+}
+
 densematrix Fgmultrobin(densematrix gprev)
 {
     mat A = universe::ddmmats[0];
     formulation formul = universe::ddmformuls[0];
-    std::vector<std::vector<int>> artificialterms = universe::ddmints;
 
     vec rhs(formul);
 
-    double* gprevptr = gprev.getvalues();
-
     std::shared_ptr<dtracker> dt = universe::mymesh->getdtracker();
     int numneighbours = dt->countneighbours();
 
@@ -1724,36 +2499,216 @@ densematrix Fgmultrobin(densematrix gprev)
         rhs.setvalues(universe::ddmrecvinds[n], Bm, "add");
         pos += len;
     }
+    
+    // The receives are posted before the local solve so that the neighbour data can arrive during it:
+    slmpi::startreceives(universe::ddmplan);
         
     vec sol = sl::solve(A, rhs);
-    sl::setdata(sol);
+    // The constrained values of the solution are zero:
+    vec sola = sol.extract(A.getainds());
+    Vec solapetsc = sola.getpetsc();
 
-    // Create the artificial sources solution on the inner interface:
-    std::vector<densematrix> Agmatssend(numneighbours), Agmatsrecv(numneighbours);
+    // Create the artificial sources solution on the inner interface with the precomputed transfer operators.
+    // The values are written to the send buffers of the persistent exchange plan and each send is started
+    // as soon as its buffer is ready so that it overlaps the transfers to the next neighbours:
     for (int n = 0; n < numneighbours; n++)
     {
-        formul.generatein(0, artificialterms[n]);
-        vec gartificial = formul.b(false, false);
-    
-        Agmatssend[n] = gartificial.getvalues(universe::ddmsendinds[n]);
-        Agmatsrecv[n] = densematrix(universe::ddmrecvinds[n].count(), 1);
+        int numsend = universe::ddmsendinds[n].count();
+        if (numsend == 0)
+        {
+            slmpi::startsend(universe::ddmplan, n);
+            continue;
+        }
+        
+        Vec gartificial;
+        VecCreate(PETSC_COMM_SELF, &gartificial);
+        VecSetSizes(gartificial, PETSC_DECIDE, numsend);
+        VecSetFromOptions(gartificial);
+        
+        MatMult(universe::ddmtransfers[n], solapetsc, gartificial);
+        
+        intdensematrix allinds(numsend, 1, 0, 1);
+        VecGetValues(gartificial, numsend, allinds.getvalues(), universe::ddmsendbuffers[n].getvalues());
+        VecDestroy(&gartificial);
+        
+        slmpi::startsend(universe::ddmplan, n);
     }
-    sl::exchange(dt->getneighbours(), Agmatssend, Agmatsrecv);
-    
-    densematrix Ag(Agmatsrecv);
     
     // Calculate I - A*g:
-    double* Agptr = Ag.getvalues();
-    densematrix Fg(Ag.count(), 1);
+    densematrix Fg = gprev.copy();
     double* Fgptr = Fg.getvalues();
     
-    for (int i = 0; i < Ag.count(); i++)
-        Fgptr[i] = gprevptr[i] - Agptr[i];
+    slmpi::finish(universe::ddmplan);
+    
+    pos = 0;
+    for (int n = 0; n < numneighbours; n++)
+    {
+        double* Agptr = universe::ddmrecvbuffers[n].getvalues();
+        int len = universe::ddmrecvbuffers[n].count();
+        for (int i = 0; i < len; i++)
+            Fgptr[pos+i] -= Agptr[i];
+        pos += len;
+    }
+
+    return Fg;
+}
+
+// Coarse space of the two-level DDM: one piecewise constant vector Z_r per rank on the artificial sources of that rank.
+// Since the data sent by a rank only depends on its own artificial sources all columns of F*Z are obtained from a single
+// application of F to a vector of ones. The contribution received from the neighbours is stored in universe::ddmcoarse[0].
+// The coarse matrix E = Z^T*F*Z only couples neighbour ranks. It is assembled sparse and factorized once on rank 0.
+
+// Assemble and factorize the coarse matrix on rank 0 from the sparse rows of all ranks (rank r has 'rowlens[r]' entries
+// in 'cols' and 'vals'). Coarse dofs with a zero row and column are dropped. The number of coarse dofs kept is returned:
+int ddmcoarsefactorize(std::vector<int>& rowlens, std::vector<int>& cols, std::vector<double>& vals)
+{
+    int numranks = rowlens.size();
+    
+    double maxabsE = 0;
+    for (int i = 0; i < vals.size(); i++)
+        maxabsE = std::max(maxabsE, std::abs(vals[i]));
+        
+    // Ranks without artificial sources have a zero coarse vector and thus a zero row and column in E.
+    // These coarse dofs are dropped (their coarse correction is zero) to keep the coarse problem invertible:
+    std::vector<bool> isnonzero(numranks, false);
+    int pos = 0;
+    for (int r = 0; r < numranks; r++)
+    {
+        for (int i = pos; i < pos+rowlens[r]; i++)
+        {
+            if (std::abs(vals[i]) > 1e-12*maxabsE)
+            {
+                isnonzero[r] = true;
+                isnonzero[cols[i]] = true;
+            }
+        }
+        pos += rowlens[r];
+    }
+    universe::ddmcoarsedofs = std::vector<int>(numranks, -1);
+    int numkept = 0;
+    for (int r = 0; r < numranks; r++)
+    {
+        if (isnonzero[r])
+        {
+            universe::ddmcoarsedofs[r] = numkept;
+            numkept++;
+        }
+    }
+    if (numkept == 0)
+        return 0;
+    
+    std::vector<int> nnz(numkept, 0);
+    for (int r = 0; r < numranks; r++)
+    {
+        if (universe::ddmcoarsedofs[r] >= 0)
+            nnz[universe::ddmcoarsedofs[r]] = rowlens[r];
+    }
+    MatCreateSeqAIJ(PETSC_COMM_SELF, numkept, numkept, 0, nnz.data(), &universe::ddmcoarsemat);
+    pos = 0;
+    for (int r = 0; r < numranks; r++)
+    {
+        int row = universe::ddmcoarsedofs[r];
+        for (int i = pos; i < pos+rowlens[r]; i++)
+        {
+            int col = universe::ddmcoarsedofs[cols[i]];
+            if (row >= 0 && col >= 0)
+                MatSetValue(universe::ddmcoarsemat, row, col, vals[i], ADD_VALUES);
+        }
+        pos += rowlens[r];
+    }
+    MatAssemblyBegin(universe::ddmcoarsemat, MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd(universe::ddmcoarsemat, MAT_FINAL_ASSEMBLY);
+    
+    PC pc;
+    KSPCreate(PETSC_COMM_SELF, &universe::ddmcoarseksp);
+    KSPSetOperators(universe::ddmcoarseksp, universe::ddmcoarsemat, universe::ddmcoarsemat);
+    KSPSetType(universe::ddmcoarseksp, KSPPREONLY);
+    KSPGetPC(universe::ddmcoarseksp, &pc);
+    PCSetType(pc, PCLU);
+    PCFactorSetMatSolverType(pc, MATSOLVERMUMPS);
+    KSPSetUp(universe::ddmcoarseksp);
+    
+    return numkept;
+}
+
+// Get F*Z*c on this rank:
+densematrix ddmcoarseoperator(std::vector<double>& c)
+{
+    std::shared_ptr<dtracker> dt = universe::mymesh->getdtracker();
+    int numneighbours = dt->countneighbours();
+    
+    densematrix Y = universe::ddmcoarse[0];
+    double* Yptr = Y.getvalues();
+    
+    densematrix output(Y.count(), 1, c[slmpi::getrank()]);
+    double* outptr = output.getvalues();
+    
+    int pos = 0;
+    for (int n = 0; n < numneighbours; n++)
+    {
+        double cn = c[dt->getneighbour(n)];
+        int len = universe::ddmrecvinds[n].count();
+        for (int i = pos; i < pos+len; i++)
+            outptr[i] -= cn*Yptr[i];
+        pos += len;
+    }
+    
+    return output;
+}
 
+// Get the coarse solution inv(E)*Z^T*v (one value per rank). Z^T*v is gathered and solved on rank 0 and the solution is broadcast:
+std::vector<double> ddmcoarsesolve(densematrix v)
+{
+    int numranks = slmpi::count();
+    
+    std::vector<double> fragment = {v.sum()}, restricted;
+    slmpi::gather(0, fragment, restricted);
+    
+    std::vector<double> output(numranks, 0.0);
+    if (slmpi::getrank() == 0)
+    {
+        int numkept = 0;
+        for (int r = 0; r < numranks; r++)
+            numkept += (universe::ddmcoarsedofs[r] >= 0);
+        
+        Vec rhs, sol;
+        VecCreateSeq(PETSC_COMM_SELF, numkept, &rhs);
+        VecDuplicate(rhs, &sol);
+        for (int r = 0; r < numranks; r++)
+        {
+            if (universe::ddmcoarsedofs[r] >= 0)
+                VecSetValue(rhs, universe::ddmcoarsedofs[r], restricted[r], INSERT_VALUES);
+        }
+        VecAssemblyBegin(rhs);
+        VecAssemblyEnd(rhs);
+        
+        KSPSolve(universe::ddmcoarseksp, rhs, sol);
+        
+        for (int r = 0; r < numranks; r++)
+        {
+            if (universe::ddmcoarsedofs[r] >= 0)
+                VecGetValues(sol, 1, &(universe::ddmcoarsedofs[r]), &(output[r]));
+        }
+        VecDestroy(&rhs);
+        VecDestroy(&sol);
+    }
+    slmpi::broadcast(0, output);
+    
+    return output;
+}
+
+// Deflated operator (I - F*Z*inv(E)*Z^T)*F:
+densematrix Fgmultrobincoarse(densematrix gprev)
+{
+    densematrix Fg = Fgmultrobin(gprev);
+    
+    std::vector<double> c = ddmcoarsesolve(Fg);
+    Fg.subtract(ddmcoarseoperator(c));
+    
     return Fg;
 }
 
-std::vector<double> sl::allsolve(formulation formul, std::vector<int> formulterms, std::vector<std::vector<int>> physicalterms, std::vector<std::vector<int>> artificialterms, double relrestol, int maxnumit, std::string soltype, int verbosity)
+std::vector<double> sl::allsolve(formulation formul, std::vector<int> formulterms, std::vector<std::vector<int>> physicalterms, std::vector<std::vector<int>> artificialterms, double relrestol, int maxnumit, std::string soltype, int verbosity, bool coarsecorrection, int restart, bool pipelined)
 {
     // Make sure the problem is of the form Ax = b:
     if (formul.isdampingmatrixdefined() || formul.ismassmatrixdefined())
@@ -1831,11 +2786,87 @@ std::vector<double> sl::allsolve(formulation formul, std::vector<int> formulterm
     
     densematrix B(Bmatsrecv);
     
+    // Precompute the linear maps from the solution to the artificial sources on every interface:
+    wallclock clktransfer;
+    universe::ddmtransfers = std::vector<Mat>(numneighbours);
+    for (int n = 0; n < numneighbours; n++)
+        universe::ddmtransfers[n] = getartificialtransfer(formul, A, artificialterms[n], universe::ddmsendinds[n]);
+    if (verbosity > 1 && rank == 0)
+        clktransfer.print("Interface transfer operators computed in");
+        
+    // Persistent exchange plan for the artificial sources (the buffers are reused at every iteration):
+    universe::ddmsendbuffers = std::vector<densematrix>(numneighbours);
+    universe::ddmrecvbuffers = std::vector<densematrix>(numneighbours);
+    std::vector<int> sendlens(numneighbours), recvlens(numneighbours);
+    std::vector<double*> sendbuffers(numneighbours), recvbuffers(numneighbours);
+    for (int n = 0; n < numneighbours; n++)
+    {
+        universe::ddmsendbuffers[n] = densematrix(universe::ddmsendinds[n].count(), 1);
+        universe::ddmrecvbuffers[n] = densematrix(universe::ddmrecvinds[n].count(), 1);
+        sendlens[n] = universe::ddmsendbuffers[n].count();
+        recvlens[n] = universe::ddmrecvbuffers[n].count();
+        sendbuffers[n] = universe::ddmsendbuffers[n].getvalues();
+        recvbuffers[n] = universe::ddmrecvbuffers[n].getvalues();
+    }
+    universe::ddmplan = slmpi::createplan(dt->getneighbours(), sendlens, sendbuffers, recvlens, recvbuffers);
+    
     // Initial value of the artificial sources solution:
     densematrix vi(B.countrows(), B.countcolumns(), 0.0);
     
+    // Build the coarse problem E = Z^T*F*Z:
+    if (coarsecorrection)
+    {
+        wallclock clkcoarse;
+        
+        densematrix ones(B.countrows(), 1, 1.0);
+        densematrix Y = Fgmultrobin(ones);
+        Y.minus(); Y.add(ones);
+        universe::ddmcoarse = {Y};
+        
+        // Sparse row of E for this rank (diagonal entry then one entry per neighbour):
+        std::vector<int> Ecols = {rank};
+        std::vector<double> Evals = {(double)B.countrows()};
+        int pos = 0;
+        for (int n = 0; n < numneighbours; n++)
+        {
+            int len = universe::ddmrecvinds[n].count();
+            double Eval = 0;
+            for (int i = pos; i < pos+len; i++)
+                Eval -= Y.getvalues()[i];
+            Ecols.push_back(dt->getneighbour(n));
+            Evals.push_back(Eval);
+            pos += len;
+        }
+        std::vector<int> rowlen = {(int)Ecols.size()}, rowlens, allEcols;
+        std::vector<double> allEvals;
+        slmpi::gather(0, rowlen, rowlens);
+        slmpi::gather(0, Ecols, allEcols, rowlens);
+        slmpi::gather(0, Evals, allEvals, rowlens);
+        
+        std::vector<int> numkept = {0};
+        if (rank == 0)
+            numkept[0] = ddmcoarsefactorize(rowlens, allEcols, allEvals);
+        slmpi::broadcast(0, numkept);
+        if (numkept[0] == 0)
+        {
+            std::cout << "Error in 'sl' namespace: coarse problem of the DDM is zero (no artificial sources on any rank)" << std::endl;
+            abort();
+        }
+        
+        // Deflate the rhs:
+        std::vector<double> c = ddmcoarsesolve(B);
+        B.subtract(ddmcoarseoperator(c));
+        
+        if (verbosity > 1 && rank == 0)
+            clkcoarse.print("Sparse coarse problem of size "+std::to_string(numkept[0])+" factorized in");
+    }
+    
     // Gmres iteration:
-    std::vector<double> resvec = gmres(Fgmultrobin, B, vi, relrestol, maxnumit, verbosity*(rank == 0));
+    std::vector<double> resvec;
+    if (coarsecorrection)
+        resvec = gmres(Fgmultrobincoarse, B, vi, relrestol, maxnumit, verbosity*(rank == 0), restart, pipelined);
+    else
+        resvec = gmres(Fgmultrobin, B, vi, relrestol, maxnumit, verbosity*(rank == 0), restart, pipelined);
     int numits = resvec.size()-1;
     if (verbosity > 0 && rank == 0)
     {
@@ -1845,6 +2876,17 @@ std::vector<double> sl::allsolve(formulation formul, std::vector<int> formulterm
             std::cout << "gmres could not converge to the requested " << relrestol << " relative tolerance (could only reach " << resvec[numits] << ")" << std::endl;
     }
 
+    // Add the coarse component Z*inv(E)*Z^T*(B - F*vi) to the artificial sources solution:
+    if (coarsecorrection)
+    {
+        densematrix Bfull(Bmatsrecv);
+        Bfull.subtract(Fgmultrobin(vi));
+        std::vector<double> c = ddmcoarsesolve(Bfull);
+        
+        densematrix coarsecomponent(vi.countrows(), 1, c[rank]);
+        vi.add(coarsecomponent);
+    }
+
     // Compute the total solution (physical + artificial):
     int pos = 0;
     for (int n = 0; n < numneighbours; n++)
@@ -1892,7 +2934,7 @@ void sl::exchange(std::vector<int> targetranks, std::vector<densematrix> sends,
     slmpi::exchange(targetranks, sendlens, sendbuffers, reclens, recbuffers);
 }
 
-std::vector<double> sl::gmres(densematrix (*mymatmult)(densematrix), densematrix b, densematrix x, double relrestol, int maxnumit, int verbosity)
+std::vector<double> sl::gmres(densematrix (*mymatmult)(densematrix), densematrix b, densematrix x, double relrestol, int maxnumit, int verbosity, int restart, bool pipelined)
 {   
     if (b.countrows() != x.countrows() || b.countcolumns() != 1 || x.countcolumns() != 1)
     {
@@ -1903,101 +2945,142 @@ std::vector<double> sl::gmres(densematrix (*mymatmult)(densematrix), densematrix
     // Fragment size:
     int n = b.count();
     
+    // Number of iterations between restarts:
+    int m = maxnumit;
+    if (restart > 0 && restart < maxnumit)
+        m = restart;
+    
     // Initialize the 1D vectors:
-    std::vector<double> sn(maxnumit, 0.0);
-    std::vector<double> cs(maxnumit, 0.0);
-    std::vector<double> beta(maxnumit+1, 0.0);
-    std::vector<double> relresvec(maxnumit+1, 0.0);
+    std::vector<double> sn(m, 0.0);
+    std::vector<double> cs(m, 0.0);
+    std::vector<double> beta(m+1, 0.0);
+    std::vector<double> relresvec = {};
+    relresvec.reserve(maxnumit+1);
     
     double* xptr = x.getvalues();
     double* bptr = b.getvalues();
-
-    // Compute r = b - A * x and the initial relative residual:
-    double normb = 0.0; double normr = 0.0;
-    densematrix r = mymatmult(x.copy());
-    double* rptr = r.getvalues();
-    
-    if (r.countrows() != n || r.countcolumns() != 1)
-    {
-        std::cout << "Error in 'sl' namespace: in function gmres the matrix product function call returned a densematrix of wrong size on rank " << slmpi::getrank() << std::endl;
-        abort();
-    }
-    
-    for (int i = 0; i < n; i++)
-    {
-        rptr[i] = bptr[i] - rptr[i];
-        normb += bptr[i]*bptr[i];
-        normr += rptr[i]*rptr[i];
-    }
-    
-    std::vector<double> norms = {normb, normr};
-    
-    slmpi::sum(norms); // reduce on all ranks
-    
-    normb = std::sqrt(norms[0]);
-    normr = std::sqrt(norms[1]);
-    beta[0] = normr;
-    
-    // All zero solution in case b is all zero:
-    if (normb == 0)
-    {
-        for (int i = 0; i < n; i++)
-            xptr[i] = 0.0;
-        return {0.0};
-    }
     
-    relresvec[0] = normr/normb;
-        
-    // Holder for all Krylov vectors (one on each row):
-    densematrix Q(maxnumit+1, n);
+    // Holder for the Krylov vectors of a restart cycle (one on each row) and their product by A (pipelined only):
+    densematrix Q(m+1, n);
     double* Qptr = Q.getvalues();
-    
-    // First row is the normed residual:
-    double invnormr = 1.0/normr;
-    for (int i = 0; i < n; i++)
-        Qptr[i] = invnormr * rptr[i];
+    densematrix W;
+    if (pipelined)
+        W = densematrix(m+1, n);
         
     // Hessenberg matrix (columnwise upper triangular {r0c0,r0c1,r1c1,r0c2,...}):
-    densematrix H(1, ((1+maxnumit)*maxnumit)/2 + 1, 0.0); // +1 because arnoldi returns length k+2
+    densematrix H(1, ((1+m)*m)/2 + 1, 0.0); // +1 because arnoldi returns length k+2
     double* Hptr = H.getvalues();
     
-    // GMRES iteration:
-    int k = 0;
-    for (k = 0; k < maxnumit; k++)
+    double normb = 0.0;
+    int numit = 0;
+    
+    // Restart loop:
+    while (true)
     {
-        if (verbosity > 0)
-            std::cout << "gmres @" << k << " -> " << relresvec[k] << std::endl;
+        // Compute r = b - A * x and the relative residual:
+        double normr = 0.0;
+        densematrix r = mymatmult(x.copy());
+        double* rptr = r.getvalues();
+        
+        if (r.countrows() != n || r.countcolumns() != 1)
+        {
+            std::cout << "Error in 'sl' namespace: in function gmres the matrix product function call returned a densematrix of wrong size on rank " << slmpi::getrank() << std::endl;
+            abort();
+        }
+        
+        double normbfrag = 0.0;
+        for (int i = 0; i < n; i++)
+        {
+            rptr[i] = bptr[i] - rptr[i];
+            normbfrag += bptr[i]*bptr[i];
+            normr += rptr[i]*rptr[i];
+        }
+        
+        std::vector<double> norms = {normbfrag, normr};
+        
+        slmpi::sum(norms); // reduce on all ranks
+        
+        normb = std::sqrt(norms[0]);
+        normr = std::sqrt(norms[1]);
+        
+        // All zero solution in case b is all zero:
+        if (normb == 0)
+        {
+            for (int i = 0; i < n; i++)
+                xptr[i] = 0.0;
+            return {0.0};
+        }
+        
+        // After a restart the true residual replaces the estimate:
+        if (numit == 0)
+            relresvec.push_back(normr/normb);
+        else
+            relresvec[numit] = normr/normb;
+        
+        std::fill(beta.begin(), beta.end(), 0.0);
+        beta[0] = normr;
             
-        if (relresvec[k] <= relrestol)
-            break;
+        // First row is the normed residual:
+        double invnormr = 1.0/normr;
+        for (int i = 0; i < n; i++)
+            Qptr[i] = invnormr * rptr[i];
             
-        // Run Arnoldi:
-        std::vector<double> h = myalgorithm::arnoldi(mymatmult, Q, k);
+        if (pipelined && relresvec[numit] > relrestol && numit < maxnumit)
+        {
+            densematrix Aq = mymatmult(Q.extractrows(0,0).getresized(n,1));
+            double* Wptr = W.getvalues(); double* Aqptr = Aq.getvalues();
+            for (int i = 0; i < n; i++)
+                Wptr[i] = Aqptr[i];
+        }
         
-        // Write h to H (can exceed by 1 the reduced Hessenberg matrix size):
-        for (int i = 0; i < h.size(); i++)
-            Hptr[((1+k)*k)/2 + i] = h[i];
+        // GMRES iteration:
+        int k = 0;
+        for (k = 0; k < m && numit < maxnumit; k++)
+        {
+            if (verbosity > 0)
+                std::cout << "gmres @" << numit << " -> " << relresvec[numit] << std::endl;
+                
+            if (relresvec[numit] <= relrestol)
+                break;
+                
+            // Run Arnoldi:
+            std::vector<double> h;
+            if (pipelined)
+                h = myalgorithm::pipelinedarnoldi(mymatmult, Q, W, k);
+            else
+                h = myalgorithm::arnoldi(mymatmult, Q, k);
+            
+            // Write h to H (can exceed by 1 the reduced Hessenberg matrix size):
+            for (int i = 0; i < h.size(); i++)
+                Hptr[((1+k)*k)/2 + i] = h[i];
 
-        // Eliminate the last element in the kth column of H and update the rotation matrix:
-        myalgorithm::applygivensrotation(Hptr+((1+k)*k)/2, cs, sn, k);
-        
-        // Update the residual vector:
-        beta[k+1] = -sn[k] * beta[k];
-        beta[k] = cs[k] * beta[k];
-        
-        relresvec[k+1] = std::abs(beta[k+1]) / normb;
-    }
+            // Eliminate the last element in the kth column of H and update the rotation matrix:
+            myalgorithm::applygivensrotation(Hptr+((1+k)*k)/2, cs, sn, k);
+            
+            // Update the residual vector:
+            beta[k+1] = -sn[k] * beta[k];
+            beta[k] = cs[k] * beta[k];
+            
+            numit++;
+            relresvec.push_back(std::abs(beta[k+1]) / normb);
+        }
 
-    if (k > 0)
-    {
-        // Calculate the solution:
-        densematrix y(1,k);
-        myalgorithm::solveuppertriangular(k, Hptr, &beta[0], y.getvalues());
-        densematrix Qy = y.multiply(Q.getresized(k,n));
-        x.add(Qy);
+        if (k > 0)
+        {
+            // Calculate the solution:
+            densematrix y(1,k);
+            myalgorithm::solveuppertriangular(k, Hptr, &beta[0], y.getvalues());
+            densematrix Qy = y.multiply(Q.getresized(k,n));
+            x.add(Qy);
+        }
+        
+        if (relresvec[numit] <= relrestol || numit >= maxnumit)
+        {
+            if (verbosity > 0 && k == m && relresvec[numit] <= relrestol)
+                std::cout << "gmres @" << numit << " -> " << relresvec[numit] << std::endl;
+            break;
+        }
     }
-
-    relresvec.resize(k+1);
     
     return relresvec;
 }
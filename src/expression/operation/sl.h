@@ -59,8 +59,12 @@ namespace sl
     // Load a vector of doubles separated by a character:
     std::vector<double> loadvector(std::string filename, char delimiter = ',', bool sizeincluded = false);
 
-    // Partition the mesh into numranks parts and return the mesh file name for each rank:
-    std::string allpartition(std::string meshfile);
+    // Partition the mesh into numranks parts and return the mesh file name to load on each rank. With the "metis" partitioner the next
+    // mesh loaded is only read by rank 0, partitioned with METIS and every part is sent to its rank in memory (the name is unchanged).
+    // With the "gmsh" partitioner (GMSH API required) rank 0 writes a mesh file for each rank.
+    std::string allpartition(std::string meshfile, std::string partitioner);
+    // METIS partition where elements in the physical regions 'physregs' are weighted for an interpolation order 'orders' (p-adaptivity):
+    std::string allpartition(std::string meshfile, std::vector<int> physregs = {}, std::vector<int> orders = {});
 
     // Compute the L2 norm of an expression:
     expression norm(expression expr);
@@ -101,6 +105,11 @@ namespace sl
     std::vector<double> printtotalforce(int physreg, expression meshdeform, expression EorH, expression epsilonormu, int extraintegrationorder = 0);
     
     void setphysicalregionshift(int shiftamount);
+    // Renumber the nodes and the elements in every disjoint region along a space-filling curve when
+    // loading a mesh ("hilbert", "morton" or "none"). This improves the memory locality of unstructured meshes.
+    void setmeshrenumbering(std::string curvetype);
+    // Assemble and interpolate on quadrangles and hexahedra with sum factorization from this interpolation order on (-1 for never, the default):
+    void setsumfactorization(int minorder);
 
     // Write all shape functions for an element type up to a given order:
     void writeshapefunctions(std::string filename, std::string sftypename, int elementtypenumber, int maxorder, bool allorientations = false);
@@ -211,8 +220,10 @@ namespace sl
     // hp-adaptation:
     bool adapt(int verbosity = 0);
     
-    // Define a Zienkiewicz-Zhu type error indicator:
-    expression zienkiewiczzhu(expression input);
+    // Define a Zienkiewicz-Zhu type error indicator. In incremental mode the input is
+    // only recomputed on the elements whose field coefficients have changed since the
+    // last estimate (not possible if the input depends on parameters, time, ...).
+    expression zienkiewiczzhu(expression input, bool isincremental = false);
 
     // Define typically used arrays for convenience:
     expression array1x1(expression term11);
@@ -225,10 +236,17 @@ namespace sl
     expression array3x2(expression term11, expression term12, expression term21, expression term22, expression term31, expression term32);
     expression array3x3(expression term11, expression term12, expression term13, expression term21, expression term22, expression term23, expression term31, expression term32, expression term33);
 
-    // Direct resolution (with or without diagonal scaling):
-    vec solve(mat A, vec b, std::string soltype = "lu", bool diagscaling = false);
+    // Direct resolution (with or without diagonal scaling). With 'mixedlu' the matrix is factorized to single precision accuracy
+    // and the double precision accuracy is recovered by iterative refinement (full 'lu' is used in case the refinement stalls).
+    // The refinement stops once the relative residual is below 'refinementtol' or after 'maxrefinementits' iterations:
+    vec solve(mat A, vec b, std::string soltype = "lu", bool diagscaling = false, double refinementtol = 1e-12, int maxrefinementits = 20);
     // Multi-rhs direct resolution:
     std::vector<vec> solve(mat A, std::vector<vec> b, std::string soltype = "lu");
+    
+    // Direct solve with static condensation. The interior dofs of the highest dimension elements (which only couple within 
+    // their element) are eliminated element by element, the condensed system on all other dofs is factorized and solved
+    // and the interior dofs are recovered by local back-substitution. This is most effective at high interpolation orders.
+    vec condensedsolve(mat A, vec b, std::string soltype = "lu");
     // Densematrix 'b' has size #rhs x #dofs:
     densematrix solve(mat A, densematrix b, std::string soltype);
     
@@ -238,16 +256,33 @@ namespace sl
     // Generate, solve and save to field a formulation:
     void solve(formulation formul, std::string soltype = "lu", std::vector<int> blockstoconsider = {-1});
     void solve(std::vector<formulation> formuls, std::string soltype = "lu");
+    // Generate, solve with static condensation and save to field a formulation:
+    void condensedsolve(formulation formul, std::string soltype = "lu");
+    
+    // Solve a nonlinear formulation with fixed-point iterations until the relative solution change is below 'tol' (or until 'maxnumit' 
+    // if positive). The iterations are accelerated with the Anderson method over the last 'depth' iterates (0 for plain fixed-point 
+    // iterations) and 'relaxationfactor' is used as mixing factor. The number of iterations is returned.
+    int solvenonlinear(formulation formul, double tol = 1e-3, int maxnumit = 50, int depth = 5, double relaxationfactor = 1.0, std::string soltype = "lu", int verbosity = 1);
+    
+    // Classical distributed resolution on a no-overlap mesh partition. The matrix of every rank is added into a global parallel matrix,
+    // with each dof shared between ranks owned by the lowest rank. The global system is solved with a parallel direct solver ('lu' or 
+    // 'cholesky' with MUMPS) or a parallel Krylov solver ('gmres' or 'bicgstab' preconditioned with 'bjacobi', 'asm' or 'gamg'):
+    void distributedsolve(formulation formul, std::string soltype = "lu", double relrestol = 1e-10, int maxnumit = 1000, std::string precondtype = "gamg", int verbosity = 1);
     
     // DDM resolution with mixed interface conditions. The initial solution is taken from the fields state. The relative residual history is returned.
-    std::vector<double> allsolve(formulation formul, std::vector<int> formulterms, std::vector<std::vector<int>> physicalterms, std::vector<std::vector<int>> artificialterms, double relrestol, int maxnumit, std::string soltype = "lu", int verbosity = 1);
+    // With 'coarsecorrection' the gmres iteration is deflated by a coarse space with one piecewise constant vector per rank (two-level DDM).
+    // The sparse coarse matrix is factorized once on rank 0, which solves every coarse problem and broadcasts its solution.
+    // Arguments 'restart' and 'pipelined' are forwarded to the gmres iteration (see 'gmres' below).
+    std::vector<double> allsolve(formulation formul, std::vector<int> formulterms, std::vector<std::vector<int>> physicalterms, std::vector<std::vector<int>> artificialterms, double relrestol, int maxnumit, std::string soltype = "lu", int verbosity = 1, bool coarsecorrection = false, int restart = -1, bool pipelined = false);
     
     // Exchange densematrix data with MPI:
     void exchange(std::vector<int> targetranks, std::vector<densematrix> sends, std::vector<densematrix> receives);
     
-    // MPI based gmres with custom matrix free product (no restart). Initial guess and solution are in x.
+    // MPI based gmres with custom matrix free product. Initial guess and solution are in x. The Krylov basis memory is bounded by
+    // restarting every 'restart' iterations (no restart if negative). Each iteration requires a single global reduction, which is 
+    // overlapped with the next matrix product in the pipelined variant (at the price of a slightly lower numerical stability).
     // Relative residual at each iteration is returned. Length is number of iterations + 1 (first is initial residual).
-    std::vector<double> gmres(densematrix (*mymatmult)(densematrix), densematrix b, densematrix x, double relrestol, int maxnumit, int verbosity = 1);
+    std::vector<double> gmres(densematrix (*mymatmult)(densematrix), densematrix b, densematrix x, double relrestol, int maxnumit, int verbosity = 1, int restart = -1, bool pipelined = false);
     
     // Know which dofs to send and at which dofs to receive for the DDM. Choose the rawfields and the domain interface dimensions (length 3) to consider.
     void mapdofs(std::shared_ptr<dofmanager> dm, std::vector<std::shared_ptr<rawfield>> rfs, std::vector<bool> isdimactive, std::vector<intdensematrix>& sendinds, std::vector<intdensematrix>& recvinds);
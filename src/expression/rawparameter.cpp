@@ -103,6 +103,47 @@ std::shared_ptr<operation> rawparameter::get(int disjreg, int row, int col)
     return myoperations[disjreg][row*mynumcols+col];
 }
 
+bool rawparameter::isfieldincluded(std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    synchronize();
+    
+    for (int d = 0; d < myoperations.size(); d++)
+    {
+        for (int i = 0; i < myoperations[d].size(); i++)
+        {
+            if (myoperations[d][i] != NULL && myoperations[d][i]->isfieldincluded(rfs))
+                return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<operation> rawparameter::derivative(int row, int col, std::vector<std::shared_ptr<rawfield>>& rfs)
+{
+    std::vector<std::shared_ptr<operation>> terms = {};
+    
+    for (int i = 0; i < mystructuretracker.size(); i++)
+    {
+        std::shared_ptr<operation> curderivative = mystructuretracker[i].second.getoperationinarray(row, col)->derivative(rfs);
+        if (curderivative->iszero())
+            continue;
+        
+        // The indicator is defined on the same regions as this parameter:
+        std::shared_ptr<rawparameter> indicator(new rawparameter(1,1));
+        for (int j = 0; j < mystructuretracker.size(); j++)
+            indicator->set(mystructuretracker[j].first, expression(i == j ? 1.0 : 0.0));
+            
+        std::shared_ptr<operation> indicatorop(new opparameter(indicator, 0, 0));
+        terms.push_back(std::shared_ptr<operation>(new opproduct({indicatorop, curderivative})));
+    }
+    
+    if (terms.size() == 0)
+        return std::shared_ptr<operation>(new opconstant(0));
+    if (terms.size() == 1)
+        return terms[0];
+    return std::shared_ptr<operation>(new opsum(terms));
+}
+
 int rawparameter::countrows(void)
 {
     return mynumrows;
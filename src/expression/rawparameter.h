@@ -15,6 +15,7 @@
 #include "expression.h"
 
 class operation;
+class rawfield;
 
 class rawparameter
 {
@@ -71,6 +72,14 @@ class rawparameter
         densematrix multiharmonicinterpolate(int row, int col, int numtimeevals, elementselector& elemselect, std::vector<double>& evaluationcoordinates, expression* meshdeform);
 
         void simplify(int row, int col, int disjreg);
+        
+        // True if the parameter includes a field in 'rfs' on any disjoint region:
+        bool isfieldincluded(std::vector<std::shared_ptr<rawfield>>& rfs);
+        
+        // Get the derivative of a parameter entry with respect to the fields in 'rfs'. Since it includes dofs it cannot be a parameter. 
+        // It is the sum over all 'set' calls of the derivative of the expression set times an indicator parameter equal to one on the 
+        // regions where that expression is in use (i.e. not overwritten by a later 'set' call) and zero on the other regions:
+        std::shared_ptr<operation> derivative(int row, int col, std::vector<std::shared_ptr<rawfield>>& rfs);
 
         void print(void);
 
@@ -335,6 +335,12 @@ void field::setupdateaccuracy(int extraintegrationorder)
     rawfieldptr->setupdateaccuracy(extraintegrationorder);
 }
 
+void field::setprojectiontype(std::string projectiontype)
+{
+    errorifpointerisnull();
+    rawfieldptr->setprojectiontype(projectiontype);
+}
+
 field field::comp(int component) 
 { 
     errorifpointerisnull();
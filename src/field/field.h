@@ -125,6 +125,14 @@ class field
         
         void setupdateaccuracy(int extraintegrationorder);
         
+        // Choose how 'setvalue' and the constraints project the input expression on the field:
+        //
+        // - "global" solves the L2 projection on the whole region (default)
+        // - "local" projects on the nodes, then the edges, faces and volumes as small independent
+        //   per entity systems. The inverted local mass blocks are reused from call to call.
+        //
+        void setprojectiontype(std::string projectiontype);
+        
         std::shared_ptr<rawfield> getpointer(void) { return rawfieldptr; };
 
         // Select a component.
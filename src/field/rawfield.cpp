@@ -1,4 +1,5 @@
 #include "rawfield.h"
+#include "localprojection.h"
 
 
 void rawfield::synchronize(std::vector<int> physregsfororder, std::vector<int> disjregsfororder)
@@ -92,24 +93,59 @@ void rawfield::updateshapefunctions(std::shared_ptr<rawfield> originalthis, bool
     isitgauged = std::vector<bool>( (universe::mymesh->getdisjointregions())->count(), false);
         
 
-    wallclock clkn;
-    updatenodalshapefunctions(originalthis);
-    if (withtiming)
-        clkn.print("Time to update the nodal shape functions:");
-    wallclock clke;
-    updateothershapefunctions(originalthis,1);
-    if (withtiming)
-        clke.print("Time to update the edge shape functions:");
-    wallclock clkf;
-    updateothershapefunctions(originalthis,2);
-    if (withtiming)
-        clkf.print("Time to update the face shape functions:");
-    wallclock clkv;
-    updateothershapefunctions(originalthis,3);
-    if (withtiming)
+    // After a p-adaptation the coefficients are copied and only the disjoint regions holding entities that cannot be copied are projected:
+    wallclock clkc;
+    std::vector<bool> istoproject;
+    if (copyshapefunctions(originalthis, istoproject))
     {
-        clkv.print("Time to update the volume shape functions:");
-        clkn.print("Total time:");
+        disjointregions* drs = universe::mymesh->getdisjointregions();
+        
+        int numtoproject = 0;
+        for (int dim = 0; dim <= universe::mymesh->getmeshdimension(); dim++)
+        {
+            std::vector<int> drstoproject = {};
+            std::vector<int> alldrsindim = drs->getindim(dim);
+            for (int d = 0; d < alldrsindim.size(); d++)
+            {
+                if (istoproject[alldrsindim[d]])
+                    drstoproject.push_back(alldrsindim[d]);
+            }
+            numtoproject += drstoproject.size();
+            
+            if (drstoproject.size() == 0)
+                continue;
+            if (dim == 0)
+                updatenodalshapefunctions(originalthis);
+            else
+                updateothershapefunctions(originalthis, dim, drstoproject);
+        }
+        if (withtiming)
+        {
+            std::cout << "Projected on " << numtoproject << " of " << drs->count() << " disjoint regions" << std::endl;
+            clkc.print("Time to copy and update the shape functions:");
+        }
+    }
+    else
+    {
+        wallclock clkn;
+        updatenodalshapefunctions(originalthis);
+        if (withtiming)
+            clkn.print("Time to update the nodal shape functions:");
+        wallclock clke;
+        updateothershapefunctions(originalthis,1);
+        if (withtiming)
+            clke.print("Time to update the edge shape functions:");
+        wallclock clkf;
+        updateothershapefunctions(originalthis,2);
+        if (withtiming)
+            clkf.print("Time to update the face shape functions:");
+        wallclock clkv;
+        updateothershapefunctions(originalthis,3);
+        if (withtiming)
+        {
+            clkv.print("Time to update the volume shape functions:");
+            clkn.print("Total time:");
+        }
     }
     
     
@@ -119,6 +155,87 @@ void rawfield::updateshapefunctions(std::shared_ptr<rawfield> originalthis, bool
     isitgauged = isitgaugedbkp;
 }
 
+bool rawfield::copyshapefunctions(std::shared_ptr<rawfield> originalthis, std::vector<bool>& istoproject)
+{
+    // The coefficients can only be copied if the mesh was not h-adapted:
+    if (originalthis->myrawmesh != universe::mymesh || originalthis->myptracker == NULL)
+        return false;
+        
+    int meshdim = universe::mymesh->getmeshdimension();
+    
+    elements* els = universe::mymesh->getelements();
+    disjointregions* drs = universe::mymesh->getdisjointregions();
+    disjointregions* origdrs = originalthis->myptracker->getdisjointregions();
+    
+    // Element numbers here are renumbered to the ones in the original field with origelem = renumbering[type][elem]:
+    std::vector<std::vector<int>> renumbering;
+    (universe::mymesh->getptracker())->getrenumbering(originalthis->myptracker, renumbering);
+    
+    std::vector<std::vector<int>> origindisjregs;
+    originalthis->myptracker->getindisjointregions(origindisjregs);
+    
+    istoproject = std::vector<bool>(drs->count(), false);
+    
+    // The basis is hierarchical and the form functions on a node/edge/face/volume are sorted with increasing 
+    // order. The coefficients of the form functions defined before and after the p-adaptation are thus copied 
+    // as is and those of the new form functions are zero. This is exact unless a node/edge/face/volume 
+    // (or any of its subelements) lost form functions, in which case it is marked as touched and projected.
+    std::vector<std::vector<bool>> istouched(8);
+    for (int dim = 0; dim <= meshdim; dim++)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            element myelement(i);
+            if (myelement.getelementdimension() != dim)
+                continue;
+                
+            int numelems = els->count(i);
+            istouched[i] = std::vector<bool>(numelems, false);
+            
+            for (int e = 0; e < numelems; e++)
+            {
+                int curdr = els->getdisjointregion(i, e, false);
+                int origelem = renumbering[i][e];
+                int origdr = origindisjregs[i][origelem];
+                // Skip the curvature nodes:
+                if (curdr < 0 || origdr < 0)
+                    continue;
+                
+                int numff = mycoefmanager->countformfunctions(curdr);
+                int numorigff = originalthis->mycoefmanager->countformfunctions(origdr);
+                
+                int index = e - drs->getrangebegin(curdr);
+                int origindex = origelem - origdrs->getrangebegin(origdr);
+                for (int ff = 0; ff < std::min(numff, numorigff); ff++)
+                    mycoefmanager->setcoef(curdr, ff, index, originalthis->mycoefmanager->getcoef(origdr, ff, origindex));
+                
+                bool curtouched = (numff < numorigff);
+                for (int t = 0; t < 8; t++)
+                {
+                    if (curtouched)
+                        break;
+                    if (element(t).getelementdimension() >= dim)
+                        continue;
+                    for (int s = 0; s < myelement.counttype(t); s++)
+                    {
+                        if (istouched[t][els->getsubelement(t, i, e, s)])
+                        {
+                            curtouched = true;
+                            break;
+                        }
+                    }
+                }
+                istouched[i][e] = curtouched;
+                
+                if (curtouched && numff > 0)
+                    istoproject[curdr] = true;
+            }
+        }
+    }
+    
+    return true;
+}
+
 void rawfield::updatenodalshapefunctions(std::shared_ptr<rawfield> originalthis)
 {
     field thisfield = field(shared_from_this());
@@ -144,7 +261,7 @@ void rawfield::updatenodalshapefunctions(std::shared_ptr<rawfield> originalthis)
     universe::mymesh->getphysicalregions()->remove({physreg}, false);
 }
 
-void rawfield::updateothershapefunctions(std::shared_ptr<rawfield> originalthis, int dim) // dim can be 1, 2 or 3
+void rawfield::updateothershapefunctions(std::shared_ptr<rawfield> originalthis, int dim, std::vector<int> disjregs) // dim can be 1, 2 or 3
 {
     int meshdim = universe::mymesh->getmeshdimension();
     if (dim > meshdim)
@@ -156,8 +273,11 @@ void rawfield::updateothershapefunctions(std::shared_ptr<rawfield> originalthis,
     disjointregions* drs = universe::mymesh->getdisjointregions();
     physicalregions* prs = universe::mymesh->getphysicalregions();
     
+    if (disjregs.size() == 0)
+        disjregs = drs->getindim(dim);
+    
     // Create temporary physical regions:
-    int physreg = prs->createfromdisjointregionlist(drs->getindim(dim));
+    int physreg = prs->createfromdisjointregionlist(disjregs);
     int dirichletphysreg;
     if (dim == 1)
         dirichletphysreg = prs->createfromdisjointregionlist(drs->getindim(0));
@@ -181,7 +301,7 @@ void rawfield::updateothershapefunctions(std::shared_ptr<rawfield> originalthis,
     dm->selectfield(shared_from_this());
     
     // Get the block diagonal info:
-    std::vector<int> alldrsindim = drs->getindim(dim);
+    std::vector<int> alldrsindim = disjregs;
     // Count the number of non-empty diagonal blocks:
     int numblocks = 0, preallocsize = 0;
     for (int d = 0; d < alldrsindim.size(); d++)
@@ -312,6 +432,39 @@ void rawfield::setupdateaccuracy(int extraintegrationorder)
         myupdateaccuracy = extraintegrationorder;
 }
 
+void rawfield::setprojectiontype(std::string projectiontype)
+{
+    if (projectiontype != "global" && projectiontype != "local")
+    {
+        std::cout << "Error in 'rawfield' object: unknown projection type '" << projectiontype << "' (use 'global' or 'local')" << std::endl;
+        abort();
+    }
+    
+    for (int i = 0; i < mysubfields.size(); i++)
+        mysubfields[i][0]->setprojectiontype(projectiontype);
+    for (int i = 0; i < myharmonics.size(); i++)
+    {
+        if (myharmonics[i].size() > 0)
+            myharmonics[i][0]->setprojectiontype(projectiontype);
+    }
+    // The harmonics are projected together in 'setvalue':
+    myprojectiontype = projectiontype;
+}
+
+std::shared_ptr<localprojection> rawfield::getlocalprojection(int physreg, int integrationorderdelta)
+{
+    for (int i = 0; i < mylocalprojections.size(); i++)
+    {
+        if (mylocalprojections[i]->getphysicalregion() == physreg && mylocalprojections[i]->getintegrationorderdelta() == integrationorderdelta)
+            return mylocalprojections[i];
+    }
+    
+    std::shared_ptr<localprojection> newprojection(new localprojection(physreg, integrationorderdelta));
+    mylocalprojections.push_back(newprojection);
+    
+    return newprojection;
+}
+
 rawfield::rawfield(std::string fieldtypename, const std::vector<int> harmonicnumbers, bool ismultiharm)
 {
     multiharmonic = ismultiharm;
@@ -730,6 +883,20 @@ void rawfield::setvalue(int physreg, int numfftharms, expression* meshdeform, ex
     {
         field thisfield(getpointer());
     
+        // Project element by element:
+        if (islocalprojection() && input.iszero() == false)
+        {
+            integration projectionterm;
+            if (meshdeform == NULL)
+                projectionterm = integration(physreg, numfftharms, sl::dof(thisfield)*sl::tf(thisfield) - sl::tf(thisfield)*input, extraintegrationdegree);
+            else
+                projectionterm = integration(physreg, numfftharms, *meshdeform, sl::dof(thisfield)*sl::tf(thisfield) - sl::tf(thisfield)*input, extraintegrationdegree);
+            
+            vec solvec = getlocalprojection(physreg, extraintegrationdegree)->project(projectionterm, true);
+            setdata(physreg, solvec|thisfield, "set");
+            return;
+        }
+        
         // Compute the projection of the expression (skip for a zero expression):
         formulation projectedvalue;
         if (meshdeform == NULL)
@@ -2382,6 +2549,14 @@ std::vector<std::vector<densematrix>> rawfield::interpolate(int whichderivative,
             // we require that all elements have the same total orientation.
             densematrix myformfunctionvalue = val->tomatrix(totalorientation, interpolorder, whichderivative, formfunctioncomponent);
             
+            // Sum-factorized interpolation on quadrangles and hexahedra at high order:
+            if (universe::issumfactorized(elementtypenumber, interpolorder))
+            {
+                std::shared_ptr<sumfactorization> sumfact = universe::getsumfactorization(val, mytypename, elementtypenumber, interpolorder, totalorientation, whichderivative, formfunctioncomponent, evaluationcoordinates);
+                if (sumfact->isvalid())
+                    return {{},{sumfact->interpolate(mycoefs.gettranspose())}};
+            }
+            
             mycoefs.transpose();
             densematrix coefstimesformfunctions = mycoefs.multiply(myformfunctionvalue);
 
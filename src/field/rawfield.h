@@ -48,6 +48,7 @@
 #include "field.h"
 #include "vectorfieldselect.h"
 #include "spanningtree.h"
+#include "sumfactorization.h"
 #include "rawmesh.h"
 
 class rawmesh;
@@ -57,6 +58,7 @@ class rawvec;
 class expression;
 class elementselector;
 class spanningtree;
+class localprojection;
 
 class rawfield : public std::enable_shared_from_this<rawfield>
 {
@@ -117,6 +119,11 @@ class rawfield : public std::enable_shared_from_this<rawfield>
         
         int myupdateaccuracy = 0;
         
+        // Projection type used in 'setvalue' and for the constraints ("global" or "local"):
+        std::string myprojectiontype = "global";
+        // Cached local projections (one per physical region and integration order delta):
+        std::vector<std::shared_ptr<localprojection>> mylocalprojections = {};
+        
         
         // Mesh on which this object is based:
         std::shared_ptr<rawmesh> myrawmesh = NULL;
@@ -128,14 +135,23 @@ class rawfield : public std::enable_shared_from_this<rawfield>
         void synchronize(std::vector<int> physregsfororder = {}, std::vector<int> disjregsfororder = {});
         
         void updateshapefunctions(std::shared_ptr<rawfield> originalthis, bool withtiming = false);
+        // Copy the coefficients of 'originalthis' after a p-adaptation (returns false if not possible, i.e. after a 
+        // h-adaptation). 'istoproject' flags the disjoint regions on which the copied values must be reprojected.
+        bool copyshapefunctions(std::shared_ptr<rawfield> originalthis, std::vector<bool>& istoproject);
         void updatenodalshapefunctions(std::shared_ptr<rawfield> originalthis);
-        void updateothershapefunctions(std::shared_ptr<rawfield> originalthis, int dim);
+        // Only the disjoint regions in 'disjregs' are updated (all in dimension 'dim' if empty):
+        void updateothershapefunctions(std::shared_ptr<rawfield> originalthis, int dim, std::vector<int> disjregs = {});
         
         void allowsynchronizing(bool allowit);
         void allowvaluesynchronizing(bool allowit);
         
         void setupdateaccuracy(int extraintegrationorder);
         
+        void setprojectiontype(std::string projectiontype);
+        bool islocalprojection(void) { return (myprojectiontype == "local"); };
+        // Get the cached local projection object for a physical region and integration order delta:
+        std::shared_ptr<localprojection> getlocalprojection(int physreg, int integrationorderdelta);
+        
         rawfield(std::string fieldtypename, const std::vector<int> harmonicnumbers, bool ismultiharm);
         rawfield(void);
         // Get a new field with interpolation orders from 'dm' (the corresponding field must have been selected in 'dm'):
@@ -108,6 +108,9 @@ void contribution::generate(std::shared_ptr<rawvec> myvec, std::shared_ptr<rawma
             isorientationdependent = (isorientationdependent || mycoeffs[term]->isvalueorientationdependent(mydisjregs) || (meshdeformationptr != NULL && meshdeformationptr->isvalueorientationdependent(mydisjregs)));
         }
         
+        // Use sum factorization on quadrangles and hexahedra at high order:
+        bool issumfactorizable = (not(isbarycentereval) && not(isdofinterpolate) && universe::issumfactorized(elementtypenumber, std::max(tfinterpolationorder, dofinterpolationorder)));
+        
         // Loop on all total orientations (if required):
         elementselector myselector(mydisjregs, isorientationdependent);
         dofinterpolate mydofinterp;
@@ -154,24 +157,41 @@ void contribution::generate(std::shared_ptr<rawvec> myvec, std::shared_ptr<rawma
                 densematrix doftimestestfun;
                 tfformfunctionvalue = tfval.tomatrix(myselector.gettotalorientation(), tfinterpolationorder, mytfs[term]->getkietaphiderivative(), mytfs[term]->getformfunctioncomponent());
                 
-                // Multiply by the weights:
-                if (not(isbarycentereval))
-                    tfformfunctionvalue.multiplycolumns(weights);
-                if (doffield != NULL)
+                // The sum-factorized path does not need the dof*tf product (the weights are applied to the coefficients):
+                std::shared_ptr<sumfactorization> tfsumfact, dofsumfact;
+                bool issumfactorized = false;
+                if (issumfactorizable)
                 {
-                    if (isdofinterpolate)
+                    tfsumfact = universe::getsumfactorization(&tfval, tffield->gettypename(), elementtypenumber, tfinterpolationorder, myselector.gettotalorientation(), mytfs[term]->getkietaphiderivative(), mytfs[term]->getformfunctioncomponent(), evaluationpoints);
+                    issumfactorized = tfsumfact->isvalid();
+                    if (doffield != NULL && issumfactorized)
                     {
-                        dofformfunctionvalue = mydofinterp.getvalues(myselector, term);
-                        doftimestestfun = dofformfunctionvalue.dofinterpoltimestf(tfformfunctionvalue);
+                        dofsumfact = universe::getsumfactorization(&dofval, doffield->gettypename(), elementtypenumber, dofinterpolationorder, myselector.gettotalorientation(), mydofs[term]->getkietaphiderivative(), mydofs[term]->getformfunctioncomponent(), evaluationpoints);
+                        issumfactorized = dofsumfact->isvalid();
                     }
-                    else
+                }
+                
+                if (not(issumfactorized))
+                {
+                    // Multiply by the weights:
+                    if (not(isbarycentereval))
+                        tfformfunctionvalue.multiplycolumns(weights);
+                    if (doffield != NULL)
                     {
-                        dofformfunctionvalue = dofval.tomatrix(myselector.gettotalorientation(), dofinterpolationorder, mydofs[term]->getkietaphiderivative(), mydofs[term]->getformfunctioncomponent());
-                        doftimestestfun = tfformfunctionvalue.multiplyallrows(dofformfunctionvalue);
+                        if (isdofinterpolate)
+                        {
+                            dofformfunctionvalue = mydofinterp.getvalues(myselector, term);
+                            doftimestestfun = dofformfunctionvalue.dofinterpoltimestf(tfformfunctionvalue);
+                        }
+                        else
+                        {
+                            dofformfunctionvalue = dofval.tomatrix(myselector.gettotalorientation(), dofinterpolationorder, mydofs[term]->getkietaphiderivative(), mydofs[term]->getformfunctioncomponent());
+                            doftimestestfun = tfformfunctionvalue.multiplyallrows(dofformfunctionvalue);
+                        }
                     }
+                    else
+                        doftimestestfun = tfformfunctionvalue;
                 }
-                else
-                    doftimestestfun = tfformfunctionvalue;
 
                 ///// Since the interpolation orders are identical for all harmonics
                 // we can premultiply all coefficients by the same dof*tf product.
@@ -181,6 +201,17 @@ void contribution::generate(std::shared_ptr<rawvec> myvec, std::shared_ptr<rawma
                     {
                         if (not(isbarycentereval))
                             currentcoeff[h][0].multiplyelementwise(detjac);
+                        
+                        if (issumfactorized)
+                        {
+                            currentcoeff[h][0].multiplycolumns(weights);
+                            if (doffield != NULL)
+                                currentcoeff[h][0] = sumfactorization::getelementmatrices(*tfsumfact, *dofsumfact, currentcoeff[h][0]);
+                            else
+                                currentcoeff[h][0] = tfsumfact->integrate(currentcoeff[h][0]).gettranspose();
+                            continue;
+                        }
+                        
                         currentcoeff[h][0].transpose();
                         
                         if (isdofinterpolate)
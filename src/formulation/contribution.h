@@ -30,6 +30,7 @@
 #include "rawvec.h"
 #include "rawmat.h"
 #include "wallclock.h"
+#include "sumfactorization.h"
 #include "operation.h"
 
 class rawvec;
@@ -216,6 +216,46 @@ std::vector<bool> dofmanager::isconstrained(void)
     return output;
 }
 
+std::vector<int> dofmanager::getinteriorelements(void)
+{
+    synchronize();
+    
+    disjointregions* mydisjointregions = universe::mymesh->getdisjointregions();
+    int meshdim = universe::mymesh->getmeshdimension();
+    
+    // Number the elements of highest dimension consecutively over all disjoint regions:
+    std::vector<int> elementoffset(mydisjointregions->count(), -1);
+    int numelems = 0;
+    for (int d = 0; d < mydisjointregions->count(); d++)
+    {
+        if (mydisjointregions->getelementdimension(d) == meshdim)
+        {
+            elementoffset[d] = numelems;
+            numelems += mydisjointregions->countelements(d);
+        }
+    }
+    
+    std::vector<int> output(numberofdofs, -1);
+    
+    for (int fieldindex = 0; fieldindex < rangebegin.size(); fieldindex++)
+    {
+        for (int disjreg = 0; disjreg < rangebegin[fieldindex].size(); disjreg++)
+        {
+            if (elementoffset[disjreg] == -1)
+                continue;
+                
+            for (int ff = 0; ff < rangebegin[fieldindex][disjreg].size(); ff++)
+            {
+                int numdofshere = rangeend[fieldindex][disjreg][ff] - rangebegin[fieldindex][disjreg][ff] + 1;
+                for (int i = 0; i < numdofshere; i++)
+                    output[rangebegin[fieldindex][disjreg][ff] + i] = elementoffset[disjreg] + i;
+            }
+        }
+    }
+    
+    return output;
+}
+
 intdensematrix dofmanager::getconstrainedindexes(void)
 {
     std::vector<bool> isconstr = isconstrained();
@@ -95,6 +95,10 @@ class dofmanager
         std::vector<bool> isconstrained(void);
         intdensematrix getconstrainedindexes(void);
         
+        // Get for every dof the number of the element whose interior holds it (-1 if the dof is shared by several elements).
+        // Interior dofs are those of the form functions associated to the elements of highest dimension in the mesh.
+        std::vector<int> getinteriorelements(void);
+        
         int countdisjregconstraineddofs(void);
         intdensematrix getdisjregconstrainedindexes(void);
         
@@ -207,6 +207,14 @@ void formulation::generaterhs(void)
 }
 
 
+int formulation::countcontributionnumbers(void)
+{
+    int output = 0;
+    for (int i = 0; i < mycontributions.size(); i++)
+        output = std::max(output, (int)mycontributions[i].size());
+    return output;
+}
+
 void formulation::generatein(int rhskcm, std::vector<int> contributionnumbers)
 {
     for (int i = 0; i < contributionnumbers.size(); i++)
@@ -80,6 +80,9 @@ class formulation
         void generatemassmatrix(void);
         void generaterhs(void);
         
+        // Number of contribution numbers (the highest one used in the rhs, K, C or M plus one):
+        int countcontributionnumbers(void);
+        
         void generatein(int rhskcm, std::vector<int> contributionnumbers);
         void generate(std::vector<int> contributionnumbers);
         void generate(int contributionnumber);
@@ -0,0 +1,267 @@
+#include "localprojection.h"
+
+
+void solveblockrange(int firstblock, int lastblock, int* blocksizes, long long int* vecoffsets, long long int* matoffsets, double* blockvals, double* vvals, double* outvals)
+{
+    for (int n = firstblock; n <= lastblock; n++)
+    {
+        long long int cs = blocksizes[n];
+        double* curblock = blockvals + matoffsets[n];
+        double* curv = vvals + vecoffsets[n];
+        double* curout = outvals + vecoffsets[n];
+
+        // Loop on all block columns:
+        for (long long int j = 0; j < cs; j++)
+        {
+            for (long long int i = 0; i < cs; i++)
+                curout[i] += curblock[j*cs+i] * curv[j];
+        }
+    }
+}
+
+std::vector<int> localprojection::getstructure(std::shared_ptr<dofmanager> dm)
+{
+    std::vector<std::shared_ptr<rawfield>> fields = dm->getfields();
+
+    std::vector<int> output = {dm->countdofs(), (int)fields.size()};
+    for (int f = 0; f < fields.size(); f++)
+    {
+        dm->selectfield(fields[f]);
+        std::vector<int> curorders = dm->getselectedfieldorders();
+        output.insert(output.end(), curorders.begin(), curorders.end());
+    }
+
+    return output;
+}
+
+void localprojection::getblocks(std::shared_ptr<dofmanager> dm, std::vector<int> disjregs, int dim)
+{
+    disjointregions* drs = universe::mymesh->getdisjointregions();
+    std::vector<std::shared_ptr<rawfield>> fields = dm->getfields();
+
+    // Count the number of non-empty diagonal blocks:
+    int numblocks = 0, numblockdofs = 0;
+    for (int f = 0; f < fields.size(); f++)
+    {
+        dm->selectfield(fields[f]);
+        for (int i = 0; i < disjregs.size(); i++)
+        {
+            if (dm->isdefined(disjregs[i], 0) == false)
+                continue;
+            int numelemsindr = drs->countelements(disjregs[i]);
+            int numffindr = dm->countformfunctions(disjregs[i]);
+            numblocks += numelemsindr;
+            numblockdofs += numelemsindr * numffindr;
+        }
+    }
+
+    myblocksizes[dim] = intdensematrix(numblocks, 1);
+    myblockdofs[dim] = intdensematrix(numblockdofs, 1);
+    int* bsvals = myblocksizes[dim].getvalues();
+    int* bdvals = myblockdofs[dim].getvalues();
+
+    // Bring together the dofs of every diagonal block:
+    int blockindex = 0, dofindex = 0;
+    for (int f = 0; f < fields.size(); f++)
+    {
+        dm->selectfield(fields[f]);
+        for (int i = 0; i < disjregs.size(); i++)
+        {
+            if (dm->isdefined(disjregs[i], 0) == false)
+                continue;
+            int numelemsindr = drs->countelements(disjregs[i]);
+            int numffindr = dm->countformfunctions(disjregs[i]);
+            int rb = dm->getrangebegin(disjregs[i], 0);
+
+            for (int e = 0; e < numelemsindr; e++)
+            {
+                bsvals[blockindex+e] = numffindr;
+                for (int ff = 0; ff < numffindr; ff++)
+                    bdvals[dofindex+e*numffindr+ff] = rb+numelemsindr*ff+e;
+            }
+            blockindex += numelemsindr;
+            dofindex += numelemsindr * numffindr;
+        }
+    }
+}
+
+densematrix localprojection::solveblocks(int dim, densematrix v)
+{
+    int numblocks = myblocksizes[dim].count();
+    int* bsvals = myblocksizes[dim].getvalues();
+
+    // Position of every block in the vector and in the inverted blocks:
+    std::vector<long long int> vecoffsets(numblocks+1, 0), matoffsets(numblocks+1, 0);
+    for (int n = 0; n < numblocks; n++)
+    {
+        vecoffsets[n+1] = vecoffsets[n] + bsvals[n];
+        matoffsets[n+1] = matoffsets[n] + bsvals[n]*bsvals[n];
+    }
+
+    densematrix output(v.countrows(), v.countcolumns(), 0.0);
+    double* blockvals = myinvertedblocks[dim].getvalues();
+    double* vvals = v.getvalues();
+    double* outvals = output.getvalues();
+
+    int numthreadstouse = std::min((int)(matoffsets[numblocks]/10000)+1, universe::getmaxnumthreads()); // require a min work per thread
+    numthreadstouse = std::max(std::min(numthreadstouse, numblocks), 1);
+
+    int blockchunksize = numblocks/numthreadstouse+1;
+    threadpool::run(numthreadstouse, [&](int t)
+    {
+        solveblockrange(t*blockchunksize, std::min((t+1)*blockchunksize-1, numblocks-1), bsvals, vecoffsets.data(), matoffsets.data(), blockvals, vvals, outvals);
+    });
+
+    return output;
+}
+
+localprojection::localprojection(int physreg, int integrationorderdelta)
+{
+    myphysreg = physreg;
+    myintegrationorderdelta = integrationorderdelta;
+}
+
+vec localprojection::project(integration projectionterm, bool withconstraints)
+{
+    disjointregions* drs = universe::mymesh->getdisjointregions();
+    physicalregions* prs = universe::mymesh->getphysicalregions();
+
+    std::vector<int> alldisjregs = prs->get(myphysreg)->getdisjointregions(-1);
+    int physregdim = prs->get(myphysreg)->getelementdimension();
+
+    // The tfs of dimension d are integrated on the elements of dimension d. The dofs
+    // of all lower dimensions are included to get the coupling with the values
+    // already computed. Create the corresponding temporary physical regions:
+    std::vector<std::vector<int>> blockdisjregs(physregdim+1);
+    std::vector<int> tempphysregs(physregdim+1, -1);
+    std::vector<int> lowerdisjregs = {};
+    for (int d = 0; d <= physregdim; d++)
+    {
+        for (int i = 0; i < alldisjregs.size(); i++)
+        {
+            if (drs->getelementdimension(alldisjregs[i]) == d)
+                blockdisjregs[d].push_back(alldisjregs[i]);
+        }
+        lowerdisjregs = myalgorithm::concatenate({lowerdisjregs, blockdisjregs[d]});
+
+        if (blockdisjregs[d].size() > 0)
+            tempphysregs[d] = prs->createfromdisjointregionlist(lowerdisjregs);
+    }
+
+    // Block number d holds the projection on dimension d:
+    formulation projection;
+    projection.isconstraintcomputation = true;
+    for (int d = 0; d <= physregdim; d++)
+    {
+        if (tempphysregs[d] == -1)
+            continue;
+        if (projectionterm.ismeshdeformdefined())
+            projection += integration(tempphysregs[d], projectionterm.getnumberofcoefharms(), projectionterm.getmeshdeform(), projectionterm.getexpression(), myintegrationorderdelta, d);
+        else
+            projection += integration(tempphysregs[d], projectionterm.getnumberofcoefharms(), projectionterm.getexpression(), myintegrationorderdelta, d);
+    }
+    std::shared_ptr<dofmanager> dm = projection.getdofmanager();
+
+    vec output(projection);
+    std::vector<bool> isconstr;
+    if (withconstraints)
+    {
+        output.updateconstraints();
+        isconstr = dm->isconstrained();
+    }
+
+    // The mass matrix changes with the mesh deformation:
+    std::vector<int> curstructure = getstructure(dm);
+    bool iscachevalid = (projectionterm.ismeshdeformdefined() == false && myptracker == universe::mymesh->getptracker() && mystructure == curstructure);
+    if (iscachevalid == false)
+    {
+        mymats = std::vector<mat>(physregdim+1);
+        myblockdofs = std::vector<intdensematrix>(physregdim+1);
+        myblocksizes = std::vector<intdensematrix>(physregdim+1);
+        myinvertedblocks = std::vector<densematrix>(physregdim+1);
+    }
+
+    for (int d = 0; d <= physregdim; d++)
+    {
+        if (tempphysregs[d] == -1)
+            continue;
+
+        if (iscachevalid == false)
+        {
+            getblocks(dm, blockdisjregs[d], d);
+            if (myblockdofs[d].count() > 0)
+            {
+                projection.generatein(1, {d});
+                mymats[d] = projection.K();
+
+                // Invert the diagonal blocks:
+                long long int preallocsize = 0;
+                int* bsvals = myblocksizes[d].getvalues();
+                for (int n = 0; n < myblocksizes[d].count(); n++)
+                    preallocsize += bsvals[n]*bsvals[n];
+                myinvertedblocks[d] = densematrix(preallocsize, 1);
+                IS blockis;
+                ISCreateGeneral(PETSC_COMM_SELF, myblockdofs[d].count(), myblockdofs[d].getvalues(), PETSC_USE_POINTER, &blockis);
+                Mat blockmat;
+                MatCreateSubMatrix(mymats[d].getapetsc(), blockis, blockis, MAT_INITIAL_MATRIX, &blockmat);
+                MatInvertVariableBlockDiagonal(blockmat, myblocksizes[d].count(), myblocksizes[d].getvalues(), myinvertedblocks[d].getvalues());
+                MatDestroy(&blockmat);
+                ISDestroy(&blockis);
+            }
+        }
+
+        int numblockdofs = myblockdofs[d].count();
+        if (numblockdofs == 0)
+            continue;
+
+        projection.generatein(0, {d});
+        vec b = projection.rhs(false, false);
+
+        // Keep the constrained values and clear the current dimension before moving the lower dimensions to the rhs:
+        densematrix imposedvals = output.getvalues(myblockdofs[d]);
+        output.setvalues(myblockdofs[d], densematrix(numblockdofs, 1, 0.0));
+
+        densematrix rhsvals = b.getvalues(myblockdofs[d]);
+        rhsvals.subtract((mymats[d]*output).getvalues(myblockdofs[d]));
+
+        densematrix blockvals = solveblocks(d, rhsvals);
+
+        if (withconstraints)
+        {
+            int* bdvals = myblockdofs[d].getvalues();
+            double* bvals = blockvals.getvalues();
+            double* ivals = imposedvals.getvalues();
+            for (int i = 0; i < numblockdofs; i++)
+            {
+                if (isconstr[bdvals[i]])
+                    bvals[i] = ivals[i];
+            }
+        }
+        output.setvalues(myblockdofs[d], blockvals);
+    }
+
+    if (projectionterm.ismeshdeformdefined() == false)
+    {
+        myptracker = universe::mymesh->getptracker();
+        mystructure = curstructure;
+    }
+    else
+    {
+        // Nothing can be reused:
+        myptracker = NULL;
+        mymats = {};
+        myblockdofs = {};
+        myblocksizes = {};
+        myinvertedblocks = {};
+    }
+
+    std::vector<int> toremove = {};
+    for (int d = 0; d <= physregdim; d++)
+    {
+        if (tempphysregs[d] != -1)
+            toremove.push_back(tempphysregs[d]);
+    }
+    prs->remove(toremove, false);
+
+    return output;
+}
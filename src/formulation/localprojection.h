@@ -0,0 +1,83 @@
+// sparselizard - Copyright (C) see copyright file.
+//
+// See the LICENSE file for license information. Please report all
+// bugs and problems to <alexandre.halbach at gmail.com>.
+
+// This code calls the PETSc library. See https://www.mcs.anl.gov/petsc/ for more information.
+
+// This object computes the projection 'dof*tf - tf*input' of a field on a physical region without
+// solving a global system. Thanks to the hierarchical basis the projection is performed dimension
+// by dimension (nodes, then edges, then faces, then volumes) as in 'rawfield::updateothershapefunctions'.
+// At every step the values already computed on the lower dimension entities are moved to the rhs and
+// each node, edge, face or volume leads to a small independent system whose matrix is a diagonal block
+// of the mass matrix. The inverted diagonal blocks are cached and reused as long as the mesh and the
+// field orders do not change (not cached if the mesh is deformed by an expression).
+//
+// The result is identical to the global L2 projection for a value that can be exactly represented by
+// the field. Otherwise it is a slightly different (local) approximation of the value.
+
+#ifndef LOCALPROJECTION_H
+#define LOCALPROJECTION_H
+
+#include <iostream>
+#include <vector>
+#include "integration.h"
+#include "formulation.h"
+#include "dofmanager.h"
+#include "mat.h"
+#include "vec.h"
+#include "densematrix.h"
+#include "intdensematrix.h"
+#include "universe.h"
+#include "threadpool.h"
+#include "disjointregions.h"
+#include "physicalregions.h"
+#include "myalgorithm.h"
+#include "ptracker.h"
+#include "petsc.h"
+#include "petscmat.h"
+
+class localprojection
+{
+    private:
+
+        int myphysreg;
+        int myintegrationorderdelta;
+
+        // Mesh tracker and dof structure for which the cache below was computed:
+        std::shared_ptr<ptracker> myptracker = NULL;
+        std::vector<int> mystructure = {};
+
+        // For every dimension:
+        //
+        // - the projection matrix (rows of the tfs on that dimension are used)
+        // - the dofs of all diagonal blocks, block after block
+        // - the size of every block
+        // - the inverted blocks (column-major, block after block)
+        //
+        std::vector<mat> mymats = {};
+        std::vector<intdensematrix> myblockdofs = {};
+        std::vector<intdensematrix> myblocksizes = {};
+        std::vector<densematrix> myinvertedblocks = {};
+
+        // Get the signature of the dof structure in 'dm':
+        std::vector<int> getstructure(std::shared_ptr<dofmanager> dm);
+        // Compute the diagonal blocks of the projection matrix in dimension 'dim':
+        void getblocks(std::shared_ptr<dofmanager> dm, std::vector<int> disjregs, int dim);
+        // Multiply the inverted blocks of dimension 'dim' by 'v' (blocks are treated in parallel):
+        densematrix solveblocks(int dim, densematrix v);
+
+    public:
+
+        localprojection(int physreg, int integrationorderdelta);
+
+        int getphysicalregion(void) { return myphysreg; };
+        int getintegrationorderdelta(void) { return myintegrationorderdelta; };
+
+        // Project the 'dof*tf - tf*input' term on its physical region. The field
+        // constraints are imposed on the constrained dofs if 'withconstraints' is true.
+        // The output vector holds the projection on the whole physical region.
+        vec project(integration projectionterm, bool withconstraints);
+};
+
+#endif
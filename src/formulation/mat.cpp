@@ -118,6 +118,28 @@ mat mat::copy(void)
     return mat(std::shared_ptr<rawmat>(new rawmat(  rawmatptr->getdofmanager(), outa, outd, getainds().copy(), getdinds().copy()  )));
 }
 
+void mat::setlinearcombination(std::vector<double> coefs, std::vector<mat> terms)
+{
+    errorifpointerisnull(); errorifinvalidated();
+    
+    if (coefs.size() != terms.size())
+    {
+        std::cout << "Error in 'mat' object: expected one coefficient per term in the linear combination" << std::endl;
+        abort();
+    }
+    
+    Mat A = getapetsc();
+    Mat D = getdpetsc();
+    
+    MatZeroEntries(A);
+    MatZeroEntries(D);
+    
+    for (int i = 0; i < terms.size(); i++)
+    {
+        MatAXPY(A, coefs[i], terms[i].getapetsc(), SUBSET_NONZERO_PATTERN);
+        MatAXPY(D, coefs[i], terms[i].getdpetsc(), SUBSET_NONZERO_PATTERN);
+    }
+}
 
 mat mat::operator+(void) { return copy(); }
 mat mat::operator-(void) { return *this*-1; }
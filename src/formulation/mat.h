@@ -76,6 +76,10 @@ class mat
         
         mat copy(void);
         
+        // Overwrite the values with sum_i coefs[i]*terms[i]. The nonzero pattern of this matrix is kept
+        // (so that a symbolic factorization can be reused) and must include that of every term:
+        void setlinearcombination(std::vector<double> coefs, std::vector<mat> terms);
+        
         
         mat operator+(void);
         mat operator-(void);
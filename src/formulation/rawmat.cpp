@@ -35,6 +35,8 @@ rawmat::~rawmat(void)
             MatDestroy(&Dmat);
         if (isitfactored) 
             KSPDestroy(&myksp);
+        if (mydiagscaling != PETSC_NULL)
+            VecDestroy(&mydiagscaling);
     }
 }
 
@@ -216,19 +218,11 @@ void rawmat::process(std::vector<bool>& isconstrained)
     int numthreadstouse = std::min(ndofs/10000+1, universe::getmaxnumthreads()); // require a min num dofs per thread
 
     std::vector<int> nnzAparts(numthreadstouse, 0), nnzDparts(numthreadstouse, 0);    
-    if (numthreadstouse > 1)
+    int rowchunksize = ndofs/numthreadstouse+1;
+    threadpool::run(numthreadstouse, [&](int t)
     {
-        std::vector<std::thread> threadobjs(numthreadstouse);
-        int rowchunksize = ndofs/numthreadstouse+1;
-
-        for (int t = 0; t < numthreadstouse; t++)
-            threadobjs[t] = std::thread(processrows, t*rowchunksize, std::min((t+1)*rowchunksize-1, ndofs-1), maxnnzinrows.data(), adsofrows.data(), valsptr, &isconstrained, &nnzAparts[t], &nnzDparts[t]);
-        
-        for (int t = 0; t < numthreadstouse; t++)
-            threadobjs[t].join();
-    }
-    else
-        processrows(0, ndofs-1, maxnnzinrows.data(), adsofrows.data(), valsptr, &isconstrained, &nnzAparts[0], &nnzDparts[0]);
+        processrows(t*rowchunksize, std::min((t+1)*rowchunksize-1, ndofs-1), maxnnzinrows.data(), adsofrows.data(), valsptr, &isconstrained, &nnzAparts[t], &nnzDparts[t]);
+    });
 
     nnzA = myalgorithm::sum(nnzAparts);
     nnzD = myalgorithm::sum(nnzDparts);
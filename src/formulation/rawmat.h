@@ -18,7 +18,7 @@
 #include "memory.h"
 #include "petsc.h"
 #include "petscmat.h"
-#include <thread>
+#include "threadpool.h"
 
 class dofmanager;
 
@@ -45,6 +45,8 @@ class rawmat
         
         // 'myksp' will store the factorization if it is to be reused:
         KSP myksp = PETSC_NULL;
+        // Square root of the absolute diagonal of A before its in-place diagonal scaling by a mixed precision solve:
+        Vec mydiagscaling = PETSC_NULL;
         bool factorizationreuse = false;
         bool isitfactored = false;
         
@@ -94,6 +96,8 @@ class rawmat
         std::shared_ptr<dofmanager> getdofmanager(void);
         
         KSP* getksp(void);
+        
+        Vec* getdiagscaling(void) { return &mydiagscaling; };
 
 };
 
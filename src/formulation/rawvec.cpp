@@ -1,4 +1,5 @@
 #include "rawvec.h"
+#include "localprojection.h"
 
 
 void rawvec::synchronize(void)
@@ -146,7 +147,12 @@ void rawvec::updatedisjregconstraints(std::shared_ptr<rawfield> constrainedfield
             // Get an all zero vector:
             vec constraintvalvec(projectconstraint);
             // Zero valued constraints need not be computed:
-            if (fieldconstraints[disjreg]->isprojectionofzero == false)
+            if (fieldconstraints[disjreg]->isprojectionofzero == false && constrainedfield->islocalprojection())
+            {
+                std::shared_ptr<localprojection> lp = constrainedfield->getlocalprojection(fieldconstraints[disjreg]->getphysicalregion(), fieldconstraints[disjreg]->getintegrationorderdelta());
+                constraintvalvec = lp->project(*fieldconstraints[disjreg], false);
+            }
+            else if (fieldconstraints[disjreg]->isprojectionofzero == false)
             {
                 projectconstraint.generate();
                 constraintvalvec = sl::solve(projectconstraint.A(), projectconstraint.b());
@@ -15,43 +15,40 @@ intdensematrix::intdensematrix(long long int numberofrows, long long int numbero
 {
     numrows = numberofrows;
     numcols = numberofcolumns;
-    myvalues = std::shared_ptr<int>(new int[numcols*numrows]);
+    myvalues = memorypool::getbuffer<int>(numcols*numrows);
 }
 
 intdensematrix::intdensematrix(long long int numberofrows, long long int numberofcolumns, int initvalue)
 {
     numrows = numberofrows;
     numcols = numberofcolumns;
-    int* myvaluesptr = new int[numcols*numrows];
+    myvalues = memorypool::getbuffer<int>(numcols*numrows);
+    int* myvaluesptr = myvalues.get();
     
     for (long long int i = 0; i < numcols*numrows; i++)
         myvaluesptr[i] = initvalue;
-    
-    myvalues = std::shared_ptr<int>(myvaluesptr);
 }
 
 intdensematrix::intdensematrix(long long int numberofrows, long long int numberofcolumns, std::vector<int> valvec)
 {
     numrows = numberofrows;
     numcols = numberofcolumns;
-    int* myvaluesptr = new int[numcols*numrows];
+    myvalues = memorypool::getbuffer<int>(numcols*numrows);
+    int* myvaluesptr = myvalues.get();
     
     for (long long int i = 0; i < numcols*numrows; i++)
         myvaluesptr[i] = valvec[i];
-    
-    myvalues = std::shared_ptr<int>(myvaluesptr);
 }
 
 intdensematrix::intdensematrix(long long int numberofrows, long long int numberofcolumns, int init, int step)
 {
     numrows = numberofrows;
     numcols = numberofcolumns;
-    int* myvaluesptr = new int[numcols*numrows];
+    myvalues = memorypool::getbuffer<int>(numcols*numrows);
+    int* myvaluesptr = myvalues.get();
     
     for (long long int i = 0; i < numcols*numrows; i++)
         myvaluesptr[i] = init+i*step;
-    
-    myvalues = std::shared_ptr<int>(myvaluesptr);
 }
 
 intdensematrix::intdensematrix(std::vector<intdensematrix> input)
@@ -71,7 +68,8 @@ intdensematrix::intdensematrix(std::vector<intdensematrix> input)
             abort();
         }
     }
-    int* myvaluesptr = new int[numrows*numcols];
+    myvalues = memorypool::getbuffer<int>(numrows*numcols);
+    int* myvaluesptr = myvalues.get();
     
     long long int index = 0;
     for (long long int i = 0; i < input.size(); i++)
@@ -83,8 +81,6 @@ intdensematrix::intdensematrix(std::vector<intdensematrix> input)
             index++;
         }
     }
-    
-    myvalues = std::shared_ptr<int>(myvaluesptr);
 }
 
 long long int intdensematrix::countpositive(void)
@@ -243,7 +239,7 @@ intdensematrix intdensematrix::copy(void)
     // The pointed value has to be copied as well.
     if (intdensematrixcopy.myvalues != NULL)
     {
-        intdensematrixcopy.myvalues = std::shared_ptr<int>(new int[numcols*numrows]);
+        intdensematrixcopy.myvalues = memorypool::getbuffer<int>(numcols*numrows);
         int* copiedmyvaluesptr = intdensematrixcopy.myvalues.get();
         int* myvaluesptr = myvalues.get();
         for (long long int i = 0; i < numcols*numrows; i++)
@@ -6,6 +6,7 @@
 
 // This object stores the ROW-MAJOR values of a dense matrix of int.
 // In other words the matrix is stored as [row1 row2 row3 ...].
+// The values are stored in a 64-byte aligned buffer provided by the 'memorypool' object.
 
 #ifndef INTDENSEMATRIX_H
 #define INTDENSEMATRIX_H
@@ -13,6 +14,7 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include "memorypool.h"
 
 class intdensematrix
 {   
@@ -0,0 +1,123 @@
+#include "memorypool.h"
+#include <vector>
+#include <cstdlib>
+
+
+// Buffers freed after the cache of the thread is destroyed (e.g. by static objects at exit) are directly freed:
+static thread_local bool iscachedestroyed = false;
+
+// Free lists of a thread (one per size class). The buffers left are freed when the thread ends.
+struct memorypoolcache
+{
+    std::vector<std::vector<void*>> freelists;
+    long long int cachedbytes = 0;
+    
+    void clear(void)
+    {
+        for (int c = 0; c < freelists.size(); c++)
+        {
+            for (int i = 0; i < freelists[c].size(); i++)
+                free(freelists[c][i]);
+            freelists[c] = {};
+        }
+        cachedbytes = 0;
+    }
+    
+    ~memorypoolcache(void) { clear(); iscachedestroyed = true; }
+};
+
+static thread_local memorypoolcache mycache;
+
+
+std::atomic<long long int> memorypool::numallocations(0);
+std::atomic<long long int> memorypool::numsystemallocations(0);
+std::atomic<long long int> memorypool::numallocatedbytes(0);
+
+int memorypool::getsizeclass(long long int numbytes)
+{
+    long long int blocksize = 64;
+    int sizeclass = 0;
+    while (blocksize < numbytes)
+    {
+        blocksize *= 2;
+        sizeclass++;
+    }
+    
+    if (sizeclass < numsizeclasses)
+        return sizeclass;
+    else
+        return -1;
+}
+
+void* memorypool::allocate(long long int numbytes)
+{
+    numallocations.fetch_add(1, std::memory_order_relaxed);
+    numallocatedbytes.fetch_add(numbytes, std::memory_order_relaxed);
+
+    int sizeclass = getsizeclass(numbytes);
+    
+    // Reuse a free buffer of the same size class:
+    if (sizeclass >= 0 && not(iscachedestroyed) && sizeclass < mycache.freelists.size() && mycache.freelists[sizeclass].size() > 0)
+    {
+        void* ptr = mycache.freelists[sizeclass].back();
+        mycache.freelists[sizeclass].pop_back();
+        mycache.cachedbytes -= (64LL << sizeclass);
+        return ptr;
+    }
+    
+    numsystemallocations.fetch_add(1, std::memory_order_relaxed);
+    
+    long long int blocksize = numbytes;
+    if (sizeclass >= 0)
+        blocksize = 64LL << sizeclass;
+    if (blocksize == 0)
+        blocksize = 64;
+    
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, 64, blocksize) != 0)
+    {
+        std::cout << "Error in 'memorypool' object: could not allocate " << blocksize << " bytes" << std::endl;
+        abort();
+    }
+    return ptr;
+}
+
+void memorypool::deallocate(void* ptr, long long int numbytes)
+{
+    int sizeclass = getsizeclass(numbytes);
+    
+    if (sizeclass < 0 || iscachedestroyed || mycache.cachedbytes + (64LL << sizeclass) > maxcachedbytes)
+    {
+        free(ptr);
+        return;
+    }
+    
+    if (mycache.freelists.size() == 0)
+        mycache.freelists.resize(numsizeclasses);
+    
+    mycache.freelists[sizeclass].push_back(ptr);
+    mycache.cachedbytes += (64LL << sizeclass);
+}
+
+void memorypool::resetcounters(void)
+{
+    numallocations = 0;
+    numsystemallocations = 0;
+    numallocatedbytes = 0;
+}
+
+void memorypool::print(void)
+{
+    long long int numalloc = numallocations, numsysalloc = numsystemallocations;
+    
+    std::cout << "Dense matrix buffers: " << numalloc << " requested (" << numallocatedbytes << " bytes), " << numsysalloc << " system allocations";
+    if (numalloc > 0)
+        std::cout << " (" << 100.0*(numalloc-numsysalloc)/numalloc << "% reused)";
+    std::cout << std::endl;
+}
+
+void memorypool::release(void)
+{
+    if (not(iscachedestroyed))
+        mycache.clear();
+}
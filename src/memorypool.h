@@ -0,0 +1,71 @@
+// sparselizard - Copyright (C) see copyright file.
+//
+// See the LICENSE file for license information. Please report all
+// bugs and problems to <alexandre.halbach at gmail.com>.
+
+// This object provides the value buffers of the 'densematrix' and 'intdensematrix' objects.
+// Buffers are 64-byte aligned and rounded up to a power of two size class. Freed buffers are
+// kept in a free list of the calling thread and reused by the next request of the same size 
+// class so that the many temporaries created during assembly do not each hit the system 
+// allocator. Buffers larger than the largest size class are directly allocated and freed.
+
+
+#ifndef MEMORYPOOL_H
+#define MEMORYPOOL_H
+
+#include <iostream>
+#include <memory>
+#include <atomic>
+
+class memorypool
+{
+    private:
+        
+        // Smallest size class is 64 bytes, the largest is 64 x 2^(numsizeclasses-1) bytes (4 MB):
+        static const int numsizeclasses = 17;
+        
+        // Maximum number of bytes kept in the free lists of a thread:
+        static const long long int maxcachedbytes = 67108864;
+        
+        // Instrumentation:
+        static std::atomic<long long int> numallocations;
+        static std::atomic<long long int> numsystemallocations;
+        static std::atomic<long long int> numallocatedbytes;
+        
+        // Size class of a request (-1 if too large for the pool):
+        static int getsizeclass(long long int numbytes);
+        
+        static void* allocate(long long int numbytes);
+        static void deallocate(void* ptr, long long int numbytes);
+        
+    public:
+        
+        // Get an aligned buffer holding 'count' values of type T (uninitialized):
+        template <typename T>
+        static std::shared_ptr<T> getbuffer(long long int count);
+        
+        // Number of buffers requested and number of them that required a system allocation:
+        static long long int countallocations(void) { return numallocations; };
+        static long long int countsystemallocations(void) { return numsystemallocations; };
+        // Total number of bytes requested:
+        static long long int countallocatedbytes(void) { return numallocatedbytes; };
+        
+        static void resetcounters(void);
+        
+        // Print the allocation counters:
+        static void print(void);
+        
+        // Free all buffers kept in the free lists of the calling thread:
+        static void release(void);
+};
+
+template <typename T>
+std::shared_ptr<T> memorypool::getbuffer(long long int count)
+{
+    long long int numbytes = count*sizeof(T);
+    T* ptr = (T*)allocate(numbytes);
+    
+    return std::shared_ptr<T>(ptr, [numbytes](T* p){ memorypool::deallocate(p, numbytes); });
+}
+
+#endif
@@ -1293,6 +1293,41 @@ void elements::reorderbydisjointregions(std::vector<std::vector<int>>& elementre
     }
 }
 
+void elements::reorderbylocality(std::string curvetype)
+{
+    if (curvetype == "none")
+        return;
+    
+    // Same box for all element types:
+    std::vector<double> bounds = myalgorithm::getcoordbounds(*(mynodes->getcoordinates()));
+    
+    for (int typenum = 0; typenum <= 7; typenum++)
+    {
+        if (count(typenum) == 0)
+            continue;
+        
+        std::vector<double> barys = computebarycenters(typenum);
+        std::vector<unsigned long long int> keys = myalgorithm::getspacefillingcurvekeys(barys, bounds, curvetype);
+    
+        // The elements stay sorted by disjoint regions:
+        std::vector<int> elementreordering;
+        myalgorithm::stablesort(indisjointregion[typenum], keys, elementreordering);
+        
+        std::vector<int> elementrenumbering(count(typenum));
+        for (int i = 0; i < count(typenum); i++)
+            elementrenumbering[elementreordering[i]] = i;
+        
+        reorder(typenum, elementreordering);
+        renumber(typenum, elementrenumbering);
+
+        for (int physregindex = 0; physregindex < myphysicalregions->count(); physregindex++)
+        {
+            physicalregion* currentphysicalregion = myphysicalregions->getatindex(physregindex);
+            currentphysicalregion->renumberelements(typenum, elementrenumbering);
+        }
+    }
+}
+
 void elements::definedisjointregionsranges(void)
 {
     for (int typenum = 0; typenum <= 7; typenum++)
@@ -218,6 +218,10 @@ class elements
         void reorderbydisjointregions(void);
         // Same but here the renumbering used is provided in 'elementrenumbering' upon return.
         void reorderbydisjointregions(std::vector<std::vector<int>>& elementrenumbering);
+        // Reorder the nodes and the elements inside each disjoint region along a space-filling curve ("hilbert" or 
+        // "morton") so that elements close in space are close in memory. Nothing is done for "none". To call after
+        // 'reorderbydisjointregions' (the disjoint region ranges are unchanged).
+        void reorderbylocality(std::string curvetype);
         void definedisjointregionsranges(void);
         
         // Get a vector whose index i is true if node i is a corner node:
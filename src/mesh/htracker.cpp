@@ -1,6 +1,7 @@
 #include "htracker.h"
 #include "myalgorithm.h"
 #include "lagrangeformfunction.h"
+#include "universe.h"
 
 
 htracker::htracker(std::shared_ptr<rawmesh> origmesh, int curvatureorder, std::vector<int> numelemspertype)
@@ -49,6 +50,8 @@ htracker::htracker(std::shared_ptr<rawmesh> origmesh, int curvatureorder, std::v
     
     // Initialize the tree:
     splitdata = std::vector<bool>(numleaves, false);
+    treeoffsets = myalgorithm::getequallyspaced(0, 1, numleaves+1);
+    leafoffsets = treeoffsets;
     
     // Initialize the remaining containers:
     transitionsrefcoords = std::vector<std::vector<double>>(8, std::vector<double>(0));
@@ -97,106 +100,122 @@ int htracker::getmaxdepth(void)
     return maxdepth;
 }
 
-void htracker::resetcursor(bool calcrefcoords)
+void htracker::resetcursor(htcursor& c, bool calcrefcoords, int origelem)
 {
-    isrefcalc = calcrefcoords;
-
-    cursorposition = 0;
-    currentdepth = 0;
-    origindexintype = 0;
-    // Find the first not empty type:
-    parenttypes = std::vector<int>(maxdepth+1,0);
-    while (originalcount[parenttypes[0]] == 0)
-        parenttypes[0]++;
-    indexesinclusters = std::vector<int>(maxdepth+1,0);
-    parentrefcoords = std::vector<std::vector<std::vector<double>>>(maxdepth+1, std::vector<std::vector<double>>(10));
-    if (isrefcalc)
-        parentrefcoords[0] = {straightrefcoords[parenttypes[0]]};
+    c.isrefcalc = calcrefcoords;
+
+    c.cursorposition = treeoffsets[origelem];
+    c.currentdepth = 0;
+    // Find the type and index in type of the original element (empty types are skipped):
+    c.parenttypes = std::vector<int>(maxdepth+1,0);
+    c.origindexintype = origelem;
+    while (c.origindexintype >= originalcount[c.parenttypes[0]] && c.parenttypes[0] < 7)
+    {
+        c.origindexintype -= originalcount[c.parenttypes[0]];
+        c.parenttypes[0]++;
+    }
+    c.indexesinclusters = std::vector<int>(maxdepth+1,0);
+    c.parentrefcoords = std::vector<std::vector<std::vector<double>>>(maxdepth+1, std::vector<std::vector<double>>(10));
+    if (c.isrefcalc)
+    {
+        c.parentrefcoords[0] = {straightrefcoords[c.parenttypes[0]]};
+        c.myelems = myelems;
+        c.mycurvedelems = mycurvedelems;
+    }
+    c.deferredwrites = {};
 }
 
-int htracker::next(void)
+int htracker::next(htcursor& c)
 {
-    elements* myelements = getoriginalmesh()->getelements();
-
     int throughedgenum = -1;
 
     // If not split we are at a leaf:
-    if (splitdata[cursorposition] == false)
+    if (splitdata[c.cursorposition] == false)
     {
-        cursorposition++;
-        
-        if (currentdepth > 0)
-        {            
+        c.cursorposition++;
+
+        if (c.currentdepth > 0)
+        {
             // Move back up in the tree as much as needed:
-            indexesinclusters[currentdepth]++;
-            while (currentdepth > 0 && indexesinclusters[currentdepth] == numsubelems[parenttypes[currentdepth-1]])
+            c.indexesinclusters[c.currentdepth]++;
+            while (c.currentdepth > 0 && c.indexesinclusters[c.currentdepth] == numsubelems[c.parenttypes[c.currentdepth-1]])
             {
-                currentdepth--;
-                indexesinclusters[currentdepth]++;
+                c.currentdepth--;
+                c.indexesinclusters[c.currentdepth]++;
             }
             // For pyramids the subelement type might change from 4 to 7:
-            if (currentdepth > 0 && parenttypes[currentdepth-1] == 7 && indexesinclusters[currentdepth] == 4)
-                parenttypes[currentdepth] = 7;
+            if (c.currentdepth > 0 && c.parenttypes[c.currentdepth-1] == 7 && c.indexesinclusters[c.currentdepth] == 4)
+                c.parenttypes[c.currentdepth] = 7;
         }
-        if (currentdepth == 0) // not else here because currentdepth might change above
+        if (c.currentdepth == 0) // not else here because currentdepth might change above
         {
-            indexesinclusters[0] = 0;
-            
-            origindexintype++;
-            // Skip empty types:
-            while (origindexintype == originalcount[parenttypes[0]])
+            c.indexesinclusters[0] = 0;
+
+            c.origindexintype++;
+            // Skip empty types (stop at the last type when moving past the last leaf):
+            while (c.origindexintype == originalcount[c.parenttypes[0]] && c.parenttypes[0] < 7)
             {
-                parenttypes[0]++;
-                origindexintype = 0;
+                c.parenttypes[0]++;
+                c.origindexintype = 0;
             }
-            if (isrefcalc)
-                parentrefcoords[0] = {straightrefcoords[parenttypes[0]]};
+            if (c.isrefcalc)
+                c.parentrefcoords[0] = {straightrefcoords[c.parenttypes[0]]};
         }
     }
     else
     {
-        cursorposition++;
-        
+        c.cursorposition++;
+
         // Get the through-edge number (if any):
-        int t = parenttypes[currentdepth];
-        int ic = indexesinclusters[currentdepth];
+        int t = c.parenttypes[c.currentdepth];
+        int ic = c.indexesinclusters[c.currentdepth];
         if (t == 4)
         {
             throughedgenum = 0;
-            if (splitdata[cursorposition])
+            if (splitdata[c.cursorposition])
                 throughedgenum += 2;
-            if (splitdata[cursorposition+1])
+            if (splitdata[c.cursorposition+1])
                 throughedgenum += 1;
-                
+
             // If it is 3 we have to define it:
-            if (isrefcalc && throughedgenum == 3)
+            if (c.isrefcalc && throughedgenum == 3)
             {
+                elements* myelements = getoriginalmesh()->getelements();
+
                 // Get the physical node coordinates of the original element:
-                std::vector<double> origelemcoords = myelements->getnodecoordinates(parenttypes[0], origindexintype);
+                std::vector<double> origelemcoords = myelements->getnodecoordinates(c.parenttypes[0], c.origindexintype);
                 // Get the curved reference coordinates in the original element:
                 std::vector<double> refsinorig;
-                if (currentdepth > 0)
-                    refsinorig = myelems[t].calculatecoordinates(curvedrefcoords[t], parentrefcoords[currentdepth][ic], 0, originalcurvatureorder == 1);
+                if (c.currentdepth > 0)
+                    refsinorig = c.myelems[t].calculatecoordinates(curvedrefcoords[t], c.parentrefcoords[c.currentdepth][ic], 0, originalcurvatureorder == 1);
                 // Calculate the physical coordinates of the current element:
-                std::vector<double> coordsinorigelem = mycurvedelems[parenttypes[0]].calculatecoordinates(refsinorig, origelemcoords, 0, currentdepth == 0);
+                std::vector<double> coordsinorigelem = c.mycurvedelems[c.parenttypes[0]].calculatecoordinates(refsinorig, origelemcoords, 0, c.currentdepth == 0);
                 // Calculate the best through-edge number:
-                throughedgenum = mycurvedelems[4].choosethroughedge(coordsinorigelem);
-                
+                throughedgenum = c.mycurvedelems[4].choosethroughedge(coordsinorigelem);
+
                 // Write it to the tree (status is 11 now):
-                if (throughedgenum%2 == 0)
-                    splitdata[cursorposition+1] = false;
-                if (((throughedgenum-throughedgenum%2)/2)%2 == 0)
-                    splitdata[cursorposition] = false;
+                bool firstbit = (((throughedgenum-throughedgenum%2)/2)%2 == 1);
+                bool secondbit = (throughedgenum%2 == 1);
+                if (c.isdeferred)
+                {
+                    c.deferredwrites.push_back(std::make_pair(c.cursorposition, firstbit));
+                    c.deferredwrites.push_back(std::make_pair(c.cursorposition+1, secondbit));
+                }
+                else
+                {
+                    splitdata[c.cursorposition] = firstbit;
+                    splitdata[c.cursorposition+1] = secondbit;
+                }
             }
-            cursorposition += 2;
+            c.cursorposition += 2;
         }
-        
+
         // Optionally compute the subelements reference coordinates in the original element:
-        if (isrefcalc)
+        if (c.isrefcalc)
         {
             std::vector<std::vector<double>> cornerrefcoords;
-            myelems[t].fullsplit(cornerrefcoords, throughedgenum);
-            
+            c.myelems[t].fullsplit(cornerrefcoords, throughedgenum);
+
             int ind = 0;
             for (int i = 0; i < 8; i++)
             {
@@ -205,146 +224,226 @@ int htracker::next(void)
                     std::vector<double> cc(3*nn[i]);
                     for (int k = 0; k < cc.size(); k++)
                         cc[k] = cornerrefcoords[i][j*3*nn[i]+k];
-                    
-                    parentrefcoords[currentdepth+1][ind] = myelems[t].calculatecoordinates(cc, parentrefcoords[currentdepth][ic]);
+
+                    c.parentrefcoords[c.currentdepth+1][ind] = c.myelems[t].calculatecoordinates(cc, c.parentrefcoords[c.currentdepth][ic]);
 
                     ind++;
                 }
             }
         }
-    
+
         // Split pyramids give 4 tets and 6 pyramids:
-        if (parenttypes[currentdepth] != 7)
-            parenttypes[currentdepth+1] = parenttypes[currentdepth];
+        if (c.parenttypes[c.currentdepth] != 7)
+            c.parenttypes[c.currentdepth+1] = c.parenttypes[c.currentdepth];
         else
-            parenttypes[currentdepth+1] = 4;
+            c.parenttypes[c.currentdepth+1] = 4;
 
-        indexesinclusters[currentdepth+1] = 0;
-        
-        currentdepth++;
+        c.indexesinclusters[c.currentdepth+1] = 0;
+
+        c.currentdepth++;
     }
-    
+
     return throughedgenum;
 }
 
+std::vector<int> htracker::getthreadranges(void)
+{
+    int numorig = treeoffsets.size()-1;
+
+    int numthreads = std::min(numleaves/10000+1, universe::getmaxnumthreads()); // require a min num leaves per thread
+
+    std::vector<int> ranges(numthreads+1, numorig);
+    ranges[0] = 0;
+    for (int t = 1; t < numthreads; t++)
+    {
+        int firstleaf = (long long int)numleaves*t/numthreads;
+        ranges[t] = std::lower_bound(leafoffsets.begin(), leafoffsets.end(), firstleaf) - leafoffsets.begin();
+    }
+
+    return ranges;
+}
+
+void htracker::runinparallel(std::vector<int>& ranges, std::function<void(int, int, int)> fct)
+{
+    threadpool::run(ranges.size()-1, [&](int t)
+    {
+        if (ranges[t] < ranges[t+1])
+            fct(t, ranges[t], ranges[t+1]);
+    });
+}
+
+std::vector<std::vector<int>> htracker::countleavesbefore(std::vector<int>& ranges)
+{
+    std::vector<int> numsons;
+    countsons(numsons);
+
+    int numthreads = ranges.size()-1;
+
+    std::vector<std::vector<int>> output(numthreads);
+
+    std::vector<int> cnt(8,0);
+    int origelem = 0;
+    for (int t = 0; t < numthreads; t++)
+    {
+        for (; origelem < ranges[t]; origelem++)
+        {
+            for (int i = 0; i < 8; i++)
+                cnt[i] += numsons[8*origelem+i];
+        }
+        output[t] = cnt;
+    }
+
+    return output;
+}
+
+void htracker::resetcursor(bool calcrefcoords)
+{
+    resetcursor(mycursor, calcrefcoords);
+}
+
+int htracker::next(void)
+{
+    return next(mycursor);
+}
+
 bool htracker::isatleaf(void)
 {
-    return (splitdata[cursorposition] == 0);
+    return isatleaf(mycursor);
 }
 
 int htracker::countsplits(void)
 {
-    return currentdepth;
+    return mycursor.currentdepth;
 }
 
 int htracker::gettype(void)
 {
-    return parenttypes[currentdepth];
+    return mycursor.parenttypes[mycursor.currentdepth];
 }
 
 int htracker::getparenttype(void)
 {
-    if (currentdepth > 0)
-        return parenttypes[currentdepth-1];
+    if (mycursor.currentdepth > 0)
+        return mycursor.parenttypes[mycursor.currentdepth-1];
     else
         return -1;
 }
 
 int htracker::getindexincluster(void)
 {
-    return indexesinclusters[currentdepth];
+    return mycursor.indexesinclusters[mycursor.currentdepth];
 }
 
 std::vector<double> htracker::getreferencecoordinates(void)
 {
-    return parentrefcoords[currentdepth][indexesinclusters[currentdepth]];
+    return mycursor.parentrefcoords[mycursor.currentdepth][mycursor.indexesinclusters[mycursor.currentdepth]];
 }
 
 
 void htracker::countsplits(std::vector<int>& numsplits)
 {
     numsplits = std::vector<int>(numleaves);
-    
-    resetcursor();
-    
-    for (int i = 0; i < numleaves; i++)
-    {    
-        // Move to next leaf:
-        while (not(isatleaf()))
-            next();
-            
-        numsplits[i] = currentdepth;
-        
-        next();
-    }
+
+    std::vector<int> ranges = getthreadranges();
+    runinparallel(ranges, [&](int t, int firstorig, int lastorig)
+    {
+        htcursor c;
+        resetcursor(c, false, firstorig);
+
+        for (int i = leafoffsets[firstorig]; i < leafoffsets[lastorig]; i++)
+        {
+            // Move to next leaf:
+            while (not(isatleaf(c)))
+                next(c);
+
+            numsplits[i] = c.currentdepth;
+
+            next(c);
+        }
+    });
 }
 
 void htracker::gettype(std::vector<int>& types)
 {
     types = std::vector<int>(numleaves);
-    
-    resetcursor();
-    
-    for (int i = 0; i < numleaves; i++)
-    {    
-        // Move to next leaf:
-        while (not(isatleaf()))
-            next();
-            
-        types[i] = parenttypes[currentdepth];
-        
-        next();
-    }
+
+    std::vector<int> ranges = getthreadranges();
+    runinparallel(ranges, [&](int t, int firstorig, int lastorig)
+    {
+        htcursor c;
+        resetcursor(c, false, firstorig);
+
+        for (int i = leafoffsets[firstorig]; i < leafoffsets[lastorig]; i++)
+        {
+            // Move to next leaf:
+            while (not(isatleaf(c)))
+                next(c);
+
+            types[i] = c.parenttypes[c.currentdepth];
+
+            next(c);
+        }
+    });
 }
 
 void htracker::getoriginalelementnumber(std::vector<int>& oen)
 {
     oen = std::vector<int>(numleaves);
-    
-    resetcursor();
-    
-    int ln = -1;
-    int index = -1;
-    while (true)
-    { 
-        if (currentdepth == 0)
-            index++;
-            
-        if (isatleaf())
+
+    std::vector<int> ranges = getthreadranges();
+    runinparallel(ranges, [&](int t, int firstorig, int lastorig)
+    {
+        htcursor c;
+        resetcursor(c, false, firstorig);
+
+        int ln = leafoffsets[firstorig]-1;
+        int index = firstorig-1;
+        while (true)
         {
-            ln++;
-            oen[ln] = index;
+            if (c.currentdepth == 0)
+                index++;
+
+            if (isatleaf(c))
+            {
+                ln++;
+                oen[ln] = index;
+            }
+
+            if (ln == leafoffsets[lastorig]-1)
+                break;
+
+            next(c);
         }
-        
-        if (ln == numleaves-1)
-            break;
-        
-        next();
-    }
+    });
 }
 
 void htracker::getoriginalelement(std::vector<int>& oet, std::vector<int>& oei)
 {
     oet = std::vector<int>(numleaves);
     oei = std::vector<int>(numleaves);
-    
-    resetcursor();
-    
-    int ln = -1;
-    while (true)
-    { 
-        if (isatleaf())
+
+    std::vector<int> ranges = getthreadranges();
+    runinparallel(ranges, [&](int t, int firstorig, int lastorig)
+    {
+        htcursor c;
+        resetcursor(c, false, firstorig);
+
+        int ln = leafoffsets[firstorig]-1;
+        while (true)
         {
-            ln++;
-            oet[ln] = parenttypes[0];
-            oei[ln] = origindexintype;
+            if (isatleaf(c))
+            {
+                ln++;
+                oet[ln] = c.parenttypes[0];
+                oei[ln] = c.origindexintype;
+            }
+
+            if (ln == leafoffsets[lastorig]-1)
+                break;
+
+            next(c);
         }
-        
-        if (ln == numleaves-1)
-            break;
-        
-        next();
-    }
+    });
 }
 
 void htracker::countsons(std::vector<int>& numsons)
@@ -352,48 +451,65 @@ void htracker::countsons(std::vector<int>& numsons)
     int num = 0;
     for (int i = 0; i < 8; i++)
         num += originalcount[i];
-        
+
     numsons = std::vector<int>(8*num,0);
-    
-    resetcursor();
-    
-    int ln = -1;
-    int index = -1;
-    while (true)
-    { 
-        if (currentdepth == 0)
-            index++;
-            
-        if (isatleaf())
+
+    std::vector<int> ranges = getthreadranges();
+    runinparallel(ranges, [&](int t, int firstorig, int lastorig)
+    {
+        htcursor c;
+        resetcursor(c, false, firstorig);
+
+        int ln = leafoffsets[firstorig]-1;
+        int index = firstorig-1;
+        while (true)
         {
-            ln++;
-            numsons[8*index+parenttypes[currentdepth]]++;
+            if (c.currentdepth == 0)
+                index++;
+
+            if (isatleaf(c))
+            {
+                ln++;
+                numsons[8*index+c.parenttypes[c.currentdepth]]++;
+            }
+
+            if (ln == leafoffsets[lastorig]-1)
+                break;
+
+            next(c);
         }
-        
-        if (ln == numleaves-1)
-            break;
-        
-        next();
-    }
+    });
 }
 
 std::vector<int> htracker::countintypes(void)
 {
+    std::vector<int> ranges = getthreadranges();
+    std::vector<std::vector<int>> threadcounts(ranges.size()-1, std::vector<int>(8,0));
+
+    runinparallel(ranges, [&](int t, int firstorig, int lastorig)
+    {
+        htcursor c;
+        resetcursor(c, false, firstorig);
+
+        for (int i = leafoffsets[firstorig]; i < leafoffsets[lastorig]; i++)
+        {
+            // Move to next leaf:
+            while (not(isatleaf(c)))
+                next(c);
+
+            threadcounts[t][c.parenttypes[c.currentdepth]]++;
+
+            next(c);
+        }
+    });
+
     std::vector<int> output(8,0);
-    
-    resetcursor();
-    
-    for (int i = 0; i < numleaves; i++)
-    {    
-        // Move to next leaf:
-        while (not(isatleaf()))
-            next();
-            
-        output[parenttypes[currentdepth]]++;
-        
-        next();
+    for (int t = 0; t < threadcounts.size(); t++)
+    {
+        for (int i = 0; i < 8; i++)
+            output[i] += threadcounts[t][i];
     }
-    
+
     return output;
 }
 
@@ -404,156 +520,218 @@ int htracker::counttransitions(int elementtypenumber)
 
 void htracker::fix(std::vector<int>& operations)
 {
-    // Number of grouping requests in a cluster:
-    std::vector<int> ngr(maxdepth+1);
-    
-    resetcursor();
-    
-    int ln = -1; // leaf number
-    
-    while (true)
+    // All clusters are inside the subtree of an original element:
+    std::vector<int> ranges = getthreadranges();
+    runinparallel(ranges, [&](int t, int firstorig, int lastorig)
     {
-        int ns = currentdepth;
-        int ic = indexesinclusters[currentdepth];
-        
-        // Reset cluster info:
-        if (ic == 0)
-            ngr[ns] = 0;
-        
-        if (isatleaf())
+        // Number of grouping requests in a cluster:
+        std::vector<int> ngr(maxdepth+1);
+
+        htcursor c;
+        resetcursor(c, false, firstorig);
+
+        int ln = leafoffsets[firstorig]-1; // leaf number
+
+        while (true)
         {
-            ln++;
-            
-            if (operations[ln] == -1)
-            {
-                operations[ln] = 0;
-                ngr[ns]++;
-            }
-            
-            // Group the cluster if all have requested it:
-            if (ns > 0 && ngr[ns] == numsubelems[parenttypes[ns-1]])
+            int ns = c.currentdepth;
+            int ic = c.indexesinclusters[c.currentdepth];
+
+            // Reset cluster info:
+            if (ic == 0)
+                ngr[ns] = 0;
+
+            if (isatleaf(c))
             {
-                // In this situation all leaves are consecutive:
-                for (int i = 0; i < numsubelems[parenttypes[ns-1]]; i++)
-                    operations[ln-i] = -1;
+                ln++;
+
+                if (operations[ln] == -1)
+                {
+                    operations[ln] = 0;
+                    ngr[ns]++;
+                }
+
+                // Group the cluster if all have requested it:
+                if (ns > 0 && ngr[ns] == numsubelems[c.parenttypes[ns-1]])
+                {
+                    // In this situation all leaves are consecutive:
+                    for (int i = 0; i < numsubelems[c.parenttypes[ns-1]]; i++)
+                        operations[ln-i] = -1;
+                }
             }
+
+            if (ln == leafoffsets[lastorig]-1)
+                break;
+
+            next(c);
         }
-        
-        if (ln == numleaves-1)
-            break;
-        
-        next();
-    }
+    });
 }
 
 void htracker::adapt(std::vector<int>& operations)
 {
-    // Calculate an upper bound for the size of the new 'splitdata' vector:
-    int upperbound = splitdata.size();
-    for (int i = 0; i < operations.size(); i++)
-    {
-        if (operations[i] == 1)
-            upperbound += 10; // 10 is the max size increase in a split
-    }
-    std::vector<bool> newsplitdata(upperbound, false);
+    int numorig = treeoffsets.size()-1;
 
-    // Number of grouping requests in a cluster:
-    std::vector<int> ngr(maxdepth+1);
-    
-    resetcursor();
-    
-    int newnumleaves = numleaves;
-    int newmaxdepth = 0;
-    
-    int ln = -1; // leaf number
-    int ni = 0; // newsplitdata index
+    // The subtree of each original element is adapted independently:
+    std::vector<int> ranges = getthreadranges();
+    int numthreads = ranges.size()-1;
 
-    while (true)
+    std::vector<std::vector<bool>> newsplitdatas(numthreads);
+    std::vector<int> newsizes(numthreads, 0), newnumsleaves(numthreads, 0), newmaxdepths(numthreads, 0);
+    // Relative to the beginning of the range for now:
+    std::vector<int> newtreeoffsets(numorig+1, 0), newleafoffsets(numorig+1, 0);
+
+    runinparallel(ranges, [&](int thr, int firstorig, int lastorig)
     {
-        int t = parenttypes[currentdepth];
-        int ns = currentdepth;
-        int ic = indexesinclusters[currentdepth];
-        
-        // Reset cluster info:
-        if (ic == 0)
-            ngr[ns] = 0;
+        // Calculate an upper bound for the size of the new 'splitdata' vector:
+        int upperbound = treeoffsets[lastorig]-treeoffsets[firstorig];
+        for (int i = leafoffsets[firstorig]; i < leafoffsets[lastorig]; i++)
+        {
+            if (operations[i] == 1)
+                upperbound += 10; // 10 is the max size increase in a split
+        }
+        std::vector<bool> newsplitdata(upperbound, false);
 
-        if (not(isatleaf()))
+        // Number of grouping requests in a cluster:
+        std::vector<int> ngr(maxdepth+1);
+
+        htcursor c;
+        resetcursor(c, false, firstorig);
+
+        int newnumleaves = 0;
+        int newmaxdepth = 0;
+
+        int ln = leafoffsets[firstorig]-1; // leaf number
+        int ni = 0; // newsplitdata index
+        int origelem = firstorig-1;
+
+        while (true)
         {
-            newsplitdata[ni] = true;
-            ni++;
-            
-            // Write the through-edge number (if any):
-            if (t == 4)
+            int t = c.parenttypes[c.currentdepth];
+            int ns = c.currentdepth;
+            int ic = c.indexesinclusters[c.currentdepth];
+
+            // New original element:
+            if (ns == 0)
             {
-                newsplitdata[ni] = splitdata[cursorposition+1];
-                newsplitdata[ni+1] = splitdata[cursorposition+2];
-                ni += 2;
+                origelem++;
+                newtreeoffsets[origelem] = ni;
+                newleafoffsets[origelem] = newnumleaves;
             }
-        }
-        else
-        {
-            ln++;
-            
-            // Split:
-            if (operations[ln] == 1)
+
+            // Reset cluster info:
+            if (ic == 0)
+                ngr[ns] = 0;
+
+            if (not(isatleaf(c)))
             {
-                newnumleaves += numsubelems[t]-1;
-                
                 newsplitdata[ni] = true;
                 ni++;
-                // Initialize through-edge number at 3 (undefined):
+
+                // Write the through-edge number (if any):
                 if (t == 4)
                 {
-                    newsplitdata[ni] = true;
-                    newsplitdata[ni+1] = true;
+                    newsplitdata[ni] = splitdata[c.cursorposition+1];
+                    newsplitdata[ni+1] = splitdata[c.cursorposition+2];
                     ni += 2;
                 }
-                for (int i = 0; i < numsubelems[t]; i++)
-                    newsplitdata[ni+i] = false;
-                ni += numsubelems[t];
-                
-                if (newmaxdepth < ns+1)
-                    newmaxdepth = ns+1;
             }
             else
             {
-                newsplitdata[ni] = false;
-                ni++;
-        
-                if (operations[ln] == -1)
-                    ngr[ns]++;
-                
-                // Group the cluster if all have requested it:
-                if (ns > 0 && ic == numsubelems[parenttypes[ns-1]]-1)
+                ln++;
+
+                // Split:
+                if (operations[ln] == 1)
                 {
-                    int md = ns;
-                    if (ngr[ns] == numsubelems[parenttypes[ns-1]])
+                    newnumleaves += numsubelems[t];
+
+                    newsplitdata[ni] = true;
+                    ni++;
+                    // Initialize through-edge number at 3 (undefined):
+                    if (t == 4)
                     {
-                        md--;
-                        int pt = parenttypes[ns-1];
-                        newnumleaves -= numsubelems[pt]-1;
-                        ni -= numsubelems[pt];
-                        if (pt == 4)
-                            ni -= 2;
-                        newsplitdata[ni-1] = false;
+                        newsplitdata[ni] = true;
+                        newsplitdata[ni+1] = true;
+                        ni += 2;
+                    }
+                    for (int i = 0; i < numsubelems[t]; i++)
+                        newsplitdata[ni+i] = false;
+                    ni += numsubelems[t];
+
+                    if (newmaxdepth < ns+1)
+                        newmaxdepth = ns+1;
+                }
+                else
+                {
+                    newnumleaves++;
+
+                    newsplitdata[ni] = false;
+                    ni++;
+
+                    if (operations[ln] == -1)
+                        ngr[ns]++;
+
+                    // Group the cluster if all have requested it:
+                    if (ns > 0 && ic == numsubelems[c.parenttypes[ns-1]]-1)
+                    {
+                        int md = ns;
+                        if (ngr[ns] == numsubelems[c.parenttypes[ns-1]])
+                        {
+                            md--;
+                            int pt = c.parenttypes[ns-1];
+                            newnumleaves -= numsubelems[pt]-1;
+                            ni -= numsubelems[pt];
+                            if (pt == 4)
+                                ni -= 2;
+                            newsplitdata[ni-1] = false;
+                        }
+                        if (newmaxdepth < md)
+                            newmaxdepth = md;
                     }
-                    if (newmaxdepth < md)
-                        newmaxdepth = md;
                 }
             }
+
+            if (ln == leafoffsets[lastorig]-1)
+                break;
+
+            next(c);
         }
-        
-        if (ln == numleaves-1)
-            break;
-            
-        next();
+
+        newsplitdata.resize(ni);
+        newsplitdatas[thr] = newsplitdata;
+        newsizes[thr] = ni;
+        newnumsleaves[thr] = newnumleaves;
+        newmaxdepths[thr] = newmaxdepth;
+    });
+
+    // Concatenate the subtrees:
+    int totalsize = 0, totalnumleaves = 0;
+    for (int t = 0; t < numthreads; t++)
+    {
+        for (int o = ranges[t]; o < ranges[t+1]; o++)
+        {
+            newtreeoffsets[o] += totalsize;
+            newleafoffsets[o] += totalnumleaves;
+        }
+        totalsize += newsizes[t];
+        totalnumleaves += newnumsleaves[t];
     }
+    newtreeoffsets[numorig] = totalsize;
+    newleafoffsets[numorig] = totalnumleaves;
 
-    newsplitdata.resize(ni);
-    splitdata = newsplitdata;
-    numleaves = newnumleaves;
-    maxdepth = newmaxdepth;
+    splitdata = std::vector<bool>(totalsize);
+    int index = 0;
+    for (int t = 0; t < numthreads; t++)
+    {
+        for (int i = 0; i < newsizes[t]; i++)
+            splitdata[index+i] = newsplitdatas[t][i];
+        index += newsizes[t];
+    }
+
+    treeoffsets = newtreeoffsets;
+    leafoffsets = newleafoffsets;
+    numleaves = totalnumleaves;
+    maxdepth = *std::max_element(newmaxdepths.begin(), newmaxdepths.end());
 }
 
 void htracker::atleaves(std::vector<std::vector<double>>& arc, std::vector<std::vector<double>>& apc, bool withphysicals)
@@ -569,173 +747,212 @@ void htracker::atleaves(std::vector<std::vector<double>>& arc, std::vector<std::
     if (withphysicals)
         apc = arc;
 
-    resetcursor(true);
-    
-    std::vector<double> oc;
-    
-    int ln = -1; // leaf number
-    std::vector<int> iarc(8,0); // indexes in arc
-    while (true)
+    std::vector<int> ranges = getthreadranges();
+    std::vector<std::vector<int>> leavesbefore = countleavesbefore(ranges);
+
+    std::vector<std::vector<std::pair<int, bool>>> deferredwrites(ranges.size()-1);
+
+    runinparallel(ranges, [&](int thr, int firstorig, int lastorig)
     {
-        int t = parenttypes[currentdepth];
-        int ns = currentdepth;
-    
-        if (withphysicals && ns == 0)
-            oc = myelements->getnodecoordinates(t, origindexintype);
-    
-        if (isatleaf())
+        htcursor c;
+        c.isdeferred = true;
+        resetcursor(c, true, firstorig);
+
+        std::vector<double> oc;
+
+        int ln = leafoffsets[firstorig]-1; // leaf number
+        std::vector<int> iarc(8); // indexes in arc
+        for (int i = 0; i < 8; i++)
+            iarc[i] = 3*nn[i]*leavesbefore[thr][i];
+        while (true)
         {
-            ln++;
-            
-            std::vector<double> refcoords = getreferencecoordinates();
-            std::vector<double> physcoords;
-            if (withphysicals)
-                physcoords = myelems[parenttypes[0]].calculatecoordinates(refcoords, oc, 0, ns == 0);
-            
-            for (int i = 0; i < refcoords.size(); i++)
+            int t = c.parenttypes[c.currentdepth];
+            int ns = c.currentdepth;
+
+            if (withphysicals && ns == 0)
+                oc = myelements->getnodecoordinates(t, c.origindexintype);
+
+            if (isatleaf(c))
             {
-                arc[t][iarc[t]+i] = refcoords[i];
+                ln++;
+
+                std::vector<double> refcoords = c.parentrefcoords[ns][c.indexesinclusters[ns]];
+                std::vector<double> physcoords;
                 if (withphysicals)
-                    apc[t][iarc[t]+i] = physcoords[i];
+                    physcoords = c.myelems[c.parenttypes[0]].calculatecoordinates(refcoords, oc, 0, ns == 0);
+
+                for (int i = 0; i < refcoords.size(); i++)
+                {
+                    arc[t][iarc[t]+i] = refcoords[i];
+                    if (withphysicals)
+                        apc[t][iarc[t]+i] = physcoords[i];
+                }
+
+                iarc[t] += refcoords.size();
             }
-            
-            iarc[t] += refcoords.size();
+
+            if (ln == leafoffsets[lastorig]-1)
+                break;
+
+            next(c);
         }
-        
-        if (ln == numleaves-1)
-            break;
-            
-        next();
+
+        deferredwrites[thr] = c.deferredwrites;
+    });
+
+    // Store the through-edge numbers defined during the traversal:
+    for (int t = 0; t < deferredwrites.size(); t++)
+    {
+        for (int i = 0; i < deferredwrites[t].size(); i++)
+            splitdata[deferredwrites[t][i].first] = deferredwrites[t][i].second;
     }
 }
 
 void htracker::getadaptedcoordinates(std::vector<std::vector<double>>& ac)
 {
     elements* myelements = getoriginalmesh()->getelements();
-    
+
     std::vector<int> ne(8);
     for (int i = 0; i < 8; i++)
         ne[i] = myelems[i].countedges();
 
     // Get the reference ('arc') and physical ('apc') element corner coordinates after all fullsplit adaptations:
     std::vector<std::vector<double>> cornerarc, cornerapc;
-    atleaves(cornerarc, cornerapc, true);    
-    
+    atleaves(cornerarc, cornerapc, true);
+
     // Assign unique edge numbers and deduce edge splits:
     std::vector<int> edgenumbers;
     std::vector<bool> isedgesplit;
     myalgorithm::assignedgenumbers(cornerapc, edgenumbers, isedgesplit);
-    
 
-    // Preallocate output containers to upper bound size:
-    ac = std::vector<std::vector<double>>(8, std::vector<double>(0));
-    transitionsrefcoords = std::vector<std::vector<double>>(8, std::vector<double>(0));
-    leavesoftransitions = std::vector<std::vector<int>>(8, std::vector<int>(0));
-    originalsoftransitions = std::vector<std::vector<int>>(8, std::vector<int>(0));
 
-    std::vector<int> ub = countupperbound();
-    for (int i = 0; i < 8; i++)
-    {
-        ac[i] = std::vector<double>(3*ncn[i]*ub[i]);
-        leavesoftransitions[i] = std::vector<int>(ub[i]);
-        originalsoftransitions[i] = std::vector<int>(2*ub[i]);
-        transitionsrefcoords[i] = std::vector<double>(3*nn[i]*ub[i]);
-    }
-    
-    resetcursor();
-    
-    std::vector<double> oc;
-    
-    int ln = -1; // leaf number
-    std::vector<int> iarc(8,0); // indexes in arc
-    std::vector<int> firstedge(8,0); // first edge in working element
+    std::vector<int> ranges = getthreadranges();
+    int numthreads = ranges.size()-1;
+    std::vector<std::vector<int>> leavesbefore = countleavesbefore(ranges);
+
+    std::vector<int> firstedgeintype(8,0); // first edge of each type
     for (int i = 0; i < 7; i++)
-        firstedge[i+1] = firstedge[i] + ne[i] * cornerarc[i].size()/nn[i]/3;
-    std::vector<int> ite(8,0); // index of trans. elem.
-    while (true)
+        firstedgeintype[i+1] = firstedgeintype[i] + ne[i] * cornerarc[i].size()/nn[i]/3;
+
+    // Transition elements created by each thread (ordered as in the tree):
+    std::vector<std::vector<std::vector<double>>> threadac(numthreads, std::vector<std::vector<double>>(8, std::vector<double>(0)));
+    std::vector<std::vector<std::vector<double>>> threadtrc(numthreads, std::vector<std::vector<double>>(8, std::vector<double>(0)));
+    std::vector<std::vector<std::vector<int>>> threadlot(numthreads, std::vector<std::vector<int>>(8, std::vector<int>(0)));
+    std::vector<std::vector<std::vector<int>>> threadoot(numthreads, std::vector<std::vector<int>>(8, std::vector<int>(0)));
+
+    runinparallel(ranges, [&](int thr, int firstorig, int lastorig)
     {
-        int t = parenttypes[currentdepth];
+        htcursor c;
+        resetcursor(c, false, firstorig);
 
-        if (currentdepth == 0)
-            oc = myelements->getnodecoordinates(t, origindexintype);
-    
-        while (not(isatleaf()))
-            next();
-    
-        ln++;
-        
-        // Get the edge numbers and edge splits for the current subelement:
-        std::vector<int> curedgenums(ne[t]);
-        std::vector<bool> curisedgesplit(ne[t]);
-        for (int i = 0; i < ne[t]; i++)
+        // Own element objects (their polynomials are computed on first use):
+        std::vector<element> straightelems = myelems;
+        std::vector<element> curvedelems = mycurvedelems;
+
+        std::vector<std::vector<double>>& curac = threadac[thr];
+        std::vector<std::vector<double>>& curtrc = threadtrc[thr];
+        std::vector<std::vector<int>>& curlot = threadlot[thr];
+        std::vector<std::vector<int>>& curoot = threadoot[thr];
+
+        std::vector<double> oc;
+
+        int ln = leafoffsets[firstorig]-1; // leaf number
+        std::vector<int> iarc(8); // indexes in arc
+        std::vector<int> firstedge(8); // first edge in working element
+        for (int i = 0; i < 8; i++)
         {
-            curedgenums[i] = edgenumbers[firstedge[t]+i];
-            curisedgesplit[i] = isedgesplit[firstedge[t]+i];
+            iarc[i] = 3*nn[i]*leavesbefore[thr][i];
+            firstedge[i] = firstedgeintype[i] + ne[i]*leavesbefore[thr][i];
         }
-        
-        int splitnum = myalgorithm::binarytoint(curisedgesplit);
-        std::vector<std::vector<int>> splitrefnums = myelems[t].split(splitnum, curedgenums);
-      
-        // Loop on all transition elements:
-        for (int si = 0; si < 8; si++)
+        while (true)
         {
-            if (splitrefnums[si].size() == 0)
-                continue;
-        
-            std::vector<double> splitrefcoords;
-            myelems[t].numstorefcoords(splitrefnums[si], splitrefcoords);
-        
-            for (int se = 0; se < splitrefcoords.size()/nn[si]/3; se++)
+            int t = c.parenttypes[c.currentdepth];
+
+            if (c.currentdepth == 0)
+                oc = myelements->getnodecoordinates(t, c.origindexintype);
+
+            while (not(isatleaf(c)))
+                next(c);
+
+            ln++;
+
+            // Get the edge numbers and edge splits for the current subelement:
+            std::vector<int> curedgenums(ne[t]);
+            std::vector<bool> curisedgesplit(ne[t]);
+            for (int i = 0; i < ne[t]; i++)
             {
-                // Get the ref. coords. of the current transition element:
-                std::vector<double> curcoords(3*nn[si]);
-                for (int i = 0; i < 3*nn[si]; i++)
-                    curcoords[i] = splitrefcoords[se*nn[si]*3+i];
-        
-                // Bring inside the untransitioned element (if split at all):
-                curcoords = myelems[t].calculatecoordinates(curcoords, cornerarc[t], iarc[t], splitnum == 0);
-                
-                for (int i = 0; i < curcoords.size(); i++)
-                    transitionsrefcoords[si][3*nn[si]*ite[si]+i] = curcoords[i];
-                
-                // Make curved:
-                if (originalcurvatureorder > 1)
-                    curcoords = myelems[si].calculatecoordinates(curvedrefcoords[si], curcoords);
-                    
-                // Calculate actual coordinates: 
-                curcoords = mycurvedelems[parenttypes[0]].calculatecoordinates(curcoords, oc, 0);
+                curedgenums[i] = edgenumbers[firstedge[t]+i];
+                curisedgesplit[i] = isedgesplit[firstedge[t]+i];
+            }
 
-                for (int i = 0; i < curcoords.size(); i++)
-                    ac[si][3*ncn[si]*ite[si]+i] = curcoords[i];
-                    
-                leavesoftransitions[si][ite[si]] = ln;
-                originalsoftransitions[si][2*ite[si]+0] = parenttypes[0];
-                originalsoftransitions[si][2*ite[si]+1] = origindexintype;
-                
-                ite[si]++;
-                
+            int splitnum = myalgorithm::binarytoint(curisedgesplit);
+            std::vector<std::vector<int>> splitrefnums = straightelems[t].split(splitnum, curedgenums);
+
+            // Loop on all transition elements:
+            for (int si = 0; si < 8; si++)
+            {
+                if (splitrefnums[si].size() == 0)
+                    continue;
+
+                std::vector<double> splitrefcoords;
+                straightelems[t].numstorefcoords(splitrefnums[si], splitrefcoords);
+
+                for (int se = 0; se < splitrefcoords.size()/nn[si]/3; se++)
+                {
+                    // Get the ref. coords. of the current transition element:
+                    std::vector<double> curcoords(3*nn[si]);
+                    for (int i = 0; i < 3*nn[si]; i++)
+                        curcoords[i] = splitrefcoords[se*nn[si]*3+i];
+
+                    // Bring inside the untransitioned element (if split at all):
+                    curcoords = straightelems[t].calculatecoordinates(curcoords, cornerarc[t], iarc[t], splitnum == 0);
+
+                    curtrc[si].insert(curtrc[si].end(), curcoords.begin(), curcoords.end());
+
+                    // Make curved:
+                    if (originalcurvatureorder > 1)
+                        curcoords = straightelems[si].calculatecoordinates(curvedrefcoords[si], curcoords);
+
+                    // Calculate actual coordinates:
+                    curcoords = curvedelems[c.parenttypes[0]].calculatecoordinates(curcoords, oc, 0);
+
+                    curac[si].insert(curac[si].end(), curcoords.begin(), curcoords.end());
+
+                    curlot[si].push_back(ln);
+                    curoot[si].push_back(c.parenttypes[0]);
+                    curoot[si].push_back(c.origindexintype);
+                }
             }
+
+            firstedge[t] += ne[t];
+            iarc[t] += 3*nn[t];
+
+            if (ln == leafoffsets[lastorig]-1)
+                break;
+
+            next(c);
         }
-        
-        firstedge[t] += ne[t];
-        iarc[t] += 3*nn[t];
-    
-        if (ln == numleaves-1)
-            break;
-        
-        next();
-    }
-    
-    // Fit to size:
+    });
+
+    // Concatenate in the tree order:
+    ac = std::vector<std::vector<double>>(8, std::vector<double>(0));
+    transitionsrefcoords = std::vector<std::vector<double>>(8, std::vector<double>(0));
+    leavesoftransitions = std::vector<std::vector<int>>(8, std::vector<int>(0));
+    originalsoftransitions = std::vector<std::vector<int>>(8, std::vector<int>(0));
+
     for (int i = 0; i < 8; i++)
     {
-        ac[i].resize(3*ncn[i]*ite[i]);
-        transitionsrefcoords[i].resize(3*nn[i]*ite[i]);
-        leavesoftransitions[i].resize(ite[i]);
-        originalsoftransitions[i].resize(2*ite[i]);
-        
-        touser[i] = myalgorithm::getequallyspaced(0, 1, ite[i]);
-        toht[i] = myalgorithm::getequallyspaced(0, 1, ite[i]);
+        for (int t = 0; t < numthreads; t++)
+        {
+            ac[i].insert(ac[i].end(), threadac[t][i].begin(), threadac[t][i].end());
+            transitionsrefcoords[i].insert(transitionsrefcoords[i].end(), threadtrc[t][i].begin(), threadtrc[t][i].end());
+            leavesoftransitions[i].insert(leavesoftransitions[i].end(), threadlot[t][i].begin(), threadlot[t][i].end());
+            originalsoftransitions[i].insert(originalsoftransitions[i].end(), threadoot[t][i].begin(), threadoot[t][i].end());
+        }
+
+        int numtransitions = leavesoftransitions[i].size();
+        touser[i] = myalgorithm::getequallyspaced(0, 1, numtransitions);
+        toht[i] = myalgorithm::getequallyspaced(0, 1, numtransitions);
     }
 }
 
@@ -862,8 +1079,8 @@ void htracker::fromoriginal(std::vector<int>& oad, std::vector<double>& orc, std
     
     while (true)
     {
-        int t = parenttypes[currentdepth];
-        int ns = currentdepth;
+        int t = mycursor.parenttypes[mycursor.currentdepth];
+        int ns = mycursor.currentdepth;
     
         // Update 'actives':
         if (ns == 0)
@@ -1104,58 +1321,64 @@ void htracker::getattarget(std::vector<int>& olv, htracker* target, std::vector<
 {
     tlv = std::vector<int>(target->numleaves, -1);
 
-    resetcursor();
-    target->resetcursor();
-    
-    int oln = 0;
-    int tln = 0;
-    
-    while (true)
+    // Both trees have the same original elements:
+    std::vector<int> ranges = getthreadranges();
+    runinparallel(ranges, [&](int thr, int firstorig, int lastorig)
     {
-        // Move to next leaf:
-        while (not(isatleaf()))
-            next();
-        while (not(target->isatleaf()))
-            target->next();
-            
-        int ocd = currentdepth;
-        int tcd = target->currentdepth;
-        
-        int oic = indexesinclusters[ocd];
-        int tic = target->indexesinclusters[tcd];
-        
-        int ons = -1;
-        int tns = -1;
-        if (ocd > 0)
-            ons = numsubelems[parenttypes[ocd-1]];
-        if (tcd > 0)
-            tns = numsubelems[target->parenttypes[tcd-1]];
+        htcursor oc, tc;
+        resetcursor(oc, false, firstorig);
+        target->resetcursor(tc, false, firstorig);
         
-        // If both leaves match:
-        if (ocd == tcd)
-            tlv[tln] = olv[oln];
-        // If original tree is one deeper here:
-        if (ocd > tcd)
-            tlv[tln] = std::max(olv[oln], tlv[tln]);
-        // If target tree is one deeper here:
-        if (ocd < tcd)
-            tlv[tln] = olv[oln];
+        int oln = leafoffsets[firstorig];
+        int tln = target->leafoffsets[firstorig];
         
-        if (ocd >= tcd || tic == tns-1)
+        while (true)
         {
-            // Will be reached for original and target at the same time:
-            if (oln == numleaves-1)
-                break;
-        
-            next();
-            oln++;
-        }
-        if (ocd <= tcd || oic == ons-1)
-        {
-            target->next();
-            tln++;
+            // Move to next leaf:
+            while (not(isatleaf(oc)))
+                next(oc);
+            while (not(target->isatleaf(tc)))
+                target->next(tc);
+                
+            int ocd = oc.currentdepth;
+            int tcd = tc.currentdepth;
+            
+            int oic = oc.indexesinclusters[ocd];
+            int tic = tc.indexesinclusters[tcd];
+            
+            int ons = -1;
+            int tns = -1;
+            if (ocd > 0)
+                ons = numsubelems[oc.parenttypes[ocd-1]];
+            if (tcd > 0)
+                tns = numsubelems[tc.parenttypes[tcd-1]];
+            
+            // If both leaves match:
+            if (ocd == tcd)
+                tlv[tln] = olv[oln];
+            // If original tree is one deeper here:
+            if (ocd > tcd)
+                tlv[tln] = std::max(olv[oln], tlv[tln]);
+            // If target tree is one deeper here:
+            if (ocd < tcd)
+                tlv[tln] = olv[oln];
+            
+            if (ocd >= tcd || tic == tns-1)
+            {
+                // Will be reached for original and target at the same time:
+                if (oln == leafoffsets[lastorig]-1)
+                    break;
+            
+                next(oc);
+                oln++;
+            }
+            if (ocd <= tcd || oic == ons-1)
+            {
+                target->next(tc);
+                tln++;
+            }
         }
-    }
+    });
 }
 
 int htracker::getleafnumber(int transitiontype, int transitionnumber)
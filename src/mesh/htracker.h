@@ -13,11 +13,35 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <functional>
+#include <algorithm>
 #include "element.h"
 #include "rawmesh.h"
+#include "threadpool.h"
 
 class rawmesh;
 
+// Position of a cursor in the tree. Several cursors can traverse the (independent) subtrees of different original elements in parallel.
+struct htcursor
+{
+    bool isrefcalc = false;
+    int cursorposition = -1;
+    int currentdepth = -1;
+    int origindexintype = -1;
+    std::vector<int> parenttypes = {};
+    std::vector<int> indexesinclusters = {};
+    std::vector<std::vector<std::vector<double>>> parentrefcoords = {};
+    
+    // Own copy of the straight/curved element objects for the reference coordinate calculations:
+    std::vector<element> myelems = {};
+    std::vector<element> mycurvedelems = {};
+    
+    // If true the through-edge numbers defined during the traversal are stored here as {position, value} 
+    // pairs instead of being written to the tree (concurrent writes to a vector<bool> are not allowed):
+    bool isdeferred = false;
+    std::vector<std::pair<int, bool>> deferredwrites = {};
+};
+
 class htracker
 {
 
@@ -60,15 +84,25 @@ class htracker
         std::vector<element> myelems;
         std::vector<element> mycurvedelems;
         
-        // Information needed by the tree cursor:
-        bool isrefcalc = false;
-        int cursorposition = -1;
-        int currentdepth = -1;
-        int origindexintype = -1;
-        std::vector<int> parenttypes = {};
-        std::vector<int> indexesinclusters = {};
-        std::vector<std::vector<std::vector<double>>> parentrefcoords = {};
-        // End tree cursor information
+        // Tree cursor used by the public cursor functions:
+        htcursor mycursor;
+        
+        // Position in 'splitdata' and first leaf number of the subtree of every original element (original elements 
+        // are ordered by type). The last entry is respectively the size of 'splitdata' and the number of leaves.
+        std::vector<int> treeoffsets = {};
+        std::vector<int> leafoffsets = {};
+        
+        // Place cursor 'c' at the root of the original element 'origelem' (counted over all types):
+        void resetcursor(htcursor& c, bool calcrefcoords, int origelem = 0);
+        int next(htcursor& c);
+        bool isatleaf(htcursor& c) { return (splitdata[c.cursorposition] == false); };
+        
+        // Split the original elements in ranges [ranges[t], ranges[t+1]) with a similar number of leaves (one per thread):
+        std::vector<int> getthreadranges(void);
+        // Call 'fct(t, ranges[t], ranges[t+1])' in parallel for every non-empty range:
+        void runinparallel(std::vector<int>& ranges, std::function<void(int, int, int)> fct);
+        // Number of leaves of each type before the first original element of every range:
+        std::vector<std::vector<int>> countleavesbefore(std::vector<int>& ranges);
         
         // Reference coordinates in the original element/leaf number for each transition element.
         // Transition elements of each type are ordered in the way the appear in the tree.
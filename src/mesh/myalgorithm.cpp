@@ -157,6 +157,29 @@ void myalgorithm::stablesort(std::vector<int>& tosort, std::vector<int>& reorder
         });
 }
 
+void myalgorithm::stablesort(std::vector<int>& tosort, std::vector<unsigned long long int>& keys, std::vector<int>& reorderingvector)
+{
+    if (reorderingvector.size() != tosort.size())
+        reorderingvector.resize(tosort.size());
+    
+    // Set 'reorderingvector' to [0 1 2 ...]:
+    std::iota(reorderingvector.begin(), reorderingvector.end(), 0);
+    // Sort 'reorderingvector' according to 'tosort' then 'keys':
+    #if defined(__linux__)
+    __gnu_parallel::sort(reorderingvector.begin(), reorderingvector.end(), [&](int elem1, int elem2)
+    #else
+    std::sort(reorderingvector.begin(), reorderingvector.end(), [&](int elem1, int elem2)
+    #endif
+        { 
+            if (tosort[elem1] != tosort[elem2])
+                return (tosort[elem1] < tosort[elem2]);
+            if (keys[elem1] != keys[elem2])
+                return (keys[elem1] < keys[elem2]);
+            // For identical entries make a COHERENT decision for a stable sorting.
+            return elem1 < elem2;
+        });
+}
+
 void myalgorithm::stablesort(double noisethreshold, std::vector<double>& tosort, std::vector<int>& reorderingvector)
 {
     if (reorderingvector.size() != tosort.size())
@@ -278,6 +301,82 @@ void myalgorithm::slicecoordinates(std::vector<double>& toslice, double minx, do
     }
 }
 
+std::vector<unsigned long long int> myalgorithm::getspacefillingcurvekeys(std::vector<double>& coordinates, std::vector<double> bounds, std::string curvetype)
+{
+    if (curvetype != "hilbert" && curvetype != "morton")
+    {
+        std::cout << "Error in 'myalgorithm' namespace: unknown space-filling curve '" << curvetype << "' (use 'hilbert' or 'morton')" << std::endl;
+        abort();
+    }
+
+    int numcoords = coordinates.size()/3;
+    
+    // Number of bits per direction:
+    int numbits = 21;
+    unsigned int maxint = (1u << numbits) - 1;
+    
+    std::vector<unsigned long long int> output(numcoords);
+    
+    for (int i = 0; i < numcoords; i++)
+    {
+        // Integer coordinates in the box:
+        unsigned int X[3];
+        for (int j = 0; j < 3; j++)
+        {
+            double delta = bounds[2*j+1]-bounds[2*j+0];
+            double scaled = 0.0;
+            if (delta > 0)
+                scaled = (coordinates[3*i+j]-bounds[2*j+0])/delta;
+            scaled = std::min(std::max(scaled, 0.0), 1.0);
+            X[j] = (unsigned int)(scaled*maxint);
+        }
+        
+        // Transform to the transposed Hilbert index (J. Skilling, "Programming the Hilbert curve", 2004):
+        if (curvetype == "hilbert")
+        {
+            unsigned int M = 1u << (numbits-1);
+            
+            for (unsigned int Q = M; Q > 1; Q >>= 1)
+            {
+                unsigned int P = Q - 1;
+                for (int j = 0; j < 3; j++)
+                {
+                    if (X[j] & Q)
+                        X[0] ^= P;
+                    else
+                    {
+                        unsigned int t = (X[0] ^ X[j]) & P;
+                        X[0] ^= t;
+                        X[j] ^= t;
+                    }
+                }
+            }
+            // Gray encode:
+            for (int j = 1; j < 3; j++)
+                X[j] ^= X[j-1];
+            unsigned int t = 0;
+            for (unsigned int Q = M; Q > 1; Q >>= 1)
+            {
+                if (X[2] & Q)
+                    t ^= Q - 1;
+            }
+            for (int j = 0; j < 3; j++)
+                X[j] ^= t;
+        }
+        
+        // Interleave the bits (this alone gives the Morton key):
+        unsigned long long int key = 0;
+        for (int b = numbits-1; b >= 0; b--)
+        {
+            for (int j = 0; j < 3; j++)
+                key = (key << 1) | ((X[j] >> b) & 1);
+        }
+        output[i] = key;
+    }
+    
+    return output;
+}
+
 std::vector<double> myalgorithm::getcoordbounds(std::vector<double>& coords)
 {
     int numcoords = coords.size()/3;
@@ -1145,6 +1244,132 @@ void myalgorithm::solveuppertriangular(int len, double* U, double* b, double* x)
     }
 }
 
+void myalgorithm::solvedense(int len, double* A, double* b, double* x)
+{
+    std::vector<double> LU(A, A+len*len);
+    for (int i = 0; i < len; i++)
+        x[i] = b[i];
+    
+    // Forward elimination:
+    for (int c = 0; c < len; c++)
+    {
+        // Partial pivoting:
+        int pivrow = c;
+        for (int r = c+1; r < len; r++)
+        {
+            if (std::abs(LU[r*len+c]) > std::abs(LU[pivrow*len+c]))
+                pivrow = r;
+        }
+        if (LU[pivrow*len+c] == 0)
+        {
+            std::cout << "Error in 'myalgorithm' namespace: in function solvedense the matrix is singular" << std::endl;
+            abort();
+        }
+        if (pivrow != c)
+        {
+            for (int j = c; j < len; j++)
+                std::swap(LU[c*len+j], LU[pivrow*len+j]);
+            std::swap(x[c], x[pivrow]);
+        }
+        
+        double invpiv = 1.0/LU[c*len+c];
+        for (int r = c+1; r < len; r++)
+        {
+            double factor = LU[r*len+c] * invpiv;
+            if (factor == 0)
+                continue;
+            for (int j = c+1; j < len; j++)
+                LU[r*len+j] -= factor * LU[c*len+j];
+            x[r] -= factor * x[c];
+        }
+    }
+    
+    // Backward substitution:
+    for (int r = len-1; r >= 0; r--)
+    {
+        for (int j = r+1; j < len; j++)
+            x[r] -= LU[r*len+j] * x[j];
+        x[r] /= LU[r*len+r];
+    }
+}
+
+void myalgorithm::eigensymmetric(int n, double* A, std::vector<double>& eigenvalues, std::vector<double>& eigenvectors)
+{
+    std::vector<double> a(A, A+n*n);
+    // Accumulated rotations (eigenvectors on the columns):
+    std::vector<double> v(n*n, 0.0);
+    for (int i = 0; i < n; i++)
+        v[i*n+i] = 1.0;
+    
+    double frobnorm = 0.0;
+    for (int i = 0; i < n*n; i++)
+        frobnorm += a[i]*a[i];
+    
+    for (int sweep = 0; sweep < 100; sweep++)
+    {
+        double offnorm = 0.0;
+        for (int p = 0; p < n; p++)
+        {
+            for (int q = p+1; q < n; q++)
+                offnorm += a[p*n+q]*a[p*n+q];
+        }
+        if (offnorm <= 1e-30*frobnorm)
+            break;
+    
+        for (int p = 0; p < n; p++)
+        {
+            for (int q = p+1; q < n; q++)
+            {
+                double apq = a[p*n+q];
+                if (apq == 0)
+                    continue;
+                
+                // Rotation that zeroes a(p,q):
+                double theta = (a[q*n+q]-a[p*n+p])/(2.0*apq);
+                double t = 1.0/(std::abs(theta)+std::sqrt(theta*theta+1.0));
+                if (theta < 0)
+                    t = -t;
+                double c = 1.0/std::sqrt(t*t+1.0);
+                double s = t*c;
+                
+                for (int k = 0; k < n; k++)
+                {
+                    double akp = a[k*n+p], akq = a[k*n+q];
+                    a[k*n+p] = c*akp - s*akq;
+                    a[k*n+q] = s*akp + c*akq;
+                }
+                for (int k = 0; k < n; k++)
+                {
+                    double apk = a[p*n+k], aqk = a[q*n+k];
+                    a[p*n+k] = c*apk - s*aqk;
+                    a[q*n+k] = s*apk + c*aqk;
+                }
+                for (int k = 0; k < n; k++)
+                {
+                    double vkp = v[k*n+p], vkq = v[k*n+q];
+                    v[k*n+p] = c*vkp - s*vkq;
+                    v[k*n+q] = s*vkp + c*vkq;
+                }
+            }
+        }
+    }
+    
+    // Sort descendingly:
+    std::vector<int> reorderingvector(n);
+    std::iota(reorderingvector.begin(), reorderingvector.end(), 0);
+    std::sort(reorderingvector.begin(), reorderingvector.end(), [&](int elem1, int elem2) { return a[elem1*n+elem1] > a[elem2*n+elem2]; });
+    
+    eigenvalues = std::vector<double>(n);
+    eigenvectors = std::vector<double>(n*n);
+    for (int i = 0; i < n; i++)
+    {
+        int ri = reorderingvector[i];
+        eigenvalues[i] = a[ri*n+ri];
+        for (int k = 0; k < n; k++)
+            eigenvectors[i*n+k] = v[k*n+ri];
+    }
+}
+
 void myalgorithm::givensrotation(double a, double b, double& c, double& s, double& r)
 {
     // As in www.netlib.org/eispack/comqr.f
@@ -1171,15 +1396,67 @@ void myalgorithm::applygivensrotation(double* h, std::vector<double>& cs, std::v
     h[k+1] = 0.0;
 }
 
+std::vector<double> myalgorithm::orthogonalize(densematrix Q, int k, densematrix q)
+{
+    int n = Q.countcolumns();
+    double* Qptr = Q.getvalues();
+    double* qptr = q.getvalues();
+    
+    std::vector<double> hvec(k+2, 0.0);
+    
+    // Classical Gram-Schmidt orthogonalization with a single reduction for the projections and the norm.
+    // The norm is obtained from ||q-Qh||^2 = ||q||^2 - ||h||^2. In case of a strong cancellation a second 
+    // orthogonalization pass is performed, which also restores the orthogonality lost by classical Gram-Schmidt:
+    double normq = 0.0;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        densematrix h = Q.getresized(k+1,n).multiply(q);
+        std::vector<double> dots;
+        h.getvalues(dots);
+        double normqfrag = 0.0;
+        for (int i = 0; i < n; i++)
+            normqfrag += qptr[i]*qptr[i];
+        dots.push_back(normqfrag);
+    
+        slmpi::sum(dots); // reduce on all ranks
+        
+        densematrix hrow(1, k+1, std::vector<double>(dots.begin(), dots.begin()+k+1));
+        densematrix Qh = hrow.multiply(Q.getresized(k+1,n));
+        double* Qhptr = Qh.getvalues();
+        
+        double normhsquared = 0.0;
+        for (int i = 0; i < k+1; i++)
+        {
+            hvec[i] += dots[i];
+            normhsquared += dots[i]*dots[i];
+        }
+        for (int i = 0; i < n; i++)
+            qptr[i] -= Qhptr[i];
+            
+        double normqsquared = dots[k+1] - normhsquared;
+        normq = std::sqrt(std::max(normqsquared, 0.0));
+        
+        if (normqsquared > 1e-4*dots[k+1])
+            break;
+    }
+
+    // Norm the Krylov vector and place it in Q:
+    double invnormq = 1.0/normq;
+    for (int i = 0; i < n; i++)
+        Qptr[(k+1)*n+i] = invnormq * qptr[i];
+    
+    hvec[k+1] = normq;
+    
+    return hvec;
+}
+
 std::vector<double> myalgorithm::arnoldi(densematrix (*mymatmult)(densematrix), densematrix Q, int k)
 {   
     // One Krylov vector on each row:
     int n = Q.countcolumns();
-    double* Qptr = Q.getvalues();
     
     // Krylov vector fragment on each rank:
     densematrix q = mymatmult(Q.extractrows(k,k).getresized(n,1));
-    double* qptr = q.getvalues();
     
     if (q.countrows() != n || q.countcolumns() != 1)
     {
@@ -1187,34 +1464,76 @@ std::vector<double> myalgorithm::arnoldi(densematrix (*mymatmult)(densematrix),
         abort();
     }
     
-    // Standard Gramm-Schmidt orthogonalization:
-    densematrix h = Q.getresized(k+1,n).multiply(q);
-    h = h.getresized(1,k+1);
-    
-    slmpi::sum(k+1, h.getvalues()); // reduce on all ranks
+    return orthogonalize(Q, k, q);
+}
+
+std::vector<double> myalgorithm::pipelinedarnoldi(densematrix (*mymatmult)(densematrix), densematrix Q, densematrix W, int k)
+{
+    int n = Q.countcolumns();
+    double* Qptr = Q.getvalues();
+    double* Wptr = W.getvalues();
     
-    densematrix Qh = h.multiply(Q.getresized(k+1,n));
-    double* Qhptr = Qh.getvalues();
+    // w = A*qk is available in W:
+    densematrix w = W.extractrows(k,k).getresized(n,1);
+    double* wptr = w.getvalues();
     
-    // Subtract Qh and compute the norm of q:
-    double normqfrag = 0.0;
+    // Start the reduction of the projections and of the norm of w:
+    densematrix dots = Q.getresized(k+1,n).multiply(w);
+    std::vector<double> dotsvec;
+    dots.getvalues(dotsvec);
+    double normwfrag = 0.0;
     for (int i = 0; i < n; i++)
+        normwfrag += wptr[i]*wptr[i];
+    dotsvec.push_back(normwfrag);
+    
+    int request = slmpi::isum(k+2, dotsvec.data());
+    
+    // Overlap the reduction with the operator application on w:
+    densematrix p = mymatmult(w.copy());
+    double* pptr = p.getvalues();
+    
+    if (p.countrows() != n || p.countcolumns() != 1)
     {
-        qptr[i] -= Qhptr[i];
-        normqfrag += qptr[i]*qptr[i];
+        std::cout << "Error in 'myalgorithm' namespace: in function pipelinedarnoldi the matrix product function call returned a densematrix of wrong size on rank " << slmpi::getrank() << std::endl;
+        abort();
     }
-        
-    slmpi::sum(1, &normqfrag); // reduce on all ranks
     
-    double normq = std::sqrt(normqfrag);
-
-    // Norm the Krylov vector and place it in Q:
+    slmpi::wait(request);
+    
+    std::vector<double> hvec(dotsvec.begin(), dotsvec.begin()+k+1);
+    densematrix h(1, k+1, hvec);
+    
+    double normhsquared = 0.0;
+    for (int i = 0; i < k+1; i++)
+        normhsquared += hvec[i]*hvec[i];
+    double normqsquared = dotsvec[k+1] - normhsquared;
+    
+    // In case of a strong cancellation the pipelined recurrence is unreliable.
+    // Fall back to the non-pipelined orthogonalization (A*q_k+1 then requires one more operator call):
+    if (normqsquared <= 1e-4*dotsvec[k+1])
+    {
+        std::vector<double> hfallback = orthogonalize(Q, k, w);
+        densematrix qnext = mymatmult(Q.extractrows(k+1,k+1).getresized(n,1));
+        double* qnextptr = qnext.getvalues();
+        for (int i = 0; i < n; i++)
+            Wptr[(k+1)*n+i] = qnextptr[i];
+        return hfallback;
+    }
+    
+    double normq = std::sqrt(normqsquared);
     double invnormq = 1.0/normq;
+    
+    // q_k+1 = (w - Q*h)/normq and A*q_k+1 = (A*w - W*h)/normq:
+    densematrix Qh = h.multiply(Q.getresized(k+1,n));
+    densematrix Wh = h.multiply(W.getresized(k+1,n));
+    double* Qhptr = Qh.getvalues();
+    double* Whptr = Wh.getvalues();
     for (int i = 0; i < n; i++)
-        Qptr[(k+1)*n+i] = invnormq * qptr[i];
+    {
+        Qptr[(k+1)*n+i] = invnormq * (wptr[i] - Qhptr[i]);
+        Wptr[(k+1)*n+i] = invnormq * (pptr[i] - Whptr[i]);
+    }
     
-    std::vector<double> hvec;
-    h.getvalues(hvec);
     hvec.push_back(normq);
     
     return hvec;
@@ -9,6 +9,7 @@
 
 #include <vector>
 #include <iostream>
+#include <string>
 #include <numeric>
 #include <cmath>
 #include <tuple>
@@ -45,8 +46,15 @@ namespace myalgorithm
     // Same but sort by blocks of size 'blocklen':
     void stablesort(double noisethreshold, std::vector<double>& tosort, std::vector<int>& reorderingvector, int blocklen);
     
+    // Sort first according to 'tosort' then according to 'keys':
+    void stablesort(std::vector<int>& tosort, std::vector<unsigned long long int>& keys, std::vector<int>& reorderingvector);
+    
     void tuple3sort(std::vector<std::tuple<int,int,double>>& tosort);
     
+    // Get the position of every coordinate along a "hilbert" or "morton" space-filling curve covering 
+    // the box {xmin,xmax,ymin,ymax,zmin,zmax}. Sorting by position gives close coordinates close numbers.
+    std::vector<unsigned long long int> getspacefillingcurvekeys(std::vector<double>& coordinates, std::vector<double> bounds, std::string curvetype);
+    
     // Slice coordinates 'toslice' in the x, y and z direction into nsx*nsy*nsz groups. First slice position and distance between slices is provided as argument. Returned containers are:
     //
     //    - Group address 'ga[g]' gives the first position in 'pn' for group g (length of 'ga' is the number of groups + 1 and last value is the number of coordinates)  
@@ -167,15 +175,28 @@ namespace myalgorithm
     // Solve Ux = b where U is column-major upper triangular {r0c0,r0c1,r1c1,r0c2,...}:
     void solveuppertriangular(int len, double* U, double* b, double* x);
 
+    // Solve Ax = b where A is a dense row-major len x len matrix (Gaussian elimination with partial pivoting, A and b are unchanged):
+    void solvedense(int len, double* A, double* b, double* x);
+    
+    // Eigenvalues (sorted descendingly) and eigenvectors (one per row) of a dense symmetric row-major n x n matrix with the cyclic Jacobi algorithm:
+    void eigensymmetric(int n, double* A, std::vector<double>& eigenvalues, std::vector<double>& eigenvectors);
+
     // Givens rotation:
     void givensrotation(double a, double b, double& c, double& s, double& r);
     
     // Apply Givens rotation to h (the kth column of the unreduced upper Hessenberg matrix, h must have length k+2):
     void applygivensrotation(double* h, std::vector<double>& cs, std::vector<double>& sn, int k);
     
+    // Orthogonalize q against the first k+1 rows of Q and place the normed result in row k+1.
+    // Column k of the unreduced upper Hessenberg matrix is returned (length k+2). Vector q is modified:
+    std::vector<double> orthogonalize(densematrix Q, int k, densematrix q);
     // Q has one row per Krylov vector (at least k+2 rows must be preallocated).
-    // Column k of the unreduced upper Hessenberg matrix is returned (length k+2):
+    // Column k of the unreduced upper Hessenberg matrix is returned (length k+2).
+    // A single reduction is performed on all ranks unless the orthogonalization requires a second pass:
     std::vector<double> arnoldi(densematrix (*mymatmult)(densematrix), densematrix Q, int k);
+    // Same as above but row i of W must hold A*qi (W has the same size as Q and row k is available on entry). 
+    // The reduction is overlapped with the operator application and the next row of W is obtained by recurrence:
+    std::vector<double> pipelinedarnoldi(densematrix (*mymatmult)(densematrix), densematrix Q, densematrix W, int k);
     
     // Create a vector to renumber integer values with gaps to values without gap.
     // Integers must all be positive or zero. The number of unique integers is returned.
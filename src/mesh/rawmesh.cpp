@@ -1,5 +1,10 @@
 #include "rawmesh.h"
 #include "geotools.h"
+#include "slmpi.h"
+
+#ifdef HAVE_METIS
+#include "metis.h"
+#endif
 
 
 void rawmesh::splitmesh(void)
@@ -143,6 +148,415 @@ void rawmesh::readfromfile(std::string tool, std::string source)
     abort();
 }
 
+std::vector<std::vector<int>> rawmesh::getpartition(int numparts)
+{
+    #ifndef HAVE_METIS
+    std::cout << "Error in 'rawmesh' object: METIS is required to partition the mesh" << std::endl;
+    abort();
+    #else
+    
+    int numnodes = mynodes.count();
+    
+    // Get the mesh dimension:
+    int meshdim = 0;
+    for (int i = 1; i <= 7; i++)
+    {
+        if (myelements.count(i) > 0)
+            meshdim = std::max(meshdim, element(i).getelementdimension());
+    }
+    if (meshdim == 0)
+    {
+        std::cout << "Error in 'rawmesh' object: cannot partition a mesh made of point elements only" << std::endl;
+        abort();
+    }
+    
+    // Number all elements of max dimension consecutively (type after type):
+    std::vector<int> firstinpartgraph(8, 0);
+    int numgraphelems = 0;
+    for (int i = 1; i <= 7; i++)
+    {
+        firstinpartgraph[i] = numgraphelems;
+        if (element(i).getelementdimension() == meshdim)
+            numgraphelems += myelements.count(i);
+    }
+    
+    // Corner nodes of every element of max dimension:
+    std::vector<idx_t> eptr(numgraphelems+1, 0), eind = {};
+    for (int i = 1; i <= 7; i++)
+    {
+        element myelement(i);
+        if (myelement.getelementdimension() != meshdim)
+            continue;
+        int numcornernodes = myelement.countnodes();
+        for (int e = 0; e < myelements.count(i); e++)
+        {
+            for (int n = 0; n < numcornernodes; n++)
+                eind.push_back(myelements.getsubelement(0, i, e, n));
+            eptr[firstinpartgraph[i]+e+1] = eind.size();
+        }
+    }
+    
+    // Elements in p-adapted regions are weighted by their approximate number of dofs:
+    std::vector<idx_t> weights(numgraphelems, 1);
+    if (universe::partitionweights.size() == 2)
+    {
+        for (int k = 0; k < universe::partitionweights[0].size(); k++)
+        {
+            int physregindex = myphysicalregions.getindex(universe::partitionweights[0][k] + universe::physregshift*(meshdim+1));
+            if (physregindex == -1)
+                continue;
+            physicalregion* curpr = myphysicalregions.getatindex(physregindex);
+            if (curpr->getelementdimension() != meshdim)
+                continue;
+            
+            int curweight = std::pow(universe::partitionweights[1][k]+1, meshdim);
+            std::vector<std::vector<int>>* curelems = curpr->getelementlist();
+            for (int i = 1; i <= 7; i++)
+            {
+                if (element(i).getelementdimension() != meshdim)
+                    continue;
+                for (int e = 0; e < curelems->at(i).size(); e++)
+                {
+                    int graphelem = firstinpartgraph[i] + curelems->at(i)[e];
+                    weights[graphelem] = std::max(weights[graphelem], (idx_t)curweight);
+                }
+            }
+        }
+    }
+    
+    std::vector<int> epart(numgraphelems);
+    
+    idx_t ne = numgraphelems, nn = numnodes, ncommon = meshdim, nparts = numparts, objval;
+    std::vector<idx_t> epartidx(numgraphelems), npartidx(numnodes);
+    
+    idx_t options[METIS_NOPTIONS];
+    METIS_SetDefaultOptions(options);
+    options[METIS_OPTION_NUMBERING] = 0;
+    
+    int status = METIS_PartMeshDual(&ne, &nn, eptr.data(), eind.data(), weights.data(), NULL, &ncommon, &nparts, NULL, options, &objval, epartidx.data(), npartidx.data());
+    if (status != METIS_OK)
+    {
+        std::cout << "Error in 'rawmesh' object: METIS failed to partition the mesh" << std::endl;
+        abort();
+    }
+    for (int i = 0; i < numgraphelems; i++)
+        epart[i] = epartidx[i];
+    
+    // Elements of max dimension around each node:
+    std::vector<int> adjptr(numnodes+1, 0), adj(eind.size());
+    for (int i = 0; i < eind.size(); i++)
+        adjptr[eind[i]+1]++;
+    for (int n = 0; n < numnodes; n++)
+        adjptr[n+1] += adjptr[n];
+    std::vector<int> curadjpos(adjptr.begin(), adjptr.end()-1);
+    for (int e = 0; e < numgraphelems; e++)
+    {
+        for (int i = eptr[e]; i < eptr[e+1]; i++)
+        {
+            adj[curadjpos[eind[i]]] = e;
+            curadjpos[eind[i]]++;
+        }
+    }
+    
+    // Get the part of every element (-1 if not yet known). An element of lower dimension is in the part 
+    // of the first element of max dimension that contains all its corner nodes (it is not duplicated):
+    std::vector<std::vector<int>> parts(8);
+    // Point elements are in the part of the first element of max dimension around them:
+    parts[0] = std::vector<int>(numnodes, -1);
+    for (int n = 0; n < numnodes; n++)
+    {
+        if (adjptr[n+1] > adjptr[n])
+            parts[0][n] = epart[adj[adjptr[n]]];
+    }
+    int numunassigned = 0;
+    for (int i = 1; i <= 7; i++)
+    {
+        element myelement(i);
+        int numcornernodes = myelement.countnodes();
+        parts[i] = std::vector<int>(myelements.count(i), -1);
+        for (int e = 0; e < myelements.count(i); e++)
+        {
+            if (myelement.getelementdimension() == meshdim)
+            {
+                parts[i][e] = epart[firstinpartgraph[i]+e];
+                continue;
+            }
+            int firstnode = myelements.getsubelement(0, i, e, 0);
+            for (int a = adjptr[firstnode]; a < adjptr[firstnode+1]; a++)
+            {
+                int graphelem = adj[a];
+                bool iscontained = true;
+                for (int n = 1; n < numcornernodes; n++)
+                {
+                    int curnode = myelements.getsubelement(0, i, e, n);
+                    if (std::find(eind.begin()+eptr[graphelem], eind.begin()+eptr[graphelem+1], curnode) == eind.begin()+eptr[graphelem+1])
+                    {
+                        iscontained = false;
+                        break;
+                    }
+                }
+                if (iscontained)
+                {
+                    parts[i][e] = epart[graphelem];
+                    break;
+                }
+            }
+            if (parts[i][e] == -1)
+                numunassigned++;
+        }
+    }
+    
+    // Elements of lower dimension not contained in an element of max dimension go to the part of 
+    // an element touching one of their corner nodes (this propagates along chains of such elements):
+    while (numunassigned > 0)
+    {
+        int prevnumunassigned = numunassigned;
+        for (int i = 1; i <= 7; i++)
+        {
+            element myelement(i);
+            int numcornernodes = myelement.countnodes();
+            for (int e = 0; e < myelements.count(i); e++)
+            {
+                if (parts[i][e] != -1)
+                    continue;
+                for (int n = 0; n < numcornernodes; n++)
+                {
+                    int curnode = myelements.getsubelement(0, i, e, n);
+                    if (parts[0][curnode] != -1)
+                    {
+                        parts[i][e] = parts[0][curnode];
+                        break;
+                    }
+                }
+                if (parts[i][e] == -1)
+                    continue;
+                for (int n = 0; n < numcornernodes; n++)
+                {
+                    int curnode = myelements.getsubelement(0, i, e, n);
+                    if (parts[0][curnode] == -1)
+                        parts[0][curnode] = parts[i][e];
+                }
+                numunassigned--;
+            }
+        }
+        if (numunassigned == prevnumunassigned)
+        {
+            std::cout << "Error in 'rawmesh' object: cannot partition the mesh (" << numunassigned << " elements are not connected to any element of max dimension)" << std::endl;
+            abort();
+        }
+    }
+    
+    // The nodes in point physical regions must belong to an element:
+    for (int p = 0; p < myphysicalregions.count(); p++)
+    {
+        std::vector<int>* curnodes = &(myphysicalregions.getatindex(p)->getelementlist()->at(0));
+        for (int n = 0; n < curnodes->size(); n++)
+        {
+            if (parts[0][curnodes->at(n)] == -1)
+            {
+                std::cout << "Error in 'rawmesh' object: cannot partition the mesh (a point element in physical region " << myphysicalregions.getnumber(p) << " is not connected to any element)" << std::endl;
+                abort();
+            }
+        }
+    }
+    
+    return parts;
+    
+    #endif
+}
+
+void rawmesh::getpart(std::vector<std::vector<int>>& parts, int part, std::vector<int>& intdata, std::vector<double>& doubledata)
+{
+    int numnodes = mynodes.count();
+    int curvatureorder = myelements.getcurvatureorder();
+    
+    // Keep the nodes of the elements in the part:
+    std::vector<int> noderenumbering(numnodes, -1);
+    for (int i = 1; i <= 7; i++)
+    {
+        int numcurvednodes = element(i, curvatureorder).countcurvednodes();
+        for (int e = 0; e < myelements.count(i); e++)
+        {
+            if (parts[i][e] != part)
+                continue;
+            for (int n = 0; n < numcurvednodes; n++)
+                noderenumbering[myelements.getsubelement(0, i, e, n)] = 0;
+        }
+    }
+    std::vector<double>* coords = mynodes.getcoordinates();
+    doubledata = {};
+    int numkeptnodes = 0;
+    for (int n = 0; n < numnodes; n++)
+    {
+        if (noderenumbering[n] == 0)
+        {
+            noderenumbering[n] = numkeptnodes;
+            for (int c = 0; c < 3; c++)
+                doubledata.push_back(coords->at(3*n+c));
+            numkeptnodes++;
+        }
+        else
+            noderenumbering[n] = -1;
+    }
+    
+    // The int data is {curvature order, number of nodes, number of elements of each type 1 to 7, their renumbered 
+    // nodes, number of physical regions, then for each: its number, its number of elements of each type 0 to 7 and 
+    // the renumbered elements}:
+    intdata = {curvatureorder, numkeptnodes};
+    
+    std::vector<std::vector<int>> elementrenumbering(8);
+    elementrenumbering[0] = noderenumbering;
+    std::vector<int> numkept(8, 0);
+    for (int i = 1; i <= 7; i++)
+    {
+        elementrenumbering[i] = std::vector<int>(myelements.count(i), -1);
+        for (int e = 0; e < myelements.count(i); e++)
+        {
+            if (parts[i][e] != part)
+                continue;
+            elementrenumbering[i][e] = numkept[i];
+            numkept[i]++;
+        }
+        intdata.push_back(numkept[i]);
+    }
+    for (int i = 1; i <= 7; i++)
+    {
+        int numcurvednodes = element(i, curvatureorder).countcurvednodes();
+        for (int e = 0; e < myelements.count(i); e++)
+        {
+            if (parts[i][e] != part)
+                continue;
+            for (int n = 0; n < numcurvednodes; n++)
+                intdata.push_back(noderenumbering[myelements.getsubelement(0, i, e, n)]);
+        }
+    }
+    
+    intdata.push_back(myphysicalregions.count());
+    for (int p = 0; p < myphysicalregions.count(); p++)
+    {
+        intdata.push_back(myphysicalregions.getnumber(p));
+        std::vector<std::vector<int>>* curelems = myphysicalregions.getatindex(p)->getelementlist();
+        std::vector<std::vector<int>> physregelements(8);
+        for (int i = 0; i <= 7; i++)
+        {
+            for (int e = 0; e < curelems->at(i).size(); e++)
+            {
+                int elem = curelems->at(i)[e];
+                if (parts[i][elem] == part && elementrenumbering[i][elem] >= 0)
+                    physregelements[i].push_back(elementrenumbering[i][elem]);
+            }
+            intdata.push_back(physregelements[i].size());
+        }
+        for (int i = 0; i <= 7; i++)
+            intdata.insert(intdata.end(), physregelements[i].begin(), physregelements[i].end());
+    }
+}
+
+void rawmesh::setpart(std::vector<int>& intdata, std::vector<double>& doubledata)
+{
+    int curvatureorder = intdata[0];
+    int numnodes = intdata[1];
+    int index = 2;
+    
+    // Replace the mesh by the part:
+    myphysicalregions = physicalregions(mydisjointregions);
+    myelements = elements(mynodes, myphysicalregions, mydisjointregions);
+    
+    mynodes.setnumber(numnodes);
+    std::vector<double>* coords = mynodes.getcoordinates();
+    for (int n = 0; n < 3*numnodes; n++)
+        coords->at(n) = doubledata[n];
+    
+    std::vector<int> numelems(8, 0);
+    for (int i = 1; i <= 7; i++)
+    {
+        numelems[i] = intdata[index];
+        index++;
+    }
+    for (int i = 1; i <= 7; i++)
+    {
+        int numcurvednodes = element(i, curvatureorder).countcurvednodes();
+        std::vector<int> nodelist(numcurvednodes);
+        for (int e = 0; e < numelems[i]; e++)
+        {
+            for (int n = 0; n < numcurvednodes; n++)
+                nodelist[n] = intdata[index+n];
+            index += numcurvednodes;
+            myelements.add(i, curvatureorder, nodelist);
+        }
+    }
+    
+    int numphysregs = intdata[index];
+    index++;
+    for (int p = 0; p < numphysregs; p++)
+    {
+        int physregnumber = intdata[index];
+        std::vector<int> numphysregelems(intdata.begin()+index+1, intdata.begin()+index+9);
+        index += 9;
+        
+        // Only the physical regions with elements in the part are created:
+        if (myalgorithm::sum(numphysregelems) == 0)
+            continue;
+        
+        physicalregion* curpr = myphysicalregions.get(physregnumber);
+        for (int i = 0; i <= 7; i++)
+        {
+            for (int e = 0; e < numphysregelems[i]; e++)
+                curpr->addelement(i, intdata[index+e]);
+            index += numphysregelems[i];
+        }
+    }
+}
+
+void rawmesh::partition(int verbosity)
+{
+    int rank = slmpi::getrank();
+    int numranks = slmpi::count();
+    
+    if (numranks == 1)
+        return;
+    
+    wallclock partitiontime;
+    
+    // Only rank 0 has read the mesh. It partitions it and sends every rank its part:
+    std::vector<int> intdata = {}, allintdata = {}, intfragsizes(numranks);
+    std::vector<double> doubledata = {}, alldoubledata = {};
+    std::vector<int> datasizes(2), alldatasizes(2*numranks);
+    if (rank == 0)
+    {
+        std::vector<std::vector<int>> parts = getpartition(numranks);
+        
+        for (int r = 0; r < numranks; r++)
+        {
+            getpart(parts, r, intdata, doubledata);
+            alldatasizes[2*r+0] = intdata.size();
+            alldatasizes[2*r+1] = doubledata.size();
+            allintdata.insert(allintdata.end(), intdata.begin(), intdata.end());
+            alldoubledata.insert(alldoubledata.end(), doubledata.begin(), doubledata.end());
+        }
+    }
+    slmpi::scatter(0, alldatasizes, datasizes);
+    
+    std::vector<int> doublefragsizes(numranks);
+    for (int r = 0; r < numranks; r++)
+    {
+        intfragsizes[r] = alldatasizes[2*r+0];
+        doublefragsizes[r] = alldatasizes[2*r+1];
+    }
+    intdata.resize(datasizes[0]);
+    doubledata.resize(datasizes[1]);
+    slmpi::scatter(0, allintdata, intdata, intfragsizes);
+    slmpi::scatter(0, alldoubledata, doubledata, doublefragsizes);
+    
+    setpart(intdata, doubledata);
+    
+    // The weights only apply to this partition:
+    universe::partitionweights = {};
+    
+    if (verbosity > 0 && rank == 0)
+        partitiontime.print("Time to partition the mesh in "+std::to_string(numranks)+" parts: ");
+}
+
 void rawmesh::writetofile(std::string name)
 {
     if (name.length() >= 5 && name.compare(name.size()-4,4,".msh") == 0)
@@ -198,6 +612,8 @@ void rawmesh::printcount(void)
 rawmesh::rawmesh(void) : myelements(mynodes, myphysicalregions, mydisjointregions), myphysicalregions(mydisjointregions), myregiondefiner(mynodes, myelements, myphysicalregions)
 {
     universe::addtorawmeshcounter(1);
+    // Do not reuse form function values or sum factorizations from a previously loaded mesh:
+    universe::resethff();
 }
 
 rawmesh::~rawmesh(void)
@@ -262,7 +678,15 @@ void rawmesh::load(std::string name, int globalgeometryskin, int numoverlaplayer
     
     wallclock loadtime;
     
-    readfromfile(tool, source);
+    // A mesh to partition in memory is only read by rank 0:
+    bool topartition = universe::partitionnextmesh;
+    universe::partitionnextmesh = false;
+    
+    if (not(topartition) || slmpi::getrank() == 0)
+        readfromfile(tool, source);
+    
+    if (topartition)
+        partition(verbosity);
     
     splitmesh();
     mynodes.fixifaxisymmetric();
@@ -280,9 +704,11 @@ void rawmesh::load(std::string name, int globalgeometryskin, int numoverlaplayer
     }
     
     myelements.definedisjointregions();
-    // The reordering is stable and the elements are thus still ordered 
-    // by barycenter coordinates in every disjoint region!
+    // The reordering is stable and the elements are thus still ordered by barycenter
+    // coordinates in every disjoint region, until they are renumbered along a
+    // space-filling curve below (unless the renumbering is "none"):
     myelements.reorderbydisjointregions();
+    myelements.reorderbylocality(universe::meshrenumbering);
     myelements.definedisjointregionsranges();
     
     // For DDM:
@@ -512,9 +938,11 @@ void rawmesh::load(std::vector<shape> inputshapes, int globalgeometryskin, int n
     }
     
     myelements.definedisjointregions();
-    // The reordering is stable and the elements are thus still ordered 
-    // by barycenter coordinates in every disjoint region!
+    // The reordering is stable and the elements are thus still ordered by barycenter
+    // coordinates in every disjoint region, until they are renumbered along a
+    // space-filling curve below (unless the renumbering is "none"):
     myelements.reorderbydisjointregions();
+    myelements.reorderbylocality(universe::meshrenumbering);
     myelements.definedisjointregionsranges();
     
     // For DDM:
@@ -1038,54 +1466,6 @@ bool rawmesh::adapthp(int verbosity)
     return (washadapted || waspadapted);
 }
 
-void rawmesh::getattarget(std::vector<std::vector<int>>& values, std::shared_ptr<rawmesh> target)
-{
-    int meshdim = getmeshdimension();
-    
-    std::shared_ptr<htracker> ht = gethtracker();
-    std::shared_ptr<htracker> httarg = target->gethtracker();
-        
-    int numleaves = ht->countleaves();
-        
-    // Send from elements to leaves:
-    std::vector<int> leafvalues(numleaves, -1);
-    for (int i = 0; i < 8; i++)
-    {
-        element myelement(i);
-        if (myelement.getelementdimension() != meshdim)
-            continue;
-            
-        int ne = myelements.count(i);
-        for (int e = 0; e < ne; e++)
-        {
-            int leafnum = ht->getleafnumber(i, e);
-            leafvalues[leafnum] = std::max(values[i][e], leafvalues[leafnum]);
-        }
-    }
-    
-    // Transfer to target mesh:
-    std::vector<int> leafvaluestarg;
-    ht->getattarget(leafvalues, httarg.get(), leafvaluestarg);
-    
-    // Send from leaves to elements:
-    for (int i = 0; i < 8; i++)
-    {
-        element myelement(i);
-        if (myelement.getelementdimension() != meshdim)
-            continue;
-            
-        int ne = target->getelements()->count(i);
-        // Preallocate new size:
-        values[i] = std::vector<int>(ne);
-        
-        for (int e = 0; e < ne; e++)
-        {
-            int leafnumtarg = httarg->getleafnumber(i, e);
-            values[i][e] = leafvaluestarg[leafnumtarg];
-        }
-    }
-}
-
 void rawmesh::add(std::shared_ptr<rawfield> inrawfield, expression criterion, int loworder, int highorder, double critrange)
 {
     int index = -1;
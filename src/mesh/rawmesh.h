@@ -65,10 +65,19 @@ class rawmesh : public std::enable_shared_from_this<rawmesh>
         // For the h-adapted mesh:
         std::shared_ptr<htracker> myhtracker = NULL;
         
+        // Get the part of every element (parts[elementtypenumber][elementnumber]) in a METIS partition of the mesh:
+        std::vector<std::vector<int>> getpartition(int numparts);
+        // Pack the nodes, elements and physical region elements of a part in int and double vectors and unpack them to replace this mesh:
+        void getpart(std::vector<std::vector<int>>& parts, int part, std::vector<int>& intdata, std::vector<double>& doubledata);
+        void setpart(std::vector<int>& intdata, std::vector<double>& doubledata);
+        
     public:
         
         // 'readfromfile' hands over to the function reading the format of the mesh file.
         void readfromfile(std::string tool, std::string source);
+        // 'partition' partitions the mesh read by rank 0 with METIS in as many parts as there are ranks and sends every rank its part.
+        // The elements are weighted according to 'universe::partitionweights' (if defined).
+        void partition(int verbosity);
         // 'writetofile' hands over to the function writing the format of the mesh file.
         void writetofile(std::string);
 
@@ -0,0 +1,87 @@
+#include "affinedecomposition.h"
+
+
+affinedecomposition::affinedecomposition(formulation formul, std::vector<int> blocknumbers, int verbosity)
+{
+    myverbosity = verbosity;
+    
+    myformulation = formul;
+    if (myformulation.isdampingmatrixdefined() || myformulation.ismassmatrixdefined())
+    {
+        std::cout << "Error in 'affinedecomposition' object: formulation provided cannot have a damping/mass matrix" << std::endl;
+        abort();  
+    }
+    if (blocknumbers.size() == 0)
+    {
+        std::cout << "Error in 'affinedecomposition' object: expected at least one block number" << std::endl;
+        abort();
+    }
+    
+    wallclock clk;
+    
+    int numterms = blocknumbers.size();
+    
+    mymats = std::vector<mat>(numterms);
+    myvecs = std::vector<vec>(numterms);
+    for (int i = 0; i < numterms; i++)
+    {
+        myformulation.generate(blocknumbers[i]);
+        mymats[i] = myformulation.A();
+        myvecs[i] = myformulation.b(false, false);
+    }
+    
+    // The union of all nonzero patterns:
+    mysweepmat = mymats[0].copy();
+    for (int i = 1; i < numterms; i++)
+        mysweepmat = mysweepmat + mymats[i];
+    // The values change in place but the pattern is fixed:
+    mysweepmat.reusefactorization();
+    
+    if (myverbosity > 0)
+        clk.print("Affine decomposition assembly ("+std::to_string(numterms)+" terms) took");
+}
+
+void affinedecomposition::errorifwronglength(std::vector<double>& thetas)
+{
+    if (thetas.size() != mymats.size())
+    {
+        std::cout << "Error in 'affinedecomposition' object: expected " << mymats.size() << " theta values (one per affine term)" << std::endl;
+        abort();
+    }
+}
+
+mat affinedecomposition::getmatrix(std::vector<double> thetas)
+{
+    errorifwronglength(thetas);
+    
+    mat output = thetas[0]*mymats[0];
+    for (int i = 1; i < mymats.size(); i++)
+        output = output + thetas[i]*mymats[i];
+    
+    return output;
+}
+
+vec affinedecomposition::getrhs(std::vector<double> thetas)
+{
+    errorifwronglength(thetas);
+    
+    vec output = thetas[0]*myvecs[0];
+    for (int i = 1; i < myvecs.size(); i++)
+        output = output + thetas[i]*myvecs[i];
+    
+    output.updateconstraints();
+    
+    return output;
+}
+
+vec affinedecomposition::solve(std::vector<double> thetas, std::string soltype)
+{
+    errorifwronglength(thetas);
+    
+    mysweepmat.setlinearcombination(thetas, mymats);
+    
+    vec sol = sl::solve(mysweepmat, getrhs(thetas), soltype);
+    sl::setdata(sol);
+    
+    return sol;
+}
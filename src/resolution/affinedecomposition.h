@@ -0,0 +1,63 @@
+// sparselizard - Copyright (C) see copyright file.
+//
+// See the LICENSE file for license information. Please report all
+// bugs and problems to <alexandre.halbach at gmail.com>.
+
+// This object handles formulations whose dependency on scalar parameters is affine:
+//
+// K(p) = sum_i theta_i(p) * K_i    and    rhs(p) = sum_i theta_i(p) * rhs_i
+//
+// Term i corresponds to all contributions of block number 'blocknumbers[i]' in the formulation
+// (see the last argument of 'integral'). Every term is assembled once and K(p) and rhs(p)
+// are then obtained by weighted sums of the cached matrices and vectors. The Dirichlet
+// constraints are not supposed affine and are recomputed for every rhs(p).
+
+#ifndef AFFINEDECOMPOSITION_H
+#define AFFINEDECOMPOSITION_H
+
+#include <iostream>
+#include <vector>
+#include "vec.h"
+#include "mat.h"
+#include "universe.h"
+#include "sl.h"
+#include "wallclock.h"
+#include "formulation.h"
+
+class affinedecomposition
+{
+    private:
+        
+        int myverbosity = 1;
+        
+        formulation myformulation;
+        
+        // Cached matrix and rhs (without Dirichlet constraints) of every term:
+        std::vector<mat> mymats = {};
+        std::vector<vec> myvecs = {};
+        
+        // Matrix whose values are updated in place to K(p) at every solve:
+        mat mysweepmat;
+        
+        void errorifwronglength(std::vector<double>& thetas);
+        
+    public:
+        
+        affinedecomposition(formulation formul, std::vector<int> blocknumbers, int verbosity = 1);
+        
+        void setverbosity(int verbosity) { myverbosity = verbosity; };
+        
+        // Number of affine terms:
+        int count(void) { return mymats.size(); };
+        
+        // Get K(p) and rhs(p) for the 'thetas' values of all terms:
+        mat getmatrix(std::vector<double> thetas);
+        vec getrhs(std::vector<double> thetas);
+        
+        // Solve K(p)*x = rhs(p) and save the solution to the fields. Since the nonzero pattern is fixed
+        // only the numerical factorization is recomputed from one call to the next.
+        vec solve(std::vector<double> thetas, std::string soltype = "lu");
+        
+};
+
+#endif
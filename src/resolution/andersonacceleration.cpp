@@ -0,0 +1,112 @@
+#include "andersonacceleration.h"
+
+
+andersonacceleration::andersonacceleration(int depth, double mixing)
+{
+    if (depth < 0)
+    {
+        std::cout << "Error in 'andersonacceleration' object: depth cannot be negative" << std::endl;
+        abort();
+    }
+    if (mixing <= 0)
+    {
+        std::cout << "Error in 'andersonacceleration' object: expected a positive mixing factor" << std::endl;
+        abort();
+    }
+    
+    mydepth = depth;
+    mymixing = mixing;
+}
+
+vec andersonacceleration::next(vec x, vec gx)
+{
+    densematrix xvals = x.getallvalues();
+    densematrix fvals = gx.getallvalues();
+    fvals.subtract(xvals);
+    
+    long long int n = xvals.count();
+    
+    // The history is lost if the number of unknowns has changed:
+    if (myxs.size() > 0 && myxs[0].count() != n)
+        reset();
+    
+    myxs.push_back(xvals);
+    myfs.push_back(fvals);
+    if (myxs.size() > mydepth+1)
+    {
+        myxs.erase(myxs.begin());
+        myfs.erase(myfs.begin());
+    }
+    
+    int m = myxs.size()-1;
+    
+    // Relaxed fixed-point update x + mixing*f:
+    densematrix output = xvals.copy();
+    output.addproduct(mymixing, fvals);
+    
+    if (m > 0)
+    {
+        // Differences between consecutive iterates and residuals:
+        std::vector<densematrix> dxs(m), dfs(m);
+        for (int j = 0; j < m; j++)
+        {
+            dxs[j] = myxs[j+1].copy();
+            dxs[j].subtract(myxs[j]);
+            dfs[j] = myfs[j+1].copy();
+            dfs[j].subtract(myfs[j]);
+        }
+        
+        // Normal equations of the least-squares problem min || f - dF * gamma ||:
+        densematrix A(m,m), b(m,1);
+        double* Aptr = A.getvalues();
+        double* bptr = b.getvalues();
+        double* fptr = fvals.getvalues();
+        for (int i = 0; i < m; i++)
+        {
+            double* dfiptr = dfs[i].getvalues();
+            
+            double dotf = 0;
+            for (long long int k = 0; k < n; k++)
+                dotf += dfiptr[k]*fptr[k];
+            bptr[i] = dotf;
+            
+            for (int j = 0; j <= i; j++)
+            {
+                double* dfjptr = dfs[j].getvalues();
+                
+                double dotij = 0;
+                for (long long int k = 0; k < n; k++)
+                    dotij += dfiptr[k]*dfjptr[k];
+                Aptr[i*m+j] = dotij;
+                Aptr[j*m+i] = dotij;
+            }
+        }
+        
+        // Small Tikhonov regularization against an ill-conditioned history:
+        double maxdiag = 0;
+        for (int i = 0; i < m; i++)
+        {
+            if (Aptr[i*m+i] > maxdiag)
+                maxdiag = Aptr[i*m+i];
+        }
+        // All residual differences are zero (e.g. converged):
+        if (maxdiag == 0)
+            return gx;
+        for (int i = 0; i < m; i++)
+            Aptr[i*m+i] += 1e-10*maxdiag;
+        
+        densematrix gamma = A.getinverse().multiply(b);
+        double* gammaptr = gamma.getvalues();
+        
+        for (int j = 0; j < m; j++)
+        {
+            output.addproduct(-gammaptr[j], dxs[j]);
+            output.addproduct(-mymixing*gammaptr[j], dfs[j]);
+        }
+    }
+    
+    vec outvec = x.copy();
+    outvec.setallvalues(output);
+    
+    return outvec;
+}
@@ -0,0 +1,48 @@
+// sparselizard - Copyright (C) see copyright file.
+//
+// See the LICENSE file for license information. Please report all
+// bugs and problems to <alexandre.halbach at gmail.com>.
+
+// This object implements the Anderson acceleration of a fixed-point iteration
+//
+// x_k+1 = g(x_k)
+//
+// The residuals f_k = g(x_k) - x_k of the last 'depth' iterates are combined so that the 
+// linearized residual is minimized in the least-squares sense. With depth 0 this reduces 
+// to the relaxed fixed-point iteration x_k+1 = x_k + mixing * f_k. The acceleration only 
+// uses vector operations and thus adds no assembly or solve to the fixed-point iteration.
+
+#ifndef ANDERSONACCELERATION_H
+#define ANDERSONACCELERATION_H
+
+#include <iostream>
+#include <vector>
+#include "vec.h"
+#include "densematrix.h"
+
+class andersonacceleration
+{
+    private:
+        
+        int mydepth = 5;
+        double mymixing = 1.0;
+        
+        // History of the iterates and their residuals (oldest first):
+        std::vector<densematrix> myxs = {};
+        std::vector<densematrix> myfs = {};
+        
+    public:
+        
+        andersonacceleration(int depth = 5, double mixing = 1.0);
+        
+        int getdepth(void) { return mydepth; };
+        
+        // Forget all previous iterates (e.g. when a new nonlinear loop starts):
+        void reset(void) { myxs = {}; myfs = {}; };
+        
+        // Get the next iterate from the current iterate 'x' and the fixed-point map evaluated at 'x':
+        vec next(vec x, vec gx);
+        
+};
+
+#endif
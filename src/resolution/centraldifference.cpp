@@ -0,0 +1,348 @@
+#include "centraldifference.h"
+
+centraldifference::centraldifference(formulation formul, vec initspeed, int verbosity, std::string lumping, std::vector<bool> isrhskcmconstant)
+{
+    myverbosity = verbosity;
+
+    myformulation = formul;
+    
+    v = initspeed;
+    mylumping = lumping;
+    isconstant = isrhskcmconstant;
+    
+    if (mylumping != "rowsum" && mylumping != "scaleddiagonal")
+    {
+        std::cout << "Error in 'centraldifference' object: unknown mass lumping '" << mylumping << "' (use 'rowsum' or 'scaleddiagonal')" << std::endl;
+        abort();  
+    }
+    if (isconstant.size() != 4)
+    {
+        std::cout << "Error in 'centraldifference' object: expected a length 4 vector as fifth argument" << std::endl;
+        abort();  
+    }
+}
+
+void centraldifference::settimederivative(std::vector<vec> sol)
+{
+    if (sol.size() != 2)
+    {
+        std::cout << "Error in 'centraldifference' object: expected a vector of length two to set the time derivatives" << std::endl;
+        abort();  
+    }
+    v = sol[0]; a = sol[1];
+    isaccelerationdefined = true;
+}
+
+void centraldifference::assemble(void)
+{
+    bool isfirstcall = not(K.isdefined());
+    
+    if (isconstant[0] == false || isfirstcall)
+    {
+        myformulation.generaterhs();
+        rhs = myformulation.rhs(false, false);
+    }
+    rhs.updateconstraints();
+    
+    if (isconstant[1] == false || isfirstcall)
+    {
+        myformulation.generatestiffnessmatrix();
+        K = myformulation.K(false);
+        mycriticaldt = -1;
+    }
+    if (isconstant[2] == false || isfirstcall)
+    {
+        myformulation.generatedampingmatrix();
+        C = myformulation.C(false);
+    }
+    if (isconstant[3] == false || isfirstcall)
+    {
+        myformulation.generatemassmatrix();
+        M = myformulation.M(false);
+        lumpmass();
+        mycriticaldt = -1;
+    }
+}
+
+void centraldifference::lumpmass(void)
+{
+    ainds = M.getainds();
+    dinds = M.getdinds();
+    
+    int na = ainds.count();
+    
+    if (mylumping == "rowsum")
+    {
+        // Row sums of the mass matrix (including the Dirichlet constrained columns):
+        vec ones(myformulation);
+        ones.setallvalues(densematrix(ones.size(), 1, 1.0));
+        invlumpedmass = (M*ones).getvalues(ainds);
+    }
+    else
+    {
+        Vec diagpetsc;
+        VecCreate(PETSC_COMM_SELF, &diagpetsc);
+        VecSetSizes(diagpetsc, PETSC_DECIDE, na);
+        VecSetFromOptions(diagpetsc);
+        MatGetDiagonal(M.getapetsc(), diagpetsc);
+        
+        invlumpedmass = densematrix(na, 1);
+        intdensematrix allinds(na, 1, 0, 1);
+        if (na > 0)
+            VecGetValues(diagpetsc, na, allinds.getvalues(), invlumpedmass.getvalues());
+        VecDestroy(&diagpetsc);
+        
+        // Position of every dof in the unconstrained dofs (-1 if constrained):
+        std::vector<int> aposition(myformulation.countdofs(), -1);
+        int* aindsptr = ainds.getvalues();
+        for (int i = 0; i < na; i++)
+            aposition[aindsptr[i]] = i;
+        
+        // Scale the diagonal of every field to preserve its total mass:
+        double* diagptr = invlumpedmass.getvalues();
+        disjointregions* mydisjointregions = universe::mymesh->getdisjointregions();
+        std::shared_ptr<dofmanager> dofmngr = myformulation.getdofmanager();
+        std::vector<std::shared_ptr<rawfield>> fields = dofmngr->getfields();
+        for (int f = 0; f < fields.size(); f++)
+        {
+            dofmngr->selectfield(fields[f]);
+            std::vector<int> fielddisjregs = dofmngr->getdisjointregionsofselectedfield();
+            
+            // Unconstrained dofs of the field and dofs of a unit field:
+            std::vector<int> fieldapositions = {};
+            std::vector<int> unitinds = {}, vertexinds = {};
+            for (int i = 0; i < fielddisjregs.size(); i++)
+            {
+                int d = fielddisjregs[i];
+                bool isvertex = (mydisjointregions->getelementtypenumber(d) == 0);
+                for (int ff = 0; ff < dofmngr->countformfunctions(d); ff++)
+                {
+                    for (int j = dofmngr->getrangebegin(d, ff); j <= dofmngr->getrangeend(d, ff); j++)
+                    {
+                        unitinds.push_back(j);
+                        if (isvertex)
+                            vertexinds.push_back(j);
+                        if (aposition[j] != -1)
+                            fieldapositions.push_back(aposition[j]);
+                    }
+                }
+            }
+            if (vertexinds.size() > 0)
+                unitinds = vertexinds;
+            if (unitinds.size() == 0)
+                continue;
+            
+            // Total mass u^T*M*u of the unit field u (on the unconstrained rows):
+            vec unitfield(myformulation);
+            intdensematrix unitaddresses(unitinds.size(), 1, unitinds);
+            unitfield.setvalues(unitaddresses, densematrix(unitinds.size(), 1, 1.0));
+            densematrix prodvals = (M*unitfield).getvalues(unitaddresses);
+            double* prodptr = prodvals.getvalues();
+            double fieldmass = 0;
+            for (int i = 0; i < unitinds.size(); i++)
+            {
+                if (aposition[unitinds[i]] != -1)
+                    fieldmass += prodptr[i];
+            }
+            
+            double diagsum = 0;
+            for (int i = 0; i < fieldapositions.size(); i++)
+                diagsum += diagptr[fieldapositions[i]];
+            if (diagsum == 0)
+                continue;
+            for (int i = 0; i < fieldapositions.size(); i++)
+                diagptr[fieldapositions[i]] *= fieldmass/diagsum;
+        }
+    }
+    
+    double* lmptr = invlumpedmass.getvalues();
+    for (int i = 0; i < na; i++)
+    {
+        if (lmptr[i] <= 0)
+        {
+            std::cout << "Error in 'centraldifference' object: non-positive lumped mass obtained";
+            if (mylumping == "rowsum")
+                std::cout << " (try the 'scaleddiagonal' lumping, row sum lumping is only suited for order 1 shape functions)";
+            std::cout << std::endl;
+            abort();
+        }
+    }
+    invlumpedmass.invert();
+}
+
+densematrix centraldifference::getacceleration(vec u, vec speed)
+{
+    // The constrained dofs are unused since the products are only evaluated on the unconstrained dofs:
+    densematrix force = (rhs - K*u - C*speed).getvalues(ainds);
+    force.multiplyelementwise(invlumpedmass);
+    
+    return force;
+}
+
+double centraldifference::getcriticaltimestep(std::string method, int maxnumit, double tol)
+{
+    if (method != "gershgorin" && method != "poweriteration")
+    {
+        std::cout << "Error in 'centraldifference' object: unknown critical timestep method '" << method << "' (use 'gershgorin' or 'poweriteration')" << std::endl;
+        abort();
+    }
+    
+    if (not(K.isdefined()))
+        assemble();
+    
+    if (mycriticaldt > 0 && mycriticaldtmethod == method)
+        return mycriticaldt;
+    
+    int na = ainds.count();
+    if (na == 0)
+        return -1;
+    
+    double lambda = 0;
+    
+    if (method == "gershgorin")
+    {
+        // All eigenvalues of inv(Ml)*K are in a Gershgorin disc centred on K_ii/m_i of radius sum_{j!=i} |K_ij|/m_i:
+        Mat Kpetsc = K.getapetsc();
+        double* lmptr = invlumpedmass.getvalues();
+        for (int i = 0; i < na; i++)
+        {
+            PetscInt ncols; const PetscInt* cols; const PetscScalar* vals;
+            MatGetRow(Kpetsc, i, &ncols, &cols, &vals);
+            double absrowsum = 0;
+            for (int j = 0; j < ncols; j++)
+                absrowsum += std::abs(vals[j]);
+            MatRestoreRow(Kpetsc, i, &ncols, &cols, &vals);
+            
+            lambda = std::max(lambda, absrowsum*lmptr[i]);
+        }
+    }
+    else
+        lambda = getlargesteigenvalue(maxnumit, tol);
+    
+    if (lambda <= 0)
+        return -1;
+    
+    mycriticaldt = 2.0/std::sqrt(lambda);
+    mycriticaldtmethod = method;
+    
+    if (myverbosity > 1)
+        std::cout << "Critical timestep " << (method == "gershgorin" ? "bounded" : "estimated") << " to " << mycriticaldt << "s" << std::endl;
+    
+    return mycriticaldt;
+}
+
+double centraldifference::getlargesteigenvalue(int maxnumit, double tol)
+{
+    int na = ainds.count();
+    
+    // Power iteration on inv(Ml)*K for the largest eigenvalue wmax^2:
+    densematrix x(na, 1);
+    double* xptr = x.getvalues();
+    for (int i = 0; i < na; i++)
+        xptr[i] = 1.0 + 0.5*std::sin(1.0 + i);
+    
+    double lambda = 0, prevlambda = 0;
+    for (int it = 0; it < maxnumit; it++)
+    {
+        vec xa(na, intdensematrix(na, 1, 0, 1), x);
+        densematrix Kx = (K*K.x0merge(xa)).getvalues(ainds);
+        
+        // Rayleigh quotient (x^T K x)/(x^T Ml x):
+        double* Kxptr = Kx.getvalues();
+        double* lmptr = invlumpedmass.getvalues();
+        double xtKx = 0, xtMlx = 0;
+        for (int i = 0; i < na; i++)
+        {
+            xtKx += xptr[i]*Kxptr[i];
+            xtMlx += xptr[i]*xptr[i]/lmptr[i];
+        }
+        lambda = xtKx/xtMlx;
+        
+        Kx.multiplyelementwise(invlumpedmass);
+        double nrm = Kx.maxabs();
+        if (nrm == 0)
+            return 0;
+        Kx.multiplyelementwise(1.0/nrm);
+        x = Kx;
+        xptr = x.getvalues();
+        
+        if (it > 0 && std::abs(lambda-prevlambda) <= tol*std::abs(lambda))
+            break;
+        prevlambda = lambda;
+    }
+    
+    return lambda;
+}
+
+void centraldifference::next(double timestep)
+{
+    if (timestep < 0)
+    {
+        dt = mysafetyfactor*getcriticaltimestep();
+        if (dt <= 0)
+        {
+            std::cout << "Error in 'centraldifference' object: could not estimate the critical timestep" << std::endl;
+            abort();
+        }
+    }
+    else
+        dt = timestep;
+    
+    double inittime = universe::currenttimestep;
+    
+    if (myverbosity > 1)
+        std::cout << "@" << inittime+dt << "s " << std::flush;
+    
+    // Get the data from all fields to create the u vector:
+    vec u(myformulation);
+    u.setdata();
+    
+    // Initial acceleration:
+    if (isaccelerationdefined == false)
+    {
+        universe::xdtxdtdtx = {{},{v},{}};
+        assemble();
+        a = vec(myformulation);
+        a.setvalues(ainds, getacceleration(u, v));
+        isaccelerationdefined = true;
+    }
+    
+    // Speed at mid-step and displacement at the next timestep:
+    vec vhalf = v + (0.5*dt)*a;
+    vec unext = u + dt*vhalf;
+    
+    universe::currenttimestep = inittime+dt;
+    universe::xdtxdtdtx = {{},{vhalf},{a}};
+    
+    // Only the rhs is reassembled when all matrices are constant:
+    assemble();
+    
+    // Impose the Dirichlet constraints on the displacement. The speed on the constrained dofs is set accordingly:
+    densematrix vd;
+    if (dinds.count() > 0)
+    {
+        densematrix ud = u.getvalues(dinds);
+        vd = rhs.getvalues(dinds);
+        unext.setvalues(dinds, vd);
+        vd.subtract(ud);
+        vd.multiplyelementwise(1.0/dt);
+        vhalf.setvalues(dinds, vd);
+    }
+    
+    vec anext(myformulation);
+    anext.setvalues(ainds, getacceleration(unext, vhalf));
+    
+    vec vnext = vhalf + (0.5*dt)*anext;
+    if (dinds.count() > 0)
+        vnext.setvalues(dinds, vd);
+    
+    sl::setdata(unext);
+    
+    v = vnext; a = anext;
+    universe::xdtxdtdtx = {{},{v},{a}};
+    
+    if (myverbosity == 1)
+        std::cout << "@" << universe::currenttimestep << "s " << std::flush;
+    
+    mytimes.push_back(universe::currenttimestep);
+}
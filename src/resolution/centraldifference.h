@@ -0,0 +1,119 @@
+// sparselizard - Copyright (C) see copyright file.
+//
+// See the LICENSE file for license information. Please report all
+// bugs and problems to <alexandre.halbach at gmail.com>.
+
+// This object implements the explicit central difference method to solve in time the linear problem
+//
+// M*dtdtx + C*dtx + K*x = b 
+//
+// with a lumped (diagonal) mass matrix. No linear system is solved: every timestep only requires the
+// rhs to be reassembled and a few matrix-vector products. The damping term is evaluated at mid-step.
+// The method is conditionally stable, the critical timestep can be estimated with 'getcriticaltimestep'.
+//
+// Two mass lumping techniques are available:
+//
+// - "rowsum" sums each row of the mass matrix on the diagonal. This is only suited for order 1 shape functions.
+// - "scaleddiagonal" scales the diagonal of the mass matrix with one factor per field (and harmonic) that preserves
+//   the total mass of that field. The diagonal is always positive. The total mass is that of a unit field: it uses the
+//   vertex dofs only for fields with vertex form functions (which sum to one) and all dofs of the field otherwise.
+//   Unlike the HRZ lumping the scaling is not done per element: the element mass matrices are not available once assembled.
+
+#ifndef CENTRALDIFFERENCE_H
+#define CENTRALDIFFERENCE_H
+
+#include <iostream>
+#include <vector>
+#include "vec.h"
+#include "universe.h"
+#include "sl.h"
+#include "formulation.h"
+
+class centraldifference
+{
+    private:
+        
+        int myverbosity = 1;
+        
+        formulation myformulation;
+        
+        std::string mylumping = "rowsum";
+        
+        // Set 'isconstant[i]' to true and the corresponding matrix/vector is 
+        // supposed constant in time and will only be generated once then reused.
+        //
+        // - i = 0 corresponds to the rhs vector
+        // - i = 1 corresponds to the K matrix
+        // - i = 2 corresponds to the C matrix
+        // - i = 3 corresponds to the M matrix
+        //
+        // Note: even if the rhs vector can be reused the Dirichlet
+        // constraints will nevertheless be recomputed at each time step.
+        //
+        std::vector<bool> isconstant = {false, true, true, true};
+        
+        // Fraction of the critical timestep used when the timestep is automatically set:
+        double mysafetyfactor = 0.9;
+        
+        // Current timestep:
+        double dt = -1;
+        // All time values stepped-through:
+        std::vector<double> mytimes = {};
+        
+        // The speed v and acceleration a at the current time step:
+        vec v, a;
+        bool isaccelerationdefined = false;
+        
+        // Objects required at every timestep (possibly reused):
+        vec rhs; mat K, C, M;
+        // Inverse of the lumped mass on the unconstrained dofs:
+        densematrix invlumpedmass;
+        intdensematrix ainds, dinds;
+        
+        // Critical timestep for the current K and M and estimation method used (-1 if not computed):
+        double mycriticaldt = -1;
+        std::string mycriticaldtmethod = "";
+        
+        // Generate the rhs and the non-constant matrices at the current time:
+        void assemble(void);
+        void lumpmass(void);
+        
+        // Get the acceleration on the unconstrained dofs:
+        densematrix getacceleration(vec u, vec speed);
+        
+        // Power iteration on inv(Ml)*K for its largest eigenvalue wmax^2 (0 if not found):
+        double getlargesteigenvalue(int maxnumit, double tol);
+        
+    public:
+    
+        centraldifference(formulation formul, vec initspeed, int verbosity = 3, std::string lumping = "rowsum", std::vector<bool> isrhskcmconstant = {false, true, true, true});
+    
+        void setverbosity(int verbosity) { myverbosity = verbosity; };
+        
+        // Fraction of the estimated critical timestep used when calling 'next' with a negative timestep:
+        void setsafetyfactor(double safetyfactor) { mysafetyfactor = safetyfactor; };
+        
+        // Get the speed and acceleration:
+        std::vector<vec> gettimederivative(void) { return {v, a}; };
+        // Set the speed and acceleration (if not set the initial acceleration is computed from the problem):
+        void settimederivative(std::vector<vec> sol);
+        
+        double gettimestep(void) { return dt; };
+        
+        // Get the critical timestep 2/wmax of the undamped lumped problem. With the "gershgorin" method wmax^2 is bounded
+        // by max_i sum_j |K_ij|/m_i so that the timestep returned is guaranteed stable (but possibly pessimistic).
+        // The "poweriteration" method gives a sharper estimate but since it approaches wmax from below the timestep
+        // returned can slightly exceed the critical one (use a safety factor):
+        double getcriticaltimestep(std::string method = "gershgorin", int maxnumit = 100, double tol = 1e-4);
+        
+        // Count the number of timesteps computed:
+        int count(void) { return mytimes.size(); };
+        std::vector<double> gettimes(void) { return mytimes; };
+        
+        // Advance the solution by the provided timestep. A negative timestep uses the
+        // critical timestep (Gershgorin bound) times the safety factor.
+        void next(double timestep);
+        
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "frequencysweep.h"
+
+
+frequencysweep::frequencysweep(formulation formul, double fmin, double fmax, int maxorder, int verbosity)
+{
+    myverbosity = verbosity;
+    
+    myformulation = formul;
+    if (myformulation.isdampingmatrixdefined() || myformulation.ismassmatrixdefined())
+    {
+        std::cout << "Error in 'frequencysweep' object: formulation provided cannot have a damping/mass matrix (use multiharmonic fields)" << std::endl;
+        abort();  
+    }
+    if (fmin <= 0 || fmax <= fmin)
+    {
+        std::cout << "Error in 'frequencysweep' object: expected 0 < fmin < fmax" << std::endl;
+        abort();
+    }
+    if (maxorder < 0)
+    {
+        std::cout << "Error in 'frequencysweep' object: expected a positive or zero max time derivative order" << std::endl;
+        abort();
+    }
+    
+    int numrefs = maxorder+1;
+    
+    wallclock clk;
+    
+    double pi = sl::getpi();
+    double initfreq = universe::fundamentalfrequency;
+    
+    mycentre = pi*(fmin+fmax);
+    myradius = pi*(fmax-fmin);
+    
+    // Assemble at all reference frequencies:
+    std::vector<double> refws(numrefs);
+    std::vector<mat> refmats(numrefs);
+    std::vector<vec> refvecs(numrefs);
+    for (int i = 0; i < numrefs; i++)
+    {
+        double f = fmin;
+        if (numrefs > 1)
+            f = fmin + i*(fmax-fmin)/(numrefs-1);
+        refws[i] = 2.0*pi*f;
+        
+        universe::fundamentalfrequency = f;
+        myformulation.generate();
+        refmats[i] = myformulation.A();
+        refvecs[i] = myformulation.b();
+    }
+    universe::fundamentalfrequency = initfreq;
+    
+    // Invert the Vandermonde matrix V with V(i,k) = s_i^k. Since all s_i are in [-1,1] it is well conditioned:
+    densematrix V(numrefs, numrefs);
+    double* Vptr = V.getvalues();
+    for (int i = 0; i < numrefs; i++)
+    {
+        double si = getscaled(refws[i]);
+        double sik = 1.0;
+        for (int k = 0; k < numrefs; k++)
+        {
+            Vptr[i*numrefs+k] = sik;
+            sik *= si;
+        }
+    }
+    densematrix invV = V.getinverse();
+    double* invVptr = invV.getvalues();
+    
+    // Polynomial term k is sum_i invV(k,i) * ref_i:
+    mypolymats = std::vector<mat>(numrefs);
+    mypolyvecs = std::vector<vec>(numrefs);
+    for (int k = 0; k < numrefs; k++)
+    {
+        mypolymats[k] = invVptr[k*numrefs+0]*refmats[0];
+        mypolyvecs[k] = invVptr[k*numrefs+0]*refvecs[0];
+        for (int i = 1; i < numrefs; i++)
+        {
+            mypolymats[k] = mypolymats[k] + invVptr[k*numrefs+i]*refmats[i];
+            mypolyvecs[k] = mypolyvecs[k] + invVptr[k*numrefs+i]*refvecs[i];
+        }
+    }
+    
+    // The union of all nonzero patterns:
+    mysweepmat = mypolymats[0].copy();
+    for (int k = 1; k < numrefs; k++)
+        mysweepmat = mysweepmat + mypolymats[k];
+    // The values change in place but the pattern is fixed:
+    mysweepmat.reusefactorization();
+    
+    if (myverbosity > 0)
+        clk.print("Frequency sweep assembly ("+std::to_string(numrefs)+" reference frequencies) took");
+}
+
+void frequencysweep::updatesweepmatrix(double w)
+{
+    double s = getscaled(w);
+    
+    std::vector<double> coefs(mypolymats.size());
+    double sk = 1.0;
+    for (int k = 0; k < mypolymats.size(); k++)
+    {
+        coefs[k] = sk;
+        sk *= s;
+    }
+    mysweepmat.setlinearcombination(coefs, mypolymats);
+}
+
+mat frequencysweep::getmatrix(double f)
+{
+    double s = getscaled(2.0*sl::getpi()*f);
+    
+    mat output = mypolymats[0].copy();
+    double sk = s;
+    for (int k = 1; k < mypolymats.size(); k++)
+    {
+        output = output + sk*mypolymats[k];
+        sk *= s;
+    }
+    return output;
+}
+
+vec frequencysweep::getrhs(double f)
+{
+    double s = getscaled(2.0*sl::getpi()*f);
+    
+    vec output = mypolyvecs[0].copy();
+    double sk = s;
+    for (int k = 1; k < mypolyvecs.size(); k++)
+    {
+        output = output + sk*mypolyvecs[k];
+        sk *= s;
+    }
+    return output;
+}
+
+std::vector<vec> frequencysweep::run(std::vector<double> frequencies, bool distributeonranks)
+{
+    int rank = 0, numranks = 1;
+    if (distributeonranks)
+    {
+        rank = slmpi::getrank();
+        numranks = slmpi::count();
+    }
+    
+    double initfreq = universe::fundamentalfrequency;
+
+    std::vector<vec> sols(frequencies.size());
+    for (int i = rank; i < frequencies.size(); i += numranks)
+    {
+        double f = frequencies[i];
+        if (f <= 0)
+        {
+            std::cout << "Error in 'frequencysweep' object: frequencies must be positive" << std::endl;
+            abort();
+        }
+        
+        if (myverbosity > 1)
+            std::cout << "@" << f << "Hz " << std::flush;
+        
+        universe::fundamentalfrequency = f;
+        
+        // Only the numerical factorization is redone since the nonzero pattern is unchanged:
+        updatesweepmatrix(2.0*sl::getpi()*f);
+        sols[i] = sl::solve(mysweepmat, getrhs(f));
+    }
+    
+    universe::fundamentalfrequency = initfreq;
+    
+    if (myverbosity > 1)
+        std::cout << std::endl;
+    
+    return sols;
+}
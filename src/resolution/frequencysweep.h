@@ -0,0 +1,74 @@
+// sparselizard - Copyright (C) see copyright file.
+//
+// See the LICENSE file for license information. Please report all
+// bugs and problems to <alexandre.halbach at gmail.com>.
+
+// This object solves a linear multiharmonic formulation at many fundamental frequencies.
+// The time derivatives bring a polynomial dependency in w = 2*pi*f to the assembled problem:
+//
+// A(w) = A0 + s*A1 + s^2*A2 + ...    and    b(w) = b0 + s*b1 + s^2*b2 + ...
+//
+// with s = (w-wc)/wr the angular frequency centred and scaled to [-1,1] on the sweep interval.
+// Using s rather than w keeps the interpolation well conditioned even at high frequencies.
+// The polynomial terms are obtained once from a few assemblies at reference frequencies.
+// The system at every sweep frequency is then formed by an in-place update of the matrix
+// values on the union of all nonzero patterns so that the symbolic factorization is reused.
+
+#ifndef FREQUENCYSWEEP_H
+#define FREQUENCYSWEEP_H
+
+#include <iostream>
+#include <vector>
+#include "vec.h"
+#include "mat.h"
+#include "universe.h"
+#include "sl.h"
+#include "slmpi.h"
+#include "wallclock.h"
+#include "formulation.h"
+
+class frequencysweep
+{
+    private:
+        
+        int myverbosity = 1;
+        
+        formulation myformulation;
+        
+        // Centre and half width of the angular frequency interval:
+        double mycentre = 0, myradius = 1;
+        
+        // Polynomial terms of A(w) and b(w) in the scaled variable s:
+        std::vector<mat> mypolymats = {};
+        std::vector<vec> mypolyvecs = {};
+        
+        // Matrix whose values are updated in place to A(w) at every frequency:
+        mat mysweepmat;
+        
+        // Get the scaled variable s at angular frequency w:
+        double getscaled(double w) { return (w-mycentre)/myradius; };
+        
+        // Update 'mysweepmat' to A(w):
+        void updatesweepmatrix(double w);
+        
+    public:
+        
+        // The formulation is assembled at 'maxorder'+1 reference frequencies equally spaced between 'fmin' and 'fmax'.
+        // The maximum time derivative order in the formulation should not exceed 'maxorder'.
+        frequencysweep(formulation formul, double fmin, double fmax, int maxorder = 2, int verbosity = 1);
+        
+        void setverbosity(int verbosity) { myverbosity = verbosity; };
+        
+        // Get the matrix and the rhs at a given fundamental frequency:
+        mat getmatrix(double f);
+        vec getrhs(double f);
+        
+        // Solve at all frequencies and return the solutions. When 'distributeonranks' is true each MPI rank
+        // only solves its share of the frequencies (round-robin) and the other solutions are left undefined.
+        // The frequencies of a rank are solved one after the other: the PETSc objects and the MUMPS solver
+        // are not thread-safe in a default PETSc build, so the solves cannot be spread over the thread pool.
+        std::vector<vec> run(std::vector<double> frequencies, bool distributeonranks = false);
+        
+};
+
+#endif
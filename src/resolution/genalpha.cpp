@@ -72,6 +72,33 @@ void genalpha::setadaptivity(double tol, double mints, double maxts, double reff
     mindt = mints; maxdt = maxts; tatol = tol; rfact = reffact; cfact = coarfact; cthres = coarthres;
 }
 
+void genalpha::setacceleration(int depth)
+{
+    if (depth < 0)
+    {
+        std::cout << "Error in 'genalpha' object: the acceleration depth cannot be negative" << std::endl;
+        abort();
+    }
+    andersondepth = depth;
+}
+
+void genalpha::setnewton(std::vector<field> unknowns, std::vector<integration> residual)
+{
+    if (tangentblock != -1)
+    {
+        std::cout << "Error in 'genalpha' object: the Newton iteration has already been set" << std::endl;
+        abort();
+    }
+    
+    int numblocks = myformulation.countcontributionnumbers();
+    formulationblocks = std::vector<int>(numblocks);
+    for (int i = 0; i < numblocks; i++)
+        formulationblocks[i] = i;
+    
+    tangentblock = numblocks;
+    myformulation += newtonraphson::gettangent(unknowns, residual, tangentblock);
+}
+
 void genalpha::presolve(std::vector<formulation> formuls) { tosolvebefore = formuls; }
 void genalpha::postsolve(std::vector<formulation> formuls) { tosolveafter = formuls; }
         
@@ -93,6 +120,12 @@ int genalpha::run(bool islinear, double timestep, int maxnumnlit)
         abort();
     }
 
+    if (tangentblock != -1 && andersondepth > 0)
+    {
+        std::cout << "Error in 'genalpha' object: the Anderson acceleration cannot be combined with the Newton iteration" << std::endl;
+        abort();
+    }
+
     double inittime = universe::currenttimestep;
 
     // Adaptive timestep:
@@ -142,6 +175,7 @@ int genalpha::run(bool islinear, double timestep, int maxnumnlit)
         // Nonlinear loop:
         double relchange = 1; nlit = 0;
         unext = u; vnext = v; anext = a;
+        andersonacceleration accelerator(andersondepth);
         while (relchange > nltol && (maxnumnlit <= 0 || nlit < maxnumnlit))
         {
             double t = inittime+dt;
@@ -156,9 +190,13 @@ int genalpha::run(bool islinear, double timestep, int maxnumnlit)
             bool isfirstcall = not(K.isdefined());
             
             universe::currenttimestep = t-alphaf*dt;
+            // The tangent terms (if any) are left out:
             if (isconstant[0] == false || isfirstcall)
             {
-                myformulation.generaterhs();
+                if (tangentblock == -1)
+                    myformulation.generaterhs();
+                else
+                    myformulation.generatein(0, formulationblocks);
                 rhs = myformulation.rhs(false, false);
             }
                 
@@ -168,17 +206,26 @@ int genalpha::run(bool islinear, double timestep, int maxnumnlit)
                 
             if (isconstant[1] == false || isfirstcall)
             {
-                myformulation.generatestiffnessmatrix();
+                if (tangentblock == -1)
+                    myformulation.generatestiffnessmatrix();
+                else
+                    myformulation.generatein(1, formulationblocks);
                 K = myformulation.K(false);
             }
             if (isconstant[2] == false || isfirstcall)
             {
-                myformulation.generatedampingmatrix();
+                if (tangentblock == -1)
+                    myformulation.generatedampingmatrix();
+                else
+                    myformulation.generatein(2, formulationblocks);
                 C = myformulation.C(false);
             }
             if (isconstant[3] == false || isfirstcall)
             {
-                myformulation.generatemassmatrix();
+                if (tangentblock == -1)
+                    myformulation.generatemassmatrix();
+                else
+                    myformulation.generatein(3, formulationblocks);
                 M = myformulation.M(false);
             }
             
@@ -206,7 +253,21 @@ int genalpha::run(bool islinear, double timestep, int maxnumnlit)
             // Force the acceleration on the constrained dofs:
             rightvec.getpointer()->setvalues(constraintindexes, anextdirichletval);
             
-            anext = sl::solve(leftmat, rightvec);
+            if (tangentblock != -1)
+            {
+                // Newton step with the tangent of the residual terms (the displacement changes by beta*dt^2 times the acceleration):
+                myformulation.generatein(1, {tangentblock});
+                mat tangent = myformulation.K(false);
+                anext = anext + sl::solve(leftmat + (beta*dt*dt)*tangent, rightvec - leftmat*anext);
+                anext.getpointer()->setvalues(constraintindexes, anextdirichletval);
+            }
+            else if (andersondepth == 0)
+                anext = sl::solve(leftmat, rightvec);
+            else
+            {
+                anext = accelerator.next(anext, sl::solve(leftmat, rightvec));
+                anext.getpointer()->setvalues(constraintindexes, anextdirichletval);
+            }
 
             // Update unext and vnext:
             unext = u + dt*v + ((0.5-beta)*dt*dt)*a + (beta*dt*dt)*anext;
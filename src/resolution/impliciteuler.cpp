@@ -57,6 +57,33 @@ void impliciteuler::setadaptivity(double tol, double mints, double maxts, double
     mindt = mints; maxdt = maxts; tatol = tol; rfact = reffact; cfact = coarfact; cthres = coarthres;
 }
 
+void impliciteuler::setacceleration(int depth)
+{
+    if (depth < 0)
+    {
+        std::cout << "Error in 'impliciteuler' object: the acceleration depth cannot be negative" << std::endl;
+        abort();
+    }
+    andersondepth = depth;
+}
+
+void impliciteuler::setnewton(std::vector<field> unknowns, std::vector<integration> residual)
+{
+    if (tangentblock != -1)
+    {
+        std::cout << "Error in 'impliciteuler' object: the Newton iteration has already been set" << std::endl;
+        abort();
+    }
+    
+    int numblocks = myformulation.countcontributionnumbers();
+    formulationblocks = std::vector<int>(numblocks);
+    for (int i = 0; i < numblocks; i++)
+        formulationblocks[i] = i;
+    
+    tangentblock = numblocks;
+    myformulation += newtonraphson::gettangent(unknowns, residual, tangentblock);
+}
+
 void impliciteuler::presolve(std::vector<formulation> formuls) { tosolvebefore = formuls; }
 void impliciteuler::postsolve(std::vector<formulation> formuls) { tosolveafter = formuls; }
 
@@ -78,6 +105,12 @@ int impliciteuler::run(bool islinear, double timestep, int maxnumnlit)
         abort();
     }
 
+    if (tangentblock != -1 && andersondepth > 0)
+    {
+        std::cout << "Error in 'impliciteuler' object: the Anderson acceleration cannot be combined with the Newton iteration" << std::endl;
+        abort();
+    }
+
     double inittime = universe::currenttimestep;
 
     // Adaptive timestep:
@@ -129,6 +162,7 @@ int impliciteuler::run(bool islinear, double timestep, int maxnumnlit)
         // Nonlinear loop:
         double relchange = 1; nlit = 0;
         xnext = x; dtxnext = dtx;
+        andersonacceleration accelerator(andersondepth, relaxationfactor);
         while (relchange > nltol && (maxnumnlit <= 0 || nlit < maxnumnlit))
         {
             // Solve all formulations that must be solved at the beginning of the nonlinear loop:
@@ -138,21 +172,31 @@ int impliciteuler::run(bool islinear, double timestep, int maxnumnlit)
             
             // Reassemble only the non-constant matrices:
             bool isfirstcall = not(K.isdefined());
+            // The tangent terms (if any) are left out:
             if (isconstant[0] == false || isfirstcall)
             {
-                myformulation.generaterhs();
+                if (tangentblock == -1)
+                    myformulation.generaterhs();
+                else
+                    myformulation.generatein(0, formulationblocks);
                 rhs = myformulation.rhs();
             }
             else
                 rhs.updateconstraints();
             if (isconstant[1] == false || isfirstcall)
             {
-                myformulation.generatestiffnessmatrix();
+                if (tangentblock == -1)
+                    myformulation.generatestiffnessmatrix();
+                else
+                    myformulation.generatein(1, formulationblocks);
                 K = myformulation.K(false);
             }
             if (isconstant[2] == false || isfirstcall)
             {
-                myformulation.generatedampingmatrix();
+                if (tangentblock == -1)
+                    myformulation.generatedampingmatrix();
+                else
+                    myformulation.generatein(2, formulationblocks);
                 C = myformulation.C(false);
             }
             
@@ -173,7 +217,22 @@ int impliciteuler::run(bool islinear, double timestep, int maxnumnlit)
             rightvec.getpointer()->setvalues(constraintindexes, xnextdirichletval);
             
             // Update the solution xnext.
-            xnext = relaxationfactor * sl::solve(leftmat, rightvec) + (1.0-relaxationfactor)*xnext;
+            if (tangentblock != -1)
+            {
+                // Newton step with the tangent of the residual terms:
+                myformulation.generatein(1, {tangentblock});
+                mat tangent = myformulation.K(false);
+                vec step = sl::solve(leftmat + dt*tangent, rightvec - leftmat*xnext);
+                xnext = xnext + relaxationfactor*step;
+                xnext.getpointer()->setvalues(constraintindexes, xnextdirichletval);
+            }
+            else if (andersondepth == 0)
+                xnext = relaxationfactor * sl::solve(leftmat, rightvec) + (1.0-relaxationfactor)*xnext;
+            else
+            {
+                xnext = accelerator.next(xnext, sl::solve(leftmat, rightvec));
+                xnext.getpointer()->setvalues(constraintindexes, xnextdirichletval);
+            }
             
             dtxnext = 1.0/dt*(xnext-x);
             
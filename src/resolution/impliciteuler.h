@@ -18,6 +18,8 @@
 #include "universe.h"
 #include "sl.h"
 #include "formulation.h"
+#include "andersonacceleration.h"
+#include "newtonraphson.h"
 
 class impliciteuler
 {
@@ -33,6 +35,14 @@ class impliciteuler
         // The relaxation factor for the nonlinear iteration:
         double relaxationfactor = 1.0;
         
+        // Number of previous iterates used by the Anderson acceleration of the nonlinear iteration (0 for none):
+        int andersondepth = 0;
+        
+        // Contribution number of the tangent terms added for the Newton iteration (-1 for the fixed-point iteration)
+        // and contribution numbers of the formulation provided (all other matrix and rhs terms):
+        int tangentblock = -1;
+        std::vector<int> formulationblocks = {};
+        
         // Set 'isconstant[i]' to true and the corresponding matrix/vector is 
         // supposed constant in time and will only be generated once then reused.
         //
@@ -79,6 +89,16 @@ class impliciteuler
         // Set the relaxation factor for the inner nonlinear fixed-point iteration:
         void setrelaxationfactor(double relaxfact) { relaxationfactor = relaxfact; };
         
+        // Accelerate the inner nonlinear fixed-point iteration with the Anderson method over the last 'depth' 
+        // iterates. The relaxation factor is used as mixing factor. Set 'depth' to 0 to disable the acceleration.
+        void setacceleration(int depth);
+        
+        // Use the Newton method instead of the fixed-point iteration for the inner nonlinear loop. 'residual' holds the integral terms 
+        // (with a tf but no dof) that depend nonlinearly on the 'unknowns'. These terms must also be part of the formulation provided.
+        // Their tangent is obtained by symbolic differentiation as in the 'newtonraphson' object. The time derivatives of the unknowns
+        // must be written with dofs in the formulation. This cannot be combined with the Anderson acceleration.
+        void setnewton(std::vector<field> unknowns, std::vector<integration> residual);
+        
         vec gettimederivative(void) { return dtx; };
         void settimederivative(vec sol);
         
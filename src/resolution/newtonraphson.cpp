@@ -0,0 +1,150 @@
+#include "newtonraphson.h"
+
+
+newtonraphson::newtonraphson(std::vector<field> unknowns, std::vector<integration> residual, int verbosity)
+{
+    myverbosity = verbosity;
+    
+    for (int i = 0; i < residual.size(); i++)
+    {
+        if (residual[i].isfftrequested())
+        {
+            std::cout << "Error in 'newtonraphson' object: multiharmonic residual terms are not supported" << std::endl;
+            abort();
+        }
+        
+        myformulation += residual[i];
+    }
+    myformulation += gettangent(unknowns, residual);
+}
+
+std::vector<integration> newtonraphson::gettangent(std::vector<field> unknowns, std::vector<integration> residual, int blocknumber)
+{
+    std::vector<integration> output = {};
+    
+    for (int i = 0; i < residual.size(); i++)
+    {
+        int curblock = blocknumber;
+        if (curblock < 0)
+            curblock = residual[i].getblocknumber();
+        
+        // Tangent term for every unknown field:
+        expression curresidual = residual[i].getexpression();
+        for (int u = 0; u < unknowns.size(); u++)
+        {
+            expression curtangent = curresidual.derivative(unknowns[u]);
+            if (curtangent.iszero())
+                continue;
+            
+            if (residual[i].ismeshdeformdefined())
+                output.push_back(integration(residual[i].getphysicalregion(), residual[i].getmeshdeform(), curtangent, residual[i].getintegrationorderdelta(), curblock));
+            else
+                output.push_back(integration(residual[i].getphysicalregion(), curtangent, residual[i].getintegrationorderdelta(), curblock));
+        }
+    }
+    
+    return output;
+}
+
+void newtonraphson::settangentreuse(int numit)
+{
+    if (numit < 1)
+    {
+        std::cout << "Error in 'newtonraphson' object: the tangent must be reused for at least one iteration" << std::endl;
+        abort();
+    }
+    tangentreuse = numit;
+}
+
+double newtonraphson::getresidualnorm(vec& rhs, intdensematrix& ainds)
+{
+    densematrix resvals = rhs.getvalues(ainds);
+    double* resvalsptr = resvals.getvalues();
+    
+    double resnorm = 0.0;
+    for (int i = 0; i < resvals.count(); i++)
+        resnorm += resvalsptr[i]*resvalsptr[i];
+        
+    return std::sqrt(resnorm);
+}
+
+int newtonraphson::run(int maxnumit)
+{
+    // Get the data from all fields to create the x vector:
+    vec x(myformulation);
+    x.setdata();
+    
+    myresiduals = {};
+    
+    mat K;
+    intdensematrix ainds, dinds;
+    
+    double relchange = 1; int nlit = 0;
+    while (relchange > nltol && (maxnumit <= 0 || nlit < maxnumit))
+    {
+        // Regenerate the tangent only when it is not reused:
+        if (nlit%tangentreuse == 0)
+        {
+            myformulation.generatestiffnessmatrix();
+            K = myformulation.K();
+            K.reusefactorization();
+            
+            ainds = K.getainds();
+            dinds = K.getdinds();
+        }
+        myformulation.generaterhs();
+        vec rhs = myformulation.rhs();
+        
+        double resnorm = getresidualnorm(rhs, ainds);
+        myresiduals.push_back(resnorm);
+        
+        // The rhs holds -R on the unconstrained dofs. The step must bring the constrained dofs to their value:
+        densematrix dval = rhs.getvalues(dinds);
+        densematrix xdval = x.getvalues(dinds);
+        double* dvalptr = dval.getvalues();
+        double* xdvalptr = xdval.getvalues();
+        for (int i = 0; i < dval.count(); i++)
+            dvalptr[i] -= xdvalptr[i];
+        rhs.setvalues(dinds, dval);
+        
+        vec step = sl::solve(K, rhs);
+        
+        // Backtracking line search:
+        double alpha = 1.0;
+        for (int lsit = 0; lsit < maxnumlsit; lsit++)
+        {
+            sl::setdata(x + alpha*step);
+            
+            myformulation.generaterhs();
+            vec trialrhs = myformulation.rhs();
+            
+            if (getresidualnorm(trialrhs, ainds) <= (1.0-1e-4*alpha)*resnorm)
+                break;
+            
+            alpha *= 0.5;
+        }
+        
+        x = x + alpha*step;
+        sl::setdata(x);
+        
+        double xnorm = x.norm();
+        relchange = alpha*step.norm();
+        if (xnorm > 0)
+            relchange /= xnorm;
+        
+        if (myverbosity > 1)
+        {
+            std::cout << "Newton iteration " << nlit << ": residual " << resnorm << ", relative change " << relchange;
+            if (alpha < 1.0)
+                std::cout << " (step " << alpha << ")";
+            std::cout << std::endl;
+        }
+        
+        nlit++;
+    }
+    
+    if (myverbosity > 0)
+        std::cout << "Newton-Raphson " << (relchange <= nltol ? "converged" : "stopped") << " after " << nlit << " iterations (relative change " << relchange << ")" << std::endl;
+    
+    return nlit;
+}
@@ -0,0 +1,82 @@
+// sparselizard - Copyright (C) see copyright file.
+//
+// See the LICENSE file for license information. Please report all
+// bugs and problems to <alexandre.halbach at gmail.com>.
+
+// This object implements the Newton-Raphson method to solve the nonlinear static problem
+//
+// R(x) = 0
+//
+// where the residual R is defined by integral terms that include a tf() but no dof(). The consistent 
+// tangent is obtained by symbolic differentiation of the residual with respect to the unknown fields 
+// (the mesh deformation, if any, is not differentiated). 
+//
+// A modified Newton iteration reusing the tangent and its factorization during several iterations 
+// is available, as well as a backtracking line search on the residual norm.
+
+#ifndef NEWTONRAPHSON_H
+#define NEWTONRAPHSON_H
+
+#include <iostream>
+#include <vector>
+#include "vec.h"
+#include "mat.h"
+#include "universe.h"
+#include "sl.h"
+#include "formulation.h"
+#include "integration.h"
+
+class newtonraphson
+{
+    private:
+        
+        int myverbosity = 1;
+        
+        // Residual terms (rhs) and their tangent (K matrix):
+        formulation myformulation;
+        
+        // The convergence tolerance on the relative solution increment:
+        double nltol = 1e-6;
+        
+        // The tangent is regenerated and refactorized every 'tangentreuse' iterations (1 for the full Newton method):
+        int tangentreuse = 1;
+        // Max number of step halvings in the line search (0 for no line search):
+        int maxnumlsit = 0;
+        
+        // Residual norm before every iteration:
+        std::vector<double> myresiduals = {};
+        
+        // Norm of the residual on the unconstrained dofs:
+        double getresidualnorm(vec& rhs, intdensematrix& ainds);
+        
+    public:
+        
+        newtonraphson(std::vector<field> unknowns, std::vector<integration> residual, int verbosity = 1);
+        
+        // Get the tangent terms of the residual with respect to the unknown fields. They are 
+        // added to contribution number 'blocknumber' (that of the residual term if negative):
+        static std::vector<integration> gettangent(std::vector<field> unknowns, std::vector<integration> residual, int blocknumber = -1);
+        
+        void setverbosity(int verbosity) { myverbosity = verbosity; };
+        
+        // Set the tolerance on the relative solution increment:
+        void settolerance(double tol) { nltol = tol; };
+        
+        // Reuse the tangent (and its factorization) for 'numit' iterations:
+        void settangentreuse(int numit);
+        
+        // Halve the Newton step until the residual norm decreases enough (at most 'maxnumhalvings' times):
+        void setlinesearch(int maxnumhalvings) { maxnumlsit = maxnumhalvings; };
+        
+        // Get the formulation holding the residual and the tangent:
+        formulation getformulation(void) { return myformulation; };
+        
+        std::vector<double> getresiduals(void) { return myresiduals; };
+        
+        // Iterate from the current field values until convergence (or until 'maxnumit' if positive).
+        // The fields hold the solution at the end and the number of iterations is returned.
+        int run(int maxnumit = 50);
+        
+};
+
+#endif
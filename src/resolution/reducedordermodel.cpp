@@ -0,0 +1,318 @@
+#include "reducedordermodel.h"
+
+
+reducedordermodel::reducedordermodel(std::vector<mat> mats, std::vector<vec> rhses, int verbosity)
+{
+    myverbosity = verbosity;
+    
+    if (mats.size() == 0 || mats.size() != rhses.size())
+    {
+        std::cout << "Error in 'reducedordermodel' object: expected the same nonzero number of matrices and rhs vectors" << std::endl;
+        abort();
+    }
+    
+    mymats = mats;
+    
+    ainds = mymats[0].getainds();
+    dinds = mymats[0].getdinds();
+    dirichletvals = rhses[0].getvalues(dinds);
+    
+    myeliminatedvecs = std::vector<vec>(rhses.size());
+    for (int i = 0; i < rhses.size(); i++)
+    {
+        if (mymats[i].getdinds().count() != dinds.count())
+        {
+            std::cout << "Error in 'reducedordermodel' object: all matrices must have the same Dirichlet constraints" << std::endl;
+            abort();
+        }
+        myeliminatedvecs[i] = mymats[i].eliminate(rhses[i]);
+    }
+}
+
+void reducedordermodel::errorifnobasis(void)
+{
+    if (mybasis.countrows() == 0)
+    {
+        std::cout << "Error in 'reducedordermodel' object: the reduced basis has not been computed (call 'computebasis')" << std::endl;
+        abort();
+    }
+}
+
+void reducedordermodel::errorifwronglength(std::vector<double>& thetas)
+{
+    if (thetas.size() != mymats.size())
+    {
+        std::cout << "Error in 'reducedordermodel' object: expected " << mymats.size() << " theta values (one per affine term)" << std::endl;
+        abort();
+    }
+}
+
+densematrix reducedordermodel::multiplybasis(mat A)
+{
+    int r = mybasis.countrows();
+    int na = mybasis.countcolumns();
+    
+    if (A.getainds().count() != na)
+    {
+        std::cout << "Error in 'reducedordermodel' object: matrix to project does not match the reduced basis" << std::endl;
+        abort();
+    }
+    
+    std::vector<densematrix> Wrows(r);
+    for (int k = 0; k < r; k++)
+    {
+        densematrix vk = mybasis.extractrows(k,k).getresized(na,1);
+        vec xa(na, intdensematrix(na, 1, 0, 1), vk);
+        densematrix Avk = (A*A.x0merge(xa)).getvalues(A.getainds());
+        Wrows[k] = Avk.getresized(1,na);
+    }
+    
+    return densematrix(Wrows);
+}
+
+void reducedordermodel::addsnapshot(vec snapshot)
+{
+    densematrix vals = snapshot.getvalues(ainds);
+    mysnapshots.push_back(vals.getresized(1, vals.count()));
+}
+
+int reducedordermodel::computebasis(double tol, int maxsize)
+{
+    int ns = mysnapshots.size();
+    int na = ainds.count();
+    
+    if (ns == 0)
+    {
+        std::cout << "Error in 'reducedordermodel' object: cannot compute a reduced basis without snapshots" << std::endl;
+        abort();
+    }
+    
+    wallclock clk;
+    
+    // Method of snapshots: eigendecomposition of the snapshot correlation matrix S*S^T:
+    densematrix S(mysnapshots);
+    densematrix St = S;
+    St.transpose();
+    densematrix corr = S.multiply(St);
+    
+    std::vector<double> eigenvalues, eigenvectors;
+    myalgorithm::eigensymmetric(ns, corr.getvalues(), eigenvalues, eigenvectors);
+    
+    // The singular values are the square roots of the eigenvalues. Since the correlation matrix squares them
+    // the singular values below about 1e-8 times the largest one are not resolved and are always dropped:
+    double reltol = std::max(tol, 1e-8);
+    
+    int numkept = 0;
+    double maxsingularvalue = std::sqrt(std::max(eigenvalues[0], 0.0));
+    for (int i = 0; i < ns; i++)
+    {
+        double singularvalue = std::sqrt(std::max(eigenvalues[i], 0.0));
+        if (singularvalue <= reltol*maxsingularvalue || singularvalue == 0 || (maxsize > 0 && numkept >= maxsize))
+            break;
+        numkept++;
+    }
+    
+    // Basis vector k is sum_i eigvec_k[i] * snapshot_i / singularvalue_k:
+    densematrix E(numkept, ns);
+    double* Eptr = E.getvalues();
+    for (int k = 0; k < numkept; k++)
+    {
+        double invsingularvalue = 1.0/std::sqrt(eigenvalues[k]);
+        for (int i = 0; i < ns; i++)
+            Eptr[k*ns+i] = invsingularvalue * eigenvectors[k*ns+i];
+    }
+    densematrix V = E.multiply(S);
+    
+    // The basis vectors obtained above are only orthonormal up to the accuracy of the eigendecomposition.
+    // They are reorthogonalized with two Gram-Schmidt passes and those that are numerically dependent are dropped:
+    double* Vptr = V.getvalues();
+    std::vector<double> orthovals(numkept*na);
+    int numortho = 0;
+    for (int k = 0; k < numkept; k++)
+    {
+        double* vk = orthovals.data() + numortho*na;
+        for (int d = 0; d < na; d++)
+            vk[d] = Vptr[k*na+d];
+        
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (int j = 0; j < numortho; j++)
+            {
+                double* vj = orthovals.data() + j*na;
+                double proj = 0;
+                for (int d = 0; d < na; d++)
+                    proj += vj[d]*vk[d];
+                for (int d = 0; d < na; d++)
+                    vk[d] -= proj*vj[d];
+            }
+        }
+        
+        double norm = 0;
+        for (int d = 0; d < na; d++)
+            norm += vk[d]*vk[d];
+        norm = std::sqrt(norm);
+        // The vector had unit norm before the orthogonalization:
+        if (norm < 1e-6)
+            continue;
+        for (int d = 0; d < na; d++)
+            vk[d] /= norm;
+        numortho++;
+    }
+    orthovals.resize(numortho*na);
+    numkept = numortho;
+    mybasis = densematrix(numkept, na, orthovals);
+    
+    // Project all terms:
+    int numterms = mymats.size();
+    std::vector<densematrix> W(numterms);
+    myreducedmats = std::vector<densematrix>(numterms);
+    myreducedvecs = std::vector<densematrix>(numterms);
+    for (int i = 0; i < numterms; i++)
+    {
+        W[i] = multiplybasis(mymats[i]);
+        densematrix Wt = W[i];
+        Wt.transpose();
+        myreducedmats[i] = mybasis.multiply(Wt);
+        myreducedvecs[i] = mybasis.multiply(myeliminatedvecs[i].getallvalues());
+    }
+    
+    // Offline terms of the residual norm:
+    myresmats = std::vector<densematrix>(numterms*numterms);
+    myresvecs = std::vector<densematrix>(numterms*numterms);
+    myrhsproducts = densematrix(numterms, numterms);
+    double* rhsproductsptr = myrhsproducts.getvalues();
+    for (int i = 0; i < numterms; i++)
+    {
+        densematrix bi = myeliminatedvecs[i].getallvalues();
+        for (int j = 0; j < numterms; j++)
+        {
+            densematrix Wjt = W[j];
+            Wjt.transpose();
+            densematrix bj = myeliminatedvecs[j].getallvalues();
+            
+            myresmats[i*numterms+j] = W[i].multiply(Wjt);
+            myresvecs[i*numterms+j] = W[i].multiply(bj);
+            rhsproductsptr[i*numterms+j] = bi.gettranspose().multiply(bj).getvalues()[0];
+        }
+    }
+    
+    if (myverbosity > 0)
+        clk.print("Reduced basis of size "+std::to_string(numkept)+" ("+std::to_string(ns)+" snapshots, "+std::to_string(na)+" dofs) computed in");
+    
+    return numkept;
+}
+
+densematrix reducedordermodel::project(mat A)
+{
+    errorifnobasis();
+    
+    // Row k of W is A*v_k:
+    densematrix W = multiplybasis(A);
+    W.transpose();
+    
+    // Entry (k,l) is v_k * A * v_l:
+    return mybasis.multiply(W);
+}
+
+densematrix reducedordermodel::project(vec b)
+{
+    errorifnobasis();
+    
+    return mybasis.multiply(b.getvalues(ainds));
+}
+
+densematrix reducedordermodel::solve(std::vector<double> thetas)
+{
+    errorifnobasis();
+    errorifwronglength(thetas);
+    
+    int r = mybasis.countrows();
+    
+    densematrix Kr(r, r, 0.0), br(r, 1, 0.0);
+    for (int i = 0; i < mymats.size(); i++)
+    {
+        Kr.addproduct(thetas[i], myreducedmats[i]);
+        br.addproduct(thetas[i], myreducedvecs[i]);
+    }
+    
+    densematrix y(r, 1);
+    myalgorithm::solvedense(r, Kr.getvalues(), br.getvalues(), y.getvalues());
+    
+    return y;
+}
+
+vec reducedordermodel::expand(densematrix y)
+{
+    errorifnobasis();
+    
+    if (y.count() != mybasis.countrows())
+    {
+        std::cout << "Error in 'reducedordermodel' object: expected " << mybasis.countrows() << " reduced coordinates" << std::endl;
+        abort();
+    }
+    
+    densematrix Vt = mybasis;
+    Vt.transpose();
+    densematrix xa = Vt.multiply(y.getresized(y.count(),1));
+    
+    vec output(std::shared_ptr<rawvec>(new rawvec(mymats[0].getpointer()->getdofmanager())));
+    output.setvalues(ainds, xa);
+    output.setvalues(dinds, dirichletvals);
+    
+    return output;
+}
+
+double reducedordermodel::getresidual(densematrix y, std::vector<double> thetas)
+{
+    errorifnobasis();
+    errorifwronglength(thetas);
+    
+    int r = mybasis.countrows();
+    int numterms = mymats.size();
+    
+    if (y.count() != r)
+    {
+        std::cout << "Error in 'reducedordermodel' object: expected " << r << " reduced coordinates" << std::endl;
+        abort();
+    }
+    
+    densematrix yc = y.getresized(r,1);
+    double* yptr = yc.getvalues();
+    double* rhsproductsptr = myrhsproducts.getvalues();
+    
+    // ||rhs - K*x||^2 = sum_ij theta_i*theta_j * (rhs_i^T*rhs_j - 2*y^T*W_i^T*rhs_j + y^T*W_i^T*W_j*y):
+    double normrhs2 = 0, normres2 = 0;
+    for (int i = 0; i < numterms; i++)
+    {
+        for (int j = 0; j < numterms; j++)
+        {
+            double thetaij = thetas[i]*thetas[j];
+            
+            double* wbptr = myresvecs[i*numterms+j].getvalues();
+            double* wwptr = myresmats[i*numterms+j].getvalues();
+            
+            double ywb = 0, ywwy = 0;
+            for (int k = 0; k < r; k++)
+            {
+                ywb += yptr[k]*wbptr[k];
+                
+                double wwy = 0;
+                for (int l = 0; l < r; l++)
+                    wwy += wwptr[k*r+l]*yptr[l];
+                ywwy += yptr[k]*wwy;
+            }
+            
+            normrhs2 += thetaij*rhsproductsptr[i*numterms+j];
+            normres2 += thetaij*(rhsproductsptr[i*numterms+j] - 2.0*ywb + ywwy);
+        }
+    }
+    
+    // The accumulated squared norm can be slightly negative due to roundoff:
+    double normrhs = std::sqrt(std::max(normrhs2, 0.0));
+    double normres = std::sqrt(std::max(normres2, 0.0));
+    
+    if (normrhs == 0)
+        return normres;
+    
+    return normres/normrhs;
+}
@@ -0,0 +1,99 @@
+// sparselizard - Copyright (C) see copyright file.
+//
+// See the LICENSE file for license information. Please report all
+// bugs and problems to <alexandre.halbach at gmail.com>.
+
+// This object builds a projection-based reduced order model for the affine problem
+//
+// K(p)*x = rhs(p)    with    K(p) = sum_i theta_i(p) * K_i    and    rhs(p) = sum_i theta_i(p) * rhs_i
+//
+// (a single term with theta = 1 is a non-parametric problem). Solution snapshots are collected, 
+// a proper orthogonal decomposition (POD) basis V is computed from the snapshots and every term
+// is projected to a small dense matrix V*K_i*V^T and vector V*rhs_i. The reduced problem is then
+// solved online without any sparse operation. The reduction is done on the unconstrained dofs, 
+// the Dirichlet constraint values are taken from the rhs vectors and must be the same in all terms.
+
+#ifndef REDUCEDORDERMODEL_H
+#define REDUCEDORDERMODEL_H
+
+#include <iostream>
+#include <vector>
+#include "vec.h"
+#include "mat.h"
+#include "densematrix.h"
+#include "intdensematrix.h"
+#include "myalgorithm.h"
+#include "wallclock.h"
+
+class reducedordermodel
+{
+    private:
+        
+        int myverbosity = 1;
+        
+        // Full order affine terms:
+        std::vector<mat> mymats = {};
+        // Eliminated rhs terms (rhs_i on the unconstrained dofs minus the Dirichlet contribution):
+        std::vector<vec> myeliminatedvecs = {};
+        
+        intdensematrix ainds, dinds;
+        // Dirichlet constraint values:
+        densematrix dirichletvals;
+        
+        // Unconstrained dof values of every snapshot (one per row once concatenated):
+        std::vector<densematrix> mysnapshots = {};
+        
+        // Orthonormal basis (one basis vector per row) on the unconstrained dofs:
+        densematrix mybasis;
+        
+        // Projected terms:
+        std::vector<densematrix> myreducedmats = {};
+        std::vector<densematrix> myreducedvecs = {};
+        
+        // Offline terms of the residual norm with W_i = K_i*V^T. Entry i*Q+j is W_i^T*W_j (size r x r) in 'myresmats',
+        // W_i^T*rhs_j (size r x 1) in 'myresvecs' and rhs_i^T*rhs_j is entry (i,j) of 'myrhsproducts' (size Q x Q):
+        std::vector<densematrix> myresmats = {};
+        std::vector<densematrix> myresvecs = {};
+        densematrix myrhsproducts;
+        
+        void errorifnobasis(void);
+        void errorifwronglength(std::vector<double>& thetas);
+        
+        // Row k is A*v_k on the unconstrained dofs:
+        densematrix multiplybasis(mat A);
+        
+    public:
+        
+        reducedordermodel(std::vector<mat> mats, std::vector<vec> rhses, int verbosity = 1);
+        
+        void setverbosity(int verbosity) { myverbosity = verbosity; };
+        
+        // Add a solution snapshot:
+        void addsnapshot(vec snapshot);
+        int countsnapshots(void) { return mysnapshots.size(); };
+        
+        // Compute the POD basis from the snapshots and project all terms. The modes whose singular value is
+        // lower than 'tol' times the largest one are dropped. At most 'maxsize' modes are kept if positive.
+        // The basis is reorthogonalized and the modes that are numerically dependent are dropped as well.
+        // The basis size is returned.
+        int computebasis(double tol = 1e-6, int maxsize = -1);
+        int countbasis(void) { return mybasis.countrows(); };
+        
+        // Project any other matrix/vector (e.g. a damping or mass matrix) on the basis:
+        densematrix project(mat A);
+        densematrix project(vec b);
+        
+        // Online resolution. The reduced coordinates (size of the basis x 1) are returned:
+        densematrix solve(std::vector<double> thetas = {1.0});
+        
+        // Get the full order vector corresponding to reduced coordinates:
+        vec expand(densematrix y);
+        
+        // A posteriori error estimate: relative residual norm ||rhs(p) - K(p)*x|| / ||rhs(p)|| of the expanded solution.
+        // It is evaluated from the offline terms at a cost independent of the number of dofs. Because the squared
+        // norm is accumulated relative residuals below about 1e-7 are not resolved (they are returned as such).
+        double getresidual(densematrix y, std::vector<double> thetas = {1.0});
+        
+};
+
+#endif
@@ -6,9 +6,14 @@
 #ifndef RESOLUTION_H
 #define RESOLUTION_H
 
+#include "affinedecomposition.h"
+#include "centraldifference.h"
 #include "eigenvalue.h"
+#include "frequencysweep.h"
 #include "genalpha.h"
 #include "impliciteuler.h"
+#include "newtonraphson.h"
+#include "reducedordermodel.h"
 
 class resolution
 {
@@ -0,0 +1,446 @@
+#include "sumfactorization.h"
+
+
+sumfactorization::sumfactorization(int elementtypenumber, std::vector<double>& evaluationcoordinates, densematrix formfunctionvalues)
+{
+    int elementdimension = -1;
+    if (elementtypenumber == 3)
+        elementdimension = 2;
+    if (elementtypenumber == 5)
+        elementdimension = 3;
+    if (elementdimension == -1)
+        return;
+
+    numformfunctions = formfunctionvalues.countrows();
+    numevaluationpoints = evaluationcoordinates.size()/3;
+
+    if (formfunctionvalues.countcolumns() != numevaluationpoints)
+    {
+        std::cout << "Error in 'sumfactorization' object: expected one form function value column per evaluation point" << std::endl;
+        abort();
+    }
+
+    isvalidflag = (setgrid(elementdimension, evaluationcoordinates) && setfactors(formfunctionvalues));
+}
+
+bool sumfactorization::setgrid(int elementdimension, std::vector<double>& evaluationcoordinates)
+{
+    if (numevaluationpoints == 0)
+        return false;
+
+    // Distinct sorted coordinates in each direction:
+    std::vector<std::vector<double>> coords1d(3);
+    for (int d = 0; d < 3; d++)
+    {
+        std::vector<double> curcoords(numevaluationpoints);
+        for (int i = 0; i < numevaluationpoints; i++)
+            curcoords[i] = evaluationcoordinates[3*i+d];
+        std::sort(curcoords.begin(), curcoords.end());
+
+        coords1d[d] = {curcoords[0]};
+        for (int i = 1; i < numevaluationpoints; i++)
+        {
+            if (curcoords[i]-coords1d[d].back() > 1e-10)
+                coords1d[d].push_back(curcoords[i]);
+        }
+        mynumpoints[d] = coords1d[d].size();
+    }
+    if (elementdimension == 2 && mynumpoints[2] != 1)
+        return false;
+
+    if (mynumpoints[0]*mynumpoints[1]*mynumpoints[2] != numevaluationpoints)
+        return false;
+
+    mygridtopoint = std::vector<int>(numevaluationpoints, -1);
+    for (int i = 0; i < numevaluationpoints; i++)
+    {
+        std::vector<int> pos(3);
+        for (int d = 0; d < 3; d++)
+        {
+            for (int j = 0; j < mynumpoints[d]; j++)
+            {
+                if (std::abs(evaluationcoordinates[3*i+d]-coords1d[d][j]) <= 1e-10)
+                {
+                    pos[d] = j;
+                    break;
+                }
+            }
+        }
+        int gridindex = (pos[0]*mynumpoints[1]+pos[1])*mynumpoints[2]+pos[2];
+
+        // Each grid point must be hit once:
+        if (mygridtopoint[gridindex] != -1)
+            return false;
+        mygridtopoint[gridindex] = i;
+    }
+
+    return true;
+}
+
+bool sumfactorization::setfactors(densematrix formfunctionvalues)
+{
+    int nx = mynumpoints[0], ny = mynumpoints[1], nz = mynumpoints[2];
+
+    double* ffvals = formfunctionvalues.getvalues();
+
+    double maxabsall = 0;
+    if (formfunctionvalues.count() > 0)
+        maxabsall = formfunctionvalues.maxabs();
+
+    // Distinct normalized 1D factors in each direction:
+    std::vector<std::vector<std::vector<double>>> distinctfactors(3);
+
+    myfactorindexes = std::vector<std::vector<int>>(3, std::vector<int>(numformfunctions));
+    myscalings = std::vector<double>(numformfunctions);
+
+    std::vector<double> gridvals(numevaluationpoints);
+    for (int ff = 0; ff < numformfunctions; ff++)
+    {
+        // Values on the grid and pivot:
+        int pivot = 0;
+        double maxabs = 0;
+        for (int g = 0; g < numevaluationpoints; g++)
+        {
+            gridvals[g] = ffvals[ff*numevaluationpoints + mygridtopoint[g]];
+            if (std::abs(gridvals[g]) > maxabs)
+            {
+                maxabs = std::abs(gridvals[g]);
+                pivot = g;
+            }
+        }
+        int px = pivot/(ny*nz), py = (pivot/nz)%ny, pz = pivot%nz;
+
+        // Fibers through the pivot (all ones for a zero form function):
+        std::vector<std::vector<double>> fibers = {std::vector<double>(nx,1), std::vector<double>(ny,1), std::vector<double>(nz,1)};
+        double scaling = 0;
+        if (maxabs > 0)
+        {
+            for (int i = 0; i < nx; i++)
+                fibers[0][i] = gridvals[(i*ny+py)*nz+pz];
+            for (int i = 0; i < ny; i++)
+                fibers[1][i] = gridvals[(px*ny+i)*nz+pz];
+            for (int i = 0; i < nz; i++)
+                fibers[2][i] = gridvals[(px*ny+py)*nz+i];
+
+            // Normalize each fiber to a max abs of 1 with its first largest entry positive:
+            double pivotproduct = 1;
+            std::vector<int> pivotpos = {px, py, pz};
+            for (int d = 0; d < 3; d++)
+            {
+                double largest = 0;
+                for (int i = 0; i < fibers[d].size(); i++)
+                {
+                    if (std::abs(fibers[d][i]) > std::abs(largest))
+                        largest = fibers[d][i];
+                }
+                for (int i = 0; i < fibers[d].size(); i++)
+                    fibers[d][i] /= largest;
+                pivotproduct *= fibers[d][pivotpos[d]];
+            }
+            scaling = gridvals[pivot]/pivotproduct;
+
+            // The form function must be the product of the fibers:
+            for (int i = 0; i < nx; i++)
+            {
+                for (int j = 0; j < ny; j++)
+                {
+                    for (int k = 0; k < nz; k++)
+                    {
+                        double err = scaling*fibers[0][i]*fibers[1][j]*fibers[2][k] - gridvals[(i*ny+j)*nz+k];
+                        if (std::abs(err) > 1e-10*maxabs + 1e-14*maxabsall)
+                            return false;
+                    }
+                }
+            }
+        }
+        myscalings[ff] = scaling;
+
+        // Reuse identical factors:
+        for (int d = 0; d < 3; d++)
+        {
+            int index = -1;
+            for (int f = 0; f < distinctfactors[d].size(); f++)
+            {
+                bool isidentical = true;
+                for (int i = 0; i < fibers[d].size(); i++)
+                {
+                    if (std::abs(distinctfactors[d][f][i]-fibers[d][i]) > 1e-10)
+                    {
+                        isidentical = false;
+                        break;
+                    }
+                }
+                if (isidentical)
+                {
+                    index = f;
+                    break;
+                }
+            }
+            if (index == -1)
+            {
+                index = distinctfactors[d].size();
+                distinctfactors[d].push_back(fibers[d]);
+            }
+            myfactorindexes[d][ff] = index;
+        }
+    }
+
+    myfactors = std::vector<densematrix>(3);
+    for (int d = 0; d < 3; d++)
+    {
+        int numfactors = distinctfactors[d].size();
+        // Make sure there is at least one factor:
+        if (numfactors == 0)
+        {
+            distinctfactors[d] = {std::vector<double>(mynumpoints[d],1)};
+            numfactors = 1;
+        }
+        myfactors[d] = densematrix(numfactors, mynumpoints[d]);
+        double* facvals = myfactors[d].getvalues();
+        for (int f = 0; f < numfactors; f++)
+        {
+            for (int i = 0; i < mynumpoints[d]; i++)
+                facvals[f*mynumpoints[d]+i] = distinctfactors[d][f][i];
+        }
+    }
+
+    return true;
+}
+
+densematrix sumfactorization::interpolate(densematrix coefs)
+{
+    int numelems = coefs.countrows();
+    int nx = mynumpoints[0], ny = mynumpoints[1], nz = mynumpoints[2];
+    int nux = myfactors[0].countrows(), nuy = myfactors[1].countrows(), nuz = myfactors[2].countrows();
+
+    double* X = myfactors[0].getvalues();
+    double* Y = myfactors[1].getvalues();
+    double* Z = myfactors[2].getvalues();
+
+    double* coefvals = coefs.getvalues();
+
+    densematrix output(numelems, numevaluationpoints);
+    double* outvals = output.getvalues();
+
+    std::vector<double> T(nux*nuy*nuz), U1(nux*nuy*nz), U2(nux*ny*nz), V(numevaluationpoints);
+    for (int e = 0; e < numelems; e++)
+    {
+        // Coefficients in the space of the 1D factors:
+        std::fill(T.begin(), T.end(), 0.0);
+        for (int ff = 0; ff < numformfunctions; ff++)
+            T[(myfactorindexes[0][ff]*nuy+myfactorindexes[1][ff])*nuz+myfactorindexes[2][ff]] += myscalings[ff]*coefvals[e*numformfunctions+ff];
+
+        // Phi direction:
+        std::fill(U1.begin(), U1.end(), 0.0);
+        for (int ab = 0; ab < nux*nuy; ab++)
+        {
+            for (int c = 0; c < nuz; c++)
+            {
+                double t = T[ab*nuz+c];
+                if (t == 0)
+                    continue;
+                for (int k = 0; k < nz; k++)
+                    U1[ab*nz+k] += t*Z[c*nz+k];
+            }
+        }
+        // Eta direction:
+        std::fill(U2.begin(), U2.end(), 0.0);
+        for (int a = 0; a < nux; a++)
+        {
+            for (int b = 0; b < nuy; b++)
+            {
+                for (int j = 0; j < ny; j++)
+                {
+                    double y = Y[b*ny+j];
+                    for (int k = 0; k < nz; k++)
+                        U2[(a*ny+j)*nz+k] += y*U1[(a*nuy+b)*nz+k];
+                }
+            }
+        }
+        // Ki direction:
+        std::fill(V.begin(), V.end(), 0.0);
+        for (int a = 0; a < nux; a++)
+        {
+            for (int i = 0; i < nx; i++)
+            {
+                double x = X[a*nx+i];
+                for (int jk = 0; jk < ny*nz; jk++)
+                    V[i*ny*nz+jk] += x*U2[a*ny*nz+jk];
+            }
+        }
+
+        for (int g = 0; g < numevaluationpoints; g++)
+            outvals[e*numevaluationpoints+mygridtopoint[g]] = V[g];
+    }
+
+    return output;
+}
+
+densematrix sumfactorization::integrate(densematrix vals)
+{
+    int numelems = vals.countrows();
+    int nx = mynumpoints[0], ny = mynumpoints[1], nz = mynumpoints[2];
+    int nux = myfactors[0].countrows(), nuy = myfactors[1].countrows(), nuz = myfactors[2].countrows();
+
+    double* X = myfactors[0].getvalues();
+    double* Y = myfactors[1].getvalues();
+    double* Z = myfactors[2].getvalues();
+
+    double* invals = vals.getvalues();
+
+    densematrix output(numelems, numformfunctions);
+    double* outvals = output.getvalues();
+
+    std::vector<double> T(nux*nuy*nuz), U1(nux*nuy*nz), U2(nux*ny*nz), V(numevaluationpoints);
+    for (int e = 0; e < numelems; e++)
+    {
+        for (int g = 0; g < numevaluationpoints; g++)
+            V[g] = invals[e*numevaluationpoints+mygridtopoint[g]];
+
+        // Ki direction:
+        std::fill(U2.begin(), U2.end(), 0.0);
+        for (int a = 0; a < nux; a++)
+        {
+            for (int i = 0; i < nx; i++)
+            {
+                double x = X[a*nx+i];
+                for (int jk = 0; jk < ny*nz; jk++)
+                    U2[a*ny*nz+jk] += x*V[i*ny*nz+jk];
+            }
+        }
+        // Eta direction:
+        std::fill(U1.begin(), U1.end(), 0.0);
+        for (int a = 0; a < nux; a++)
+        {
+            for (int b = 0; b < nuy; b++)
+            {
+                for (int j = 0; j < ny; j++)
+                {
+                    double y = Y[b*ny+j];
+                    for (int k = 0; k < nz; k++)
+                        U1[(a*nuy+b)*nz+k] += y*U2[(a*ny+j)*nz+k];
+                }
+            }
+        }
+        // Phi direction:
+        for (int ab = 0; ab < nux*nuy; ab++)
+        {
+            for (int c = 0; c < nuz; c++)
+            {
+                double t = 0;
+                for (int k = 0; k < nz; k++)
+                    t += Z[c*nz+k]*U1[ab*nz+k];
+                T[ab*nuz+c] = t;
+            }
+        }
+
+        for (int ff = 0; ff < numformfunctions; ff++)
+            outvals[e*numformfunctions+ff] = myscalings[ff]*T[(myfactorindexes[0][ff]*nuy+myfactorindexes[1][ff])*nuz+myfactorindexes[2][ff]];
+    }
+
+    return output;
+}
+
+densematrix sumfactorization::getelementmatrices(sumfactorization& tf, sumfactorization& dof, densematrix coefs)
+{
+    if (tf.mynumpoints != dof.mynumpoints || tf.mygridtopoint != dof.mygridtopoint)
+    {
+        std::cout << "Error in 'sumfactorization' object: tf and dof form functions must be evaluated on the same grid" << std::endl;
+        abort();
+    }
+
+    int numelems = coefs.countrows();
+    int ngp = tf.numevaluationpoints;
+    int nx = tf.mynumpoints[0], ny = tf.mynumpoints[1], nz = tf.mynumpoints[2];
+    int ntf = tf.numformfunctions, ndof = dof.numformfunctions;
+
+    // Products of the tf and dof 1D factors in each direction:
+    std::vector<int> numprods(3), numdoffactors(3);
+    std::vector<std::vector<double>> prods(3);
+    for (int d = 0; d < 3; d++)
+    {
+        int n = tf.mynumpoints[d];
+        int numtffactors = tf.myfactors[d].countrows();
+        numdoffactors[d] = dof.myfactors[d].countrows();
+        numprods[d] = numtffactors*numdoffactors[d];
+
+        double* tfvals = tf.myfactors[d].getvalues();
+        double* dofvals = dof.myfactors[d].getvalues();
+
+        prods[d] = std::vector<double>(numprods[d]*n);
+        for (int a = 0; a < numtffactors; a++)
+        {
+            for (int b = 0; b < numdoffactors[d]; b++)
+            {
+                for (int i = 0; i < n; i++)
+                    prods[d][(a*numdoffactors[d]+b)*n+i] = tfvals[a*n+i]*dofvals[b*n+i];
+            }
+        }
+    }
+    int npx = numprods[0], npy = numprods[1];
+
+    double* coefvals = coefs.getvalues();
+
+    densematrix output(ntf*ndof, numelems);
+    double* outvals = output.getvalues();
+
+    std::vector<double> C(ngp), G1(npx*ny*nz), G2(npx*npy*nz);
+    for (int e = 0; e < numelems; e++)
+    {
+        for (int g = 0; g < ngp; g++)
+            C[g] = coefvals[e*ngp+tf.mygridtopoint[g]];
+
+        // Ki direction:
+        std::fill(G1.begin(), G1.end(), 0.0);
+        for (int p = 0; p < npx; p++)
+        {
+            for (int i = 0; i < nx; i++)
+            {
+                double x = prods[0][p*nx+i];
+                for (int jk = 0; jk < ny*nz; jk++)
+                    G1[p*ny*nz+jk] += x*C[i*ny*nz+jk];
+            }
+        }
+        // Eta direction:
+        std::fill(G2.begin(), G2.end(), 0.0);
+        for (int p = 0; p < npx; p++)
+        {
+            for (int q = 0; q < npy; q++)
+            {
+                for (int j = 0; j < ny; j++)
+                {
+                    double y = prods[1][q*ny+j];
+                    for (int k = 0; k < nz; k++)
+                        G2[(p*npy+q)*nz+k] += y*G1[(p*ny+j)*nz+k];
+                }
+            }
+        }
+        // Phi direction for every tf and dof form function pair:
+        for (int i = 0; i < ntf; i++)
+        {
+            int tx = tf.myfactorindexes[0][i], ty = tf.myfactorindexes[1][i], tz = tf.myfactorindexes[2][i];
+            for (int j = 0; j < ndof; j++)
+            {
+                int p = tx*numdoffactors[0] + dof.myfactorindexes[0][j];
+                int q = ty*numdoffactors[1] + dof.myfactorindexes[1][j];
+                int r = tz*numdoffactors[2] + dof.myfactorindexes[2][j];
+
+                double val = 0;
+                for (int k = 0; k < nz; k++)
+                    val += prods[2][r*nz+k]*G2[(p*npy+q)*nz+k];
+
+                outvals[(i*ndof+j)*numelems+e] = tf.myscalings[i]*dof.myscalings[j]*val;
+            }
+        }
+    }
+
+    return output;
+}
+
+densematrix sumfactorization::applyelementmatrices(sumfactorization& tf, sumfactorization& dof, densematrix coefs, densematrix dofvals)
+{
+    densematrix vals = dof.interpolate(dofvals);
+    vals.multiplyelementwise(coefs);
+
+    return tf.integrate(vals);
+}
@@ -0,0 +1,78 @@
+// sparselizard - Copyright (C) see copyright file.
+//
+// See the LICENSE file for license information. Please report all
+// bugs and problems to <alexandre.halbach at gmail.com>.
+
+// This object provides sum-factorized kernels for quadrangles and hexahedra evaluated on a tensor
+// product grid of evaluation points (e.g. their Gauss points). Every H1 and Hcurl hierarchical form
+// function (and form function derivative or component) on these elements is a product of 1D functions
+// in ki, eta (and phi). The 1D factors are extracted from the form function values at the grid points
+// and the kernels below are applied dimension by dimension instead of looping on all grid points for
+// every form function. At order p on a hexahedron this reduces the cost of an element matrix from
+// O(p^9) to O(p^7) and that of an interpolation or integration from O(p^6) to O(p^4).
+//
+// If the evaluation points are not a grid or if a form function is not a product of 1D functions
+// the object is not valid and the usual dense products must be used.
+
+#ifndef SUMFACTORIZATION_H
+#define SUMFACTORIZATION_H
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "densematrix.h"
+
+class sumfactorization
+{
+    private:
+
+        bool isvalidflag = false;
+
+        int numformfunctions = 0;
+        int numevaluationpoints = 0;
+
+        // Number of grid points in each of the three directions (1 in the phi direction on quadrangles):
+        std::vector<int> mynumpoints = {1,1,1};
+        // Evaluation point number at every grid point (ki slowest, phi fastest):
+        std::vector<int> mygridtopoint = {};
+
+        // All distinct 1D factors in each direction. Row i holds the values of factor i at the 1D grid points:
+        std::vector<densematrix> myfactors = {};
+        // Factor index of every form function in each direction:
+        std::vector<std::vector<int>> myfactorindexes = {};
+        // Scaling of every form function:
+        std::vector<double> myscalings = {};
+
+        // Deduce the grid from the evaluation coordinates (returns false if not a grid):
+        bool setgrid(int elementdimension, std::vector<double>& evaluationcoordinates);
+        // Split every form function into 1D factors (returns false if not possible):
+        bool setfactors(densematrix formfunctionvalues);
+
+    public:
+
+        sumfactorization(void) {};
+        // 'formfunctionvalues' has one row per form function and one column per evaluation point:
+        sumfactorization(int elementtypenumber, std::vector<double>& evaluationcoordinates, densematrix formfunctionvalues);
+
+        bool isvalid(void) { return isvalidflag; };
+
+        int countformfunctions(void) { return numformfunctions; };
+
+        // Get the form function values times the coefficients (one row per element, one column per form function)
+        // at the evaluation points. The output has one row per element and one column per evaluation point:
+        densematrix interpolate(densematrix coefs);
+        // Transpose of 'interpolate'. Get for every element and form function the sum of the form function values
+        // times the input values (one row per element, one column per evaluation point). Output is elements x form functions.
+        densematrix integrate(densematrix vals);
+
+        // Get the element matrices sum_gp tf_i(gp) * dof_j(gp) * coefs(elem, gp) for all elements. The output has one
+        // column per element and row i*numdofformfunctions+j holds the entry for tf form function i and dof form function j.
+        static densematrix getelementmatrices(sumfactorization& tf, sumfactorization& dof, densematrix coefs);
+
+        // Matrix-free application of the element matrices above to the dof values (one row per element, one column per
+        // dof form function). The output has one row per element and one column per tf form function:
+        static densematrix applyelementmatrices(sumfactorization& tf, sumfactorization& dof, densematrix coefs, densematrix dofvals);
+};
+
+#endif
@@ -25,6 +25,8 @@ void slmpi::sum(int len, long long int* data) {}
 void slmpi::sum(int len, double* data) {}
 void slmpi::sum(std::vector<int>& data) {}
 void slmpi::sum(std::vector<double>& data) {}
+int slmpi::isum(int len, double* data) { return 0; }
+void slmpi::wait(int request) {}
 void slmpi::max(std::vector<int>& data) {}
 void slmpi::max(std::vector<double>& data) {}
 void slmpi::broadcast(int broadcaster, std::vector<int>& data) { errornompi(); }
@@ -47,6 +49,16 @@ void slmpi::exchange(std::vector<int> targetranks, std::vector<std::vector<int>>
 void slmpi::exchange(std::vector<int> targetranks, std::vector<std::vector<double>>& sends, std::vector<std::vector<double>>& receives) { errornompi(); }
 void slmpi::exchange(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<int*> sendbuffers, std::vector<int> receivelens, std::vector<int*> receivebuffers) { errornompi(); }
 void slmpi::exchange(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<double*> sendbuffers, std::vector<int> receivelens, std::vector<double*> receivebuffers) { errornompi(); }
+int slmpi::iexchange(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<int*> sendbuffers, std::vector<int> receivelens, std::vector<int*> receivebuffers) { errornompi(); abort(); }
+int slmpi::iexchange(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<double*> sendbuffers, std::vector<int> receivelens, std::vector<double*> receivebuffers) { errornompi(); abort(); }
+bool slmpi::test(int request) { return true; }
+int slmpi::createplan(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<double*> sendbuffers, std::vector<int> receivelens, std::vector<double*> receivebuffers) { errornompi(); abort(); }
+void slmpi::start(int plan) { errornompi(); }
+void slmpi::startreceives(int plan) { errornompi(); }
+void slmpi::startsend(int plan, int target) { errornompi(); }
+void slmpi::finish(int plan) { errornompi(); }
+bool slmpi::isfinished(int plan) { errornompi(); abort(); }
+void slmpi::destroyplan(int plan) { errornompi(); }
 std::vector<double> slmpi::ping(int messagesize, int verbosity) { errornompi(); abort(); }
 #endif
 
@@ -135,6 +147,68 @@ void slmpi::sum(std::vector<double>& data)
 }
 
 
+// Pending nonblocking requests (a request number is the index in this container):
+std::vector<std::vector<MPI_Request>> pendingrequests = {};
+std::vector<int> freerequestnumbers = {};
+
+int addrequest(std::vector<MPI_Request>& requests)
+{
+    if (freerequestnumbers.size() == 0)
+    {
+        pendingrequests.push_back(requests);
+        return pendingrequests.size()-1;
+    }
+    int requestnumber = freerequestnumbers.back();
+    freerequestnumbers.pop_back();
+    pendingrequests[requestnumber] = requests;
+    
+    return requestnumber;
+}
+
+int slmpi::isum(int len, double* data)
+{
+    std::vector<MPI_Request> requests(1);
+    MPI_Iallreduce(MPI_IN_PLACE, data, len, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD, &requests[0]);
+    
+    return addrequest(requests);
+}
+
+void errorifunknownrequest(int request)
+{
+    if (request < 0 || request >= pendingrequests.size() || pendingrequests[request].size() == 0)
+    {
+        std::cout << "Error in 'slmpi' namespace: unknown or already completed request " << request << std::endl;
+        abort();
+    }
+}
+
+void slmpi::wait(int request)
+{
+    errorifunknownrequest(request);
+    
+    MPI_Waitall(pendingrequests[request].size(), pendingrequests[request].data(), MPI_STATUSES_IGNORE);
+    
+    pendingrequests[request] = {};
+    freerequestnumbers.push_back(request);
+}
+
+bool slmpi::test(int request)
+{
+    errorifunknownrequest(request);
+    
+    int isdone;
+    MPI_Testall(pendingrequests[request].size(), pendingrequests[request].data(), &isdone, MPI_STATUSES_IGNORE);
+    
+    if (isdone)
+    {
+        pendingrequests[request] = {};
+        freerequestnumbers.push_back(request);
+    }
+    
+    return isdone;
+}
+
+
 void slmpi::max(std::vector<int>& data)
 {
     MPI_Allreduce(MPI_IN_PLACE, data.data(), data.size(), MPI_INT, MPI_MAX, MPI_COMM_WORLD);
@@ -375,44 +449,148 @@ void slmpi::exchange(std::vector<int> targetranks, std::vector<std::vector<doubl
     
 void slmpi::exchange(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<int*> sendbuffers, std::vector<int> receivelens, std::vector<int*> receivebuffers)
 {
-    int numtargets = targetranks.size();
-
-    if (numtargets == 0)
+    if (targetranks.size() == 0)
         return;
 
-    std::vector<MPI_Request> sendrequests(numtargets);
-    std::vector<MPI_Request> receiverequests(numtargets);
+    wait(iexchange(targetranks, sendlens, sendbuffers, receivelens, receivebuffers));
+}
+
+int slmpi::iexchange(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<int*> sendbuffers, std::vector<int> receivelens, std::vector<int*> receivebuffers)
+{
+    int numtargets = targetranks.size();
+
+    // Send requests first, then receive requests (one more null request so that a request is never empty):
+    std::vector<MPI_Request> requests(2*numtargets+1, MPI_REQUEST_NULL);
 
     for (int i = 0; i < numtargets; i++)
-        MPI_Isend(sendbuffers[i], sendlens[i], MPI_INT, targetranks[i], 0, MPI_COMM_WORLD, &sendrequests[i]);
+        MPI_Isend(sendbuffers[i], sendlens[i], MPI_INT, targetranks[i], 0, MPI_COMM_WORLD, &requests[i]);
 
     for (int i = 0; i < numtargets; i++)
-        MPI_Irecv(receivebuffers[i], receivelens[i], MPI_INT, targetranks[i], 0, MPI_COMM_WORLD, &receiverequests[i]);
+        MPI_Irecv(receivebuffers[i], receivelens[i], MPI_INT, targetranks[i], 0, MPI_COMM_WORLD, &requests[numtargets+i]);
 
-    MPI_Waitall(numtargets, &sendrequests[0], MPI_STATUSES_IGNORE);
-    MPI_Waitall(numtargets, &receiverequests[0], MPI_STATUSES_IGNORE);
+    return addrequest(requests);
 }
 
 void slmpi::exchange(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<double*> sendbuffers, std::vector<int> receivelens, std::vector<double*> receivebuffers)
+{
+    if (targetranks.size() == 0)
+        return;
+
+    wait(iexchange(targetranks, sendlens, sendbuffers, receivelens, receivebuffers));
+}
+
+int slmpi::iexchange(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<double*> sendbuffers, std::vector<int> receivelens, std::vector<double*> receivebuffers)
 {
     int numtargets = targetranks.size();
 
-    if (numtargets == 0)
-        return;
+    // Send requests first, then receive requests (one more null request so that a request is never empty):
+    std::vector<MPI_Request> requests(2*numtargets+1, MPI_REQUEST_NULL);
 
-    std::vector<MPI_Request> sendrequests(numtargets);
-    std::vector<MPI_Request> receiverequests(numtargets);
+    for (int i = 0; i < numtargets; i++)
+        MPI_Isend(sendbuffers[i], sendlens[i], MPI_DOUBLE, targetranks[i], 0, MPI_COMM_WORLD, &requests[i]);
 
     for (int i = 0; i < numtargets; i++)
-        MPI_Isend(sendbuffers[i], sendlens[i], MPI_DOUBLE, targetranks[i], 0, MPI_COMM_WORLD, &sendrequests[i]);
+        MPI_Irecv(receivebuffers[i], receivelens[i], MPI_DOUBLE, targetranks[i], 0, MPI_COMM_WORLD, &requests[numtargets+i]);
+
+    return addrequest(requests);
+}
+    
+
+// Persistent plans (a plan number is the index in this container). The last request of a plan is a null request:
+std::vector<std::vector<MPI_Request>> plans = {};
+std::vector<int> freeplannumbers = {};
+
+void errorifunknownplan(int plan)
+{
+    if (plan < 0 || plan >= plans.size() || plans[plan].size() == 0)
+    {
+        std::cout << "Error in 'slmpi' namespace: unknown or destroyed plan " << plan << std::endl;
+        abort();
+    }
+}
+
+int slmpi::createplan(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<double*> sendbuffers, std::vector<int> receivelens, std::vector<double*> receivebuffers)
+{
+    int numtargets = targetranks.size();
+    
+    std::vector<MPI_Request> requests(2*numtargets+1, MPI_REQUEST_NULL);
 
     for (int i = 0; i < numtargets; i++)
-        MPI_Irecv(receivebuffers[i], receivelens[i], MPI_DOUBLE, targetranks[i], 0, MPI_COMM_WORLD, &receiverequests[i]);
+        MPI_Send_init(sendbuffers[i], sendlens[i], MPI_DOUBLE, targetranks[i], 0, MPI_COMM_WORLD, &requests[i]);
+    for (int i = 0; i < numtargets; i++)
+        MPI_Recv_init(receivebuffers[i], receivelens[i], MPI_DOUBLE, targetranks[i], 0, MPI_COMM_WORLD, &requests[numtargets+i]);
+    
+    if (freeplannumbers.size() == 0)
+    {
+        plans.push_back(requests);
+        return plans.size()-1;
+    }
+    int plannumber = freeplannumbers.back();
+    freeplannumbers.pop_back();
+    plans[plannumber] = requests;
+    
+    return plannumber;
+}
 
-    MPI_Waitall(numtargets, &sendrequests[0], MPI_STATUSES_IGNORE);
-    MPI_Waitall(numtargets, &receiverequests[0], MPI_STATUSES_IGNORE);
+void slmpi::start(int plan)
+{
+    errorifunknownplan(plan);
+    
+    if (plans[plan].size() > 1)
+        MPI_Startall(plans[plan].size()-1, plans[plan].data());
+}
+
+void slmpi::startreceives(int plan)
+{
+    errorifunknownplan(plan);
+    
+    int numtargets = (plans[plan].size()-1)/2;
+    if (numtargets > 0)
+        MPI_Startall(numtargets, plans[plan].data()+numtargets);
+}
+
+void slmpi::startsend(int plan, int target)
+{
+    errorifunknownplan(plan);
+    
+    int numtargets = (plans[plan].size()-1)/2;
+    if (target < 0 || target >= numtargets)
+    {
+        std::cout << "Error in 'slmpi' namespace: plan " << plan << " has no target " << target << std::endl;
+        abort();
+    }
+    MPI_Start(&plans[plan][target]);
+}
+
+void slmpi::finish(int plan)
+{
+    errorifunknownplan(plan);
+    
+    if (plans[plan].size() > 1)
+        MPI_Waitall(plans[plan].size()-1, plans[plan].data(), MPI_STATUSES_IGNORE);
+}
+
+bool slmpi::isfinished(int plan)
+{
+    errorifunknownplan(plan);
+    
+    int isdone = 1;
+    if (plans[plan].size() > 1)
+        MPI_Testall(plans[plan].size()-1, plans[plan].data(), &isdone, MPI_STATUSES_IGNORE);
+    
+    return isdone;
 }
+
+void slmpi::destroyplan(int plan)
+{
+    errorifunknownplan(plan);
     
+    for (int i = 0; i < plans[plan].size()-1; i++)
+        MPI_Request_free(&plans[plan][i]);
+    plans[plan] = {};
+    freeplannumbers.push_back(plan);
+}
+
 
 std::vector<double> slmpi::ping(int messagesize, int verbosity)
 {
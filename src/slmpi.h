@@ -36,6 +36,11 @@ namespace slmpi
     void sum(std::vector<int>& data);
     void sum(std::vector<double>& data);
     
+    // Nonblocking sum. The data must stay allocated and cannot be accessed until 'wait' is called on the returned request:
+    int isum(int len, double* data);
+    // Wait for the completion of a nonblocking request:
+    void wait(int request);
+    
     // Take the max of the values from all ranks and distribute the result back to all ranks:
     void max(std::vector<int>& data);
     void max(std::vector<double>& data);
@@ -77,6 +82,25 @@ namespace slmpi
     void exchange(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<int*> sendbuffers, std::vector<int> receivelens, std::vector<int*> receivebuffers);
     void exchange(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<double*> sendbuffers, std::vector<int> receivelens, std::vector<double*> receivebuffers);
     
+    // Nonblocking versions of the above exchange. The returned request must be completed with 'wait' (or until 'test' returns true).
+    // The buffers must stay allocated and cannot be accessed until then. This allows to perform local work during the communication:
+    int iexchange(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<int*> sendbuffers, std::vector<int> receivelens, std::vector<int*> receivebuffers);
+    int iexchange(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<double*> sendbuffers, std::vector<int> receivelens, std::vector<double*> receivebuffers);
+    // Check without blocking whether a request has completed (a completed request cannot be waited for anymore):
+    bool test(int request);
+    
+    // Persistent exchange plan for an exchange repeated with the same buffers (e.g. at every iteration of an iterative solver).
+    // The communication setup is done once. The plan is started with 'start' and completed with 'finish' (or until 'isfinished'
+    // returns true), after which it can be started again. The buffers must stay allocated until the plan is destroyed:
+    int createplan(std::vector<int> targetranks, std::vector<int> sendlens, std::vector<double*> sendbuffers, std::vector<int> receivelens, std::vector<double*> receivebuffers);
+    void start(int plan);
+    // Alternatively start all receives then each send separately, as soon as its buffer is ready. All sends must be started before 'finish':
+    void startreceives(int plan);
+    void startsend(int plan, int target);
+    void finish(int plan);
+    bool isfinished(int plan);
+    void destroyplan(int plan);
+    
     // Send + receive time for 'messagesize' doubles. Timings in ns are returned on rank 0:
     std::vector<double> ping(int messagesize, int verbosity = 1);
 };
@@ -0,0 +1,247 @@
+#include "threadpool.h"
+#include "universe.h"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+std::vector<std::thread> threadpool::myworkers;
+std::vector<std::shared_ptr<threadpoolqueue>> threadpool::myqueues = {};
+
+std::mutex threadpool::mystartmutex;
+
+std::mutex threadpool::mywaitmutex;
+std::condition_variable threadpool::mywaitcondition;
+int threadpool::numqueued = 0;
+bool threadpool::isstopping = false;
+
+bool threadpool::ispinned = false;
+std::vector<int> threadpool::myallowedcores = {};
+
+thread_local int threadpool::myworkerindex = -1;
+thread_local int threadpool::mytaskdepth = 0;
+
+// The workers must be joined before the static objects above are destroyed at exit:
+struct threadpoolstopper
+{
+    ~threadpoolstopper(void) { threadpool::stop(); }
+};
+
+static threadpoolstopper mystopper;
+
+
+void threadpool::workerloop(int index)
+{
+    myworkerindex = index;
+
+    while (true)
+    {
+        std::function<void(void)> task;
+        if (gettask(index, task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mywaitmutex);
+        mywaitcondition.wait(lock, []{ return (isstopping || numqueued > 0); });
+        if (isstopping && numqueued == 0)
+            return;
+    }
+}
+
+bool threadpool::gettask(int index, std::function<void(void)>& task)
+{
+    int numqueues = myqueues.size();
+
+    for (int i = 0; i < numqueues; i++)
+    {
+        // Start with the own queue (if any):
+        int q = (std::max(index, 0)+i)%numqueues;
+
+        std::lock_guard<std::mutex> lock(myqueues[q]->mymutex);
+        if (myqueues[q]->mytasks.size() == 0)
+            continue;
+
+        if (q == index)
+        {
+            task = myqueues[q]->mytasks.front();
+            myqueues[q]->mytasks.pop_front();
+        }
+        else
+        {
+            task = myqueues[q]->mytasks.back();
+            myqueues[q]->mytasks.pop_back();
+        }
+
+        std::lock_guard<std::mutex> waitlock(mywaitmutex);
+        numqueued--;
+
+        return true;
+    }
+    return false;
+}
+
+void threadpool::start(int numworkers)
+{
+    stop();
+
+    isstopping = false;
+
+    myqueues = std::vector<std::shared_ptr<threadpoolqueue>>(numworkers);
+    for (int i = 0; i < numworkers; i++)
+        myqueues[i] = std::shared_ptr<threadpoolqueue>(new threadpoolqueue);
+
+    myworkers = std::vector<std::thread>(numworkers);
+    for (int i = 0; i < numworkers; i++)
+    {
+        myworkers[i] = std::thread(workerloop, i);
+        if (ispinned)
+            pin(i);
+    }
+}
+
+void threadpool::pin(int index)
+{
+    #ifdef __linux__
+    if (myallowedcores.size() == 0)
+    {
+        // The calling thread is never pinned and still has the inherited mask:
+        cpu_set_t inheritedset;
+        CPU_ZERO(&inheritedset);
+        if (sched_getaffinity(0, sizeof(cpu_set_t), &inheritedset) == 0)
+        {
+            for (int c = 0; c < CPU_SETSIZE; c++)
+            {
+                if (CPU_ISSET(c, &inheritedset))
+                    myallowedcores.push_back(c);
+            }
+        }
+        if (myallowedcores.size() == 0)
+        {
+            for (int c = 0; c < std::max((int)std::thread::hardware_concurrency(), 1); c++)
+                myallowedcores.push_back(c);
+        }
+    }
+    int numcores = myallowedcores.size();
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    if (ispinned)
+    {
+        // The first allowed core is left to the calling thread:
+        CPU_SET(myallowedcores[(index+1)%numcores], &cpuset);
+    }
+    else
+    {
+        for (int c = 0; c < numcores; c++)
+            CPU_SET(myallowedcores[c], &cpuset);
+    }
+    pthread_setaffinity_np(myworkers[index].native_handle(), sizeof(cpu_set_t), &cpuset);
+    #endif
+}
+
+void threadpool::run(int numtasks, std::function<void(int)> fct)
+{
+    if (numtasks <= 0)
+        return;
+
+    // Nested parallel calls are run serially:
+    if (numtasks == 1 || mytaskdepth > 0 || universe::getmaxnumthreads() == 1)
+    {
+        for (int t = 0; t < numtasks; t++)
+            fct(t);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mystartmutex);
+        // The calling thread also runs tasks:
+        if (myworkers.size() != (size_t)universe::getmaxnumthreads()-1)
+            start(universe::getmaxnumthreads()-1);
+    }
+
+    // Keep the completion data alive until the last task has finished:
+    struct completion
+    {
+        std::atomic<int> remaining;
+        std::mutex mymutex;
+        std::condition_variable mycondition;
+    };
+    std::shared_ptr<completion> done(new completion);
+    done->remaining = numtasks;
+
+    int numqueues = myqueues.size();
+    for (int t = 0; t < numtasks; t++)
+    {
+        std::lock_guard<std::mutex> lock(myqueues[t%numqueues]->mymutex);
+        myqueues[t%numqueues]->mytasks.push_back([fct, t, done](void)
+        {
+            mytaskdepth++;
+            fct(t);
+            mytaskdepth--;
+            if (done->remaining.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> donelock(done->mymutex);
+                done->mycondition.notify_all();
+            }
+        });
+    }
+    {
+        std::lock_guard<std::mutex> lock(mywaitmutex);
+        numqueued += numtasks;
+    }
+    mywaitcondition.notify_all();
+
+    // Run tasks in the calling thread until there is none left in the queues:
+    std::function<void(void)> task;
+    while (done->remaining > 0 && gettask(-1, task))
+        task();
+
+    std::unique_lock<std::mutex> lock(done->mymutex);
+    done->mycondition.wait(lock, [&done]{ return (done->remaining == 0); });
+}
+
+int threadpool::count(void)
+{
+    return universe::getmaxnumthreads();
+}
+
+void threadpool::pinthreads(bool pinthem)
+{
+    #ifndef __linux__
+    if (pinthem)
+    {
+        std::cout << "Error in 'threadpool' object: thread pinning is only available on Linux" << std::endl;
+        abort();
+    }
+    #endif
+
+    std::lock_guard<std::mutex> lock(mystartmutex);
+
+    // Unpinned workers only need to be reset if they were pinned:
+    bool wasunpinned = not(ispinned);
+    ispinned = pinthem;
+    if (not(ispinned) && wasunpinned)
+        return;
+
+    // Apply to the running workers:
+    for (int i = 0; i < myworkers.size(); i++)
+        pin(i);
+}
+
+void threadpool::stop(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(mywaitmutex);
+        isstopping = true;
+    }
+    mywaitcondition.notify_all();
+
+    for (int i = 0; i < myworkers.size(); i++)
+        myworkers[i].join();
+
+    myworkers.clear();
+    myqueues.clear();
+}
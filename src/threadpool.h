@@ -0,0 +1,89 @@
+// sparselizard - Copyright (C) see copyright file.
+//
+// See the LICENSE file for license information. Please report all
+// bugs and problems to <alexandre.halbach at gmail.com>.
+
+// This object provides the persistent worker threads used by all parallel sections of the library.
+// The workers are started on the first parallel call and kept alive until the program ends so that
+// no thread is created per call. Every worker has its own task queue. Idle workers steal tasks from
+// the other queues and the calling thread executes tasks as well while it waits. A parallel call made
+// from inside a task is run serially in the worker to avoid oversubscribing the cores.
+//
+// The number of threads (calling thread included) follows 'universe::getmaxnumthreads()'. On Linux the
+// workers can optionally be pinned to a core each among the cores allowed by the affinity mask inherited
+// from the launcher (e.g. the cores given to an MPI rank). Since memory pages are placed on the NUMA node
+// of the core that first writes them this also keeps the data written by a worker local to its node.
+
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Task queue of a worker:
+struct threadpoolqueue
+{
+    std::mutex mymutex;
+    std::deque<std::function<void(void)>> mytasks;
+};
+
+class threadpool
+{
+    private:
+
+        static std::vector<std::thread> myworkers;
+        static std::vector<std::shared_ptr<threadpoolqueue>> myqueues;
+
+        // Protects the worker creation and destruction:
+        static std::mutex mystartmutex;
+
+        // Idle workers wait here until tasks are queued:
+        static std::mutex mywaitmutex;
+        static std::condition_variable mywaitcondition;
+        static int numqueued;
+        static bool isstopping;
+
+        static bool ispinned;
+        // Cores allowed by the inherited affinity mask (read on the first pinning):
+        static std::vector<int> myallowedcores;
+
+        // Index of the current thread in 'myworkers' (-1 if not a worker):
+        static thread_local int myworkerindex;
+        // Number of tasks being run by the current thread (a task can run a nested parallel call):
+        static thread_local int mytaskdepth;
+
+        static void workerloop(int index);
+
+        // Get a task from the queue of worker 'index' (front) or steal one from the other queues (back):
+        static bool gettask(int index, std::function<void(void)>& task);
+
+        // Start 'numworkers' workers (the current ones are stopped):
+        static void start(int numworkers);
+
+        // Pin the worker thread 'index' to an allowed core or give it back all allowed cores if not pinned:
+        static void pin(int index);
+
+    public:
+
+        // Call 'fct(t)' for all t in [0, numtasks) in parallel and return once all calls have finished:
+        static void run(int numtasks, std::function<void(int)> fct);
+
+        // Number of threads running the tasks (calling thread included):
+        static int count(void);
+
+        // Pin the workers to a core each (only available on Linux):
+        static void pinthreads(bool pinthem);
+
+        // Stop all workers. They are restarted by the next parallel call:
+        static void stop(void);
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "universe.h"
 #include "slepc.h"
+#include "slmpi.h"
 
 
 int universe::mynumrawmeshes = 0;
@@ -62,6 +63,16 @@ double universe::getfundamentalfrequency(void)
 }
 
 int universe::physregshift = 0;
+bool universe::partitionnextmesh = false;
+std::vector<std::vector<int>> universe::partitionweights = {};
+
+std::string universe::meshrenumbering = "none";
+
+int universe::sumfactorizationorder = -1;
+bool universe::issumfactorized(int elementtypenumber, int interpolationorder)
+{
+    return ((elementtypenumber == 3 || elementtypenumber == 5) && sumfactorizationorder >= 0 && interpolationorder >= sumfactorizationorder);
+}
 
 std::vector<std::vector<int>> universe::ddmints = {};
 std::vector<vec> universe::ddmvecs = {};
@@ -69,6 +80,14 @@ std::vector<mat> universe::ddmmats = {};
 std::vector<formulation> universe::ddmformuls = {};
 std::vector<intdensematrix> universe::ddmsendinds = {};
 std::vector<intdensematrix> universe::ddmrecvinds = {};
+std::vector<Mat> universe::ddmtransfers = {};
+std::vector<densematrix> universe::ddmcoarse = {};
+Mat universe::ddmcoarsemat = PETSC_NULL;
+KSP universe::ddmcoarseksp = PETSC_NULL;
+std::vector<int> universe::ddmcoarsedofs = {};
+std::vector<densematrix> universe::ddmsendbuffers = {};
+std::vector<densematrix> universe::ddmrecvbuffers = {};
+int universe::ddmplan = -1;
 
 void universe::clearddmcontainers(void)
 {
@@ -78,6 +97,22 @@ void universe::clearddmcontainers(void)
     ddmformuls = {};
     ddmsendinds = {};
     ddmrecvinds = {};
+    for (int i = 0; i < ddmtransfers.size(); i++)
+        MatDestroy(&ddmtransfers[i]);
+    ddmtransfers = {};
+    ddmcoarse = {};
+    if (ddmcoarseksp != PETSC_NULL)
+        KSPDestroy(&ddmcoarseksp);
+    if (ddmcoarsemat != PETSC_NULL)
+        MatDestroy(&ddmcoarsemat);
+    ddmcoarseksp = PETSC_NULL;
+    ddmcoarsemat = PETSC_NULL;
+    ddmcoarsedofs = {};
+    if (ddmplan >= 0)
+        slmpi::destroyplan(ddmplan);
+    ddmplan = -1;
+    ddmsendbuffers = {};
+    ddmrecvbuffers = {};
 }
 
 void universe::allowestimatorupdate(bool allowitonce)
@@ -351,17 +386,75 @@ void universe::resethff(void)
             }
         }
     }
+    
+    for (int typenameindex = 0; typenameindex < sumfacts.size(); typenameindex++)
+    {
+        for (int elementtypenumber = 0; elementtypenumber < (sumfacts[typenameindex].second).size(); elementtypenumber++)
+        {
+            for (int interpolorder = 0; interpolorder < sumfacts[typenameindex].second[elementtypenumber].size(); interpolorder++)
+                sumfacts[typenameindex].second[elementtypenumber][interpolorder] = {};
+        }
+    }
+}
+
+std::vector<std::pair< std::string, std::vector<std::vector< std::vector<std::pair<std::vector<int>, std::shared_ptr<sumfactorization>>> >> >> universe::sumfacts = {};
+
+std::shared_ptr<sumfactorization> universe::getsumfactorization(hierarchicalformfunctioncontainer* val, std::string fftypename, int elementtypenumber, int interpolorder, int totalorientation, int whichderivative, int formfunctioncomponent, std::vector<double>& evaluationcoordinates)
+{
+    std::vector<int> key = {totalorientation, whichderivative, formfunctioncomponent};
+
+    // Find the type name in the container:
+    int typenameindex = -1;
+    for (int i = 0; i < sumfacts.size(); i++)
+    {
+        if (sumfacts[i].first == fftypename)
+        {
+            typenameindex = i;
+            break;
+        }
+    }
+    if (typenameindex == -1)
+    {
+        sumfacts.push_back( std::make_pair(fftypename, std::vector<std::vector< std::vector<std::pair<std::vector<int>, std::shared_ptr<sumfactorization>>> >>(8, std::vector< std::vector<std::pair<std::vector<int>, std::shared_ptr<sumfactorization>>> >(0))) );
+        typenameindex = sumfacts.size() - 1;
+    }
+    if (sumfacts[typenameindex].second[elementtypenumber].size() <= interpolorder)
+        sumfacts[typenameindex].second[elementtypenumber].resize(interpolorder+1);
+        
+    std::vector<std::pair<std::vector<int>, std::shared_ptr<sumfactorization>>>* stored = &(sumfacts[typenameindex].second[elementtypenumber][interpolorder]);
+
+    if (isreuseallowed)
+    {
+        for (int i = 0; i < stored->size(); i++)
+        {
+            if ((*stored)[i].first == key)
+                return (*stored)[i].second;
+        }
+    }
+
+    densematrix formfunctionvalues = val->tomatrix(totalorientation, interpolorder, whichderivative, formfunctioncomponent);
+    std::shared_ptr<sumfactorization> sumfact(new sumfactorization(elementtypenumber, evaluationcoordinates, formfunctionvalues));
+    
+    // Invalid sum factorizations are stored as well to avoid retrying:
+    if (isreuseallowed)
+        stored->push_back(std::make_pair(key, sumfact));
+
+    return sumfact;
 }
 
 
 std::vector<std::vector<std::vector<std::vector<int>>>> universe::splitdefinition = std::vector<std::vector<std::vector<std::vector<int>>>>(8, std::vector<std::vector<std::vector<int>>>(0));
 
+std::mutex universe::splitdefinitionmutex;
+
 bool universe::getsplitdefinition(std::vector<std::vector<int>>& splitdef, int elementtypenumber, int splitnum, std::vector<int>& edgenumbers)
 {
     int ne = edgenumbers.size();
     int numrel = myalgorithm::factorial(ne);
     int rel = myalgorithm::identifyrelations(edgenumbers);
     
+    std::lock_guard<std::mutex> lock(splitdefinitionmutex);
+    
     if (splitdefinition[elementtypenumber].size() == 0 || splitdefinition[elementtypenumber][splitnum*numrel+rel].size() == 0)
         return false;
         
@@ -375,6 +468,8 @@ void universe::setsplitdefinition(std::vector<std::vector<int>>& splitdef, int e
     int numrel = myalgorithm::factorial(ne);
     int rel = myalgorithm::identifyrelations(edgenumbers);
     
+    std::lock_guard<std::mutex> lock(splitdefinitionmutex);
+    
     if (splitdefinition[elementtypenumber].size() == 0)
         splitdefinition[elementtypenumber] = std::vector<std::vector<std::vector<int>>>(std::pow(2,ne)*numrel, std::vector<std::vector<int>>(0));
     
@@ -10,6 +10,7 @@
 #include <vector>
 #include <string>
 #include <utility>
+#include <mutex>
 #include "rawmesh.h"
 #include "field.h"
 #include "jacobian.h"
@@ -19,6 +20,7 @@
 #include "selector.h"
 #include "hierarchicalformfunction.h"
 #include "hierarchicalformfunctioncontainer.h"
+#include "sumfactorization.h"
 #include "vec.h"
 
 class mesh;
@@ -33,6 +35,7 @@ class universe
         static int mynumrawmeshes;
         static void addtorawmeshcounter(int val);
         
+        // Number of threads used by the thread pool (calling thread included):
         static int maxnumthreads;
         static int getmaxnumthreads(void);
         static void setmaxnumthreads(int mnt);
@@ -51,6 +54,17 @@ class universe
         
         // Shift the physical region numbers by (physregdim+1) x physregshift when loading a mesh:
         static int physregshift;
+        // The next mesh loaded from a file is read by rank 0, partitioned with METIS and scattered to all ranks if true (set by 'sl::allpartition', reset once used):
+        static bool partitionnextmesh;
+        // Physical regions and their interpolation order to weight the METIS mesh partition (cleared once used):
+        static std::vector<std::vector<int>> partitionweights;
+        
+        // Space-filling curve ("hilbert", "morton" or "none") used to renumber the nodes and elements in every disjoint region when loading a mesh:
+        static std::string meshrenumbering;
+        
+        // Quadrangles and hexahedra are assembled and interpolated with sum factorization from this interpolation order on (-1 for never, the default):
+        static int sumfactorizationorder;
+        static bool issumfactorized(int elementtypenumber, int interpolationorder);
         
         // Temporary containers for DDM:
         static std::vector<std::vector<int>> ddmints;
@@ -59,6 +73,18 @@ class universe
         static std::vector<formulation> ddmformuls;
         static std::vector<intdensematrix> ddmsendinds;
         static std::vector<intdensematrix> ddmrecvinds;
+        // Sparse maps from the solution to the artificial sources on each interface:
+        static std::vector<Mat> ddmtransfers;
+        // Coarse operator data of the two-level DDM. The sparse coarse matrix and its factorization are only defined on rank 0,
+        // where 'ddmcoarsedofs[r]' is the coarse dof of rank r in the coarse matrix (-1 if dropped):
+        static std::vector<densematrix> ddmcoarse;
+        static Mat ddmcoarsemat;
+        static KSP ddmcoarseksp;
+        static std::vector<int> ddmcoarsedofs;
+        // Persistent exchange plan and its buffers for the artificial sources (-1 if undefined):
+        static std::vector<densematrix> ddmsendbuffers;
+        static std::vector<densematrix> ddmrecvbuffers;
+        static int ddmplan;
         
         static void clearddmcontainers(void);
         
@@ -129,12 +155,21 @@ class universe
         // In case 'isreuseallowed' is false a pointer to the evaluated form function polynomial storage is returned for speed reasons.
         // When multiple calls follow each other and 'isreuseallowed' is false the latter storage might be modified!
         static hierarchicalformfunctioncontainer* gethff(std::string fftypename, int elementtypenumber, int interpolorder, std::vector<double> evaluationcoordinates);
-        // Keep the polynomials but reset the values:
+        // Keep the polynomials but reset the values (the sum factorizations are cleared as well):
         static void resethff(void);
         
+        // Store the sum factorizations computed from the evaluated form function values above. Like the values they are only kept while
+        // 'isreuseallowed' is true and are cleared by 'resethff'. 'sumfacts[i].first' gives the ith form function type name and
+        // 'sumfacts[i].second[elemtypenum][interpolorder]' gives all {{totalorientation, derivative, component}, sum factorization} pairs.
+        static std::vector<std::pair< std::string, std::vector<std::vector< std::vector<std::pair<std::vector<int>, std::shared_ptr<sumfactorization>>> >> >> sumfacts;
+        // Return the requested sum factorization of the form function values in 'val' and reuse it if 'isreuseallowed' is true:
+        static std::shared_ptr<sumfactorization> getsumfactorization(hierarchicalformfunctioncontainer* val, std::string fftypename, int elementtypenumber, int interpolorder, int totalorientation, int whichderivative, int formfunctioncomponent, std::vector<double>& evaluationcoordinates);
+        
         
         // Store element split definitions. splitdefinition[elementtypenumber][splitidentifier].
         static std::vector< std::vector< std::vector<std::vector<int>> > > splitdefinition;
+        // The split definitions are accessed by the parallel mesh adaptation:
+        static std::mutex splitdefinitionmutex;
         // Return true if available and false otherwise.
         static bool getsplitdefinition(std::vector<std::vector<int>>& splitdef, int elementtypenumber, int splitnum, std::vector<int>& edgenumbers);
         static void setsplitdefinition(std::vector<std::vector<int>>& splitdef, int elementtypenumber, int splitnum, std::vector<int>& edgenumbers);